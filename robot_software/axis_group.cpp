@@ -0,0 +1,352 @@
+/* axis_group.cpp
+
+   Created 10/16/2026
+
+   This is the cpp file holding the function definitions for the axis_group
+   class. See axis_group.hpp.
+*/
+
+#include <stdio.h>
+#include "axis_group.hpp"
+#include "mono_clock.hpp"
+
+using namespace std;
+
+// Default Constructor
+axis_group::axis_group()
+{
+	axis_count = 0;
+	for (int i = 0; i < MAX_GROUP_AXES; i++)
+	{
+		motors[i] = NULL;
+		delays[i] = 0;
+	}
+	stream_started = false;
+	stop_requested.store(false);
+	stream_running.store(false);
+	stream_tick = 0;
+	cycle_number = 0;
+	cycle_start_tick = 0;
+}
+
+void axis_group::add_axis(dc_motor* motor, int delay_seconds)
+{
+	if (axis_count >= MAX_GROUP_AXES)
+	{
+		printf("Axis group is full. Ignoring axis.\n");
+		return;
+	}
+	motors[axis_count] = motor;
+	delays[axis_count] = delay_seconds;
+	axis_count++;
+}
+
+void axis_group::set_control_rate(int rate_hz)
+{
+	loop_timer.set_rate(rate_hz);
+}
+
+void axis_group::run_pdff(uint64_t initialization_tick)
+{
+	uint64_t start_ticks[MAX_GROUP_AXES];
+	bool running[MAX_GROUP_AXES];
+	bool started[MAX_GROUP_AXES];
+	bool stopped[MAX_GROUP_AXES];
+	uint64_t first_start = 0;
+	int running_count = 0;
+
+	for (int i = 0; i < axis_count; i++)
+	{
+		stopped[i] = false;
+		start_ticks[i] = initialization_tick + ((uint64_t) delays[i])*1000000;
+		started[i] = motors[i]->begin_pdff_path();
+		running[i] = started[i];
+		if (started[i])
+			motors[i]->record_run(EVENT_RUN_PDFF, start_ticks[i]);
+		if (running[i])
+		{
+			if ((running_count == 0) || (start_ticks[i] < first_start))
+				first_start = start_ticks[i];
+			running_count++;
+		}
+	}
+
+	if (running_count == 0)
+		return;
+
+	// Send every axis's pin writes through the shared stage.
+	outputs.sync();
+	for (int i = 0; i < axis_count; i++)
+	{
+		if (started[i])
+			motors[i]->set_output_stage(&outputs);
+	}
+
+	// Sleep until the first axis starts, then line up exactly on the tick.
+	loop_timer.start_at(first_start);
+	while(mono_tick() < first_start)
+		; // Do Nothing
+
+	printf("Starting Motors!\n");
+
+	while (running_count > 0)
+	{
+		// Wait for the start of this control period
+		loop_timer.wait_next();
+
+		// One timestamp for every axis this period.
+		uint64_t now = mono_tick();
+		for (int i = 0; i < axis_count; i++)
+		{
+			if (!running[i] || (now < start_ticks[i]))
+				continue;
+
+			if (!(motors[i]->step_pdff_path(now, start_ticks[i])))
+			{
+				running[i] = false;
+				running_count--;
+			}
+		}
+
+		// All axes change outputs together. An axis that finished or
+		// latched is stopped before the commit so its staged duty cycle
+		// never goes out. A limit switch can still trip before the commit
+		// and the alert only zeroes the pin, so look again after it.
+		this->stop_finished(started, running, stopped);
+		outputs.commit();
+		this->stop_finished(started, running, stopped);
+	}
+
+	loop_timer.print_stats("Axis group");
+
+	for (int i = 0; i < axis_count; i++)
+	{
+		if (started[i])
+		{
+			motors[i]->set_output_stage(NULL);
+			motors[i]->end_pdff_path();
+		}
+	}
+}
+
+int axis_group::start_stream(uint64_t initialization_tick)
+{
+	if (stream_started)
+	{
+		printf("Axis group is already streaming.\n");
+		return(1);
+	}
+
+	stream_tick = initialization_tick;
+	stop_requested.store(false);
+	stream_running.store(true);
+	if (pthread_create(&stream_thread, NULL, axis_group::_static_run_stream, this) != 0)
+	{
+		printf("Could not start the stream thread.\n");
+		stream_running.store(false);
+		return(1);
+	}
+	stream_started = true;
+	return(0);
+}
+
+void axis_group::request_stop()
+{
+	stop_requested.store(true);
+}
+
+bool axis_group::streaming()
+{
+	return(stream_running.load());
+}
+
+void axis_group::stop_stream()
+{
+	if (!stream_started)
+		return;
+	this->request_stop();
+	pthread_join(stream_thread, NULL);
+	stream_started = false;
+}
+
+bool axis_group::poll_cycle(stream_cycle_stats& stats)
+{
+	return(cycle_log.pop(stats));
+}
+
+void axis_group::print_cycle(const stream_cycle_stats& stats)
+{
+	printf("Cycle %u: %.1f ms, %llu iterations, max jitter %.1f us, %llu deadline misses.",
+	       stats.cycle, stats.duration_us/1000.0, (unsigned long long) stats.loop.iterations,
+	       stats.loop.max_jitter_us, (unsigned long long) stats.loop.deadline_misses);
+	for (int i = 0; i < stats.axis_count; i++)
+	{
+		printf(" %s error rms %.2f mm max %.2f mm.", enum2string(stats.axes[i]).c_str(),
+		       stats.rms_error[i]*1000, stats.max_error[i]*1000);
+	}
+	printf("\n");
+}
+
+void axis_group::stop_finished(const bool* started, const bool* running, bool* stopped)
+{
+	for (int i = 0; i < axis_count; i++)
+	{
+		if (started[i] && !stopped[i] && (!running[i] || motors[i]->limit_latch))
+		{
+			motors[i]->stop();
+			stopped[i] = true;
+		}
+	}
+}
+
+void* axis_group::_static_run_stream(void *userdata)
+{
+	((axis_group*) userdata)->run_stream();
+	return(NULL);
+}
+
+void axis_group::close_cycle(uint64_t now_tick, bool* started)
+{
+	stream_cycle_stats stats;
+	stats.cycle = cycle_number;
+	stats.start_tick = cycle_start_tick;
+	stats.duration_us = (uint32_t) (now_tick - cycle_start_tick);
+	stats.loop = loop_timer.take_window_stats();
+	stats.axis_count = 0;
+	for (int i = 0; i < axis_count; i++)
+	{
+		if (!started[i])
+			continue;
+		int n = stats.axis_count++;
+		stats.axes[n] = motors[i]->axis;
+		stats.rms_error[n] = motors[i]->tracking.rms();
+		stats.max_error[n] = motors[i]->tracking.max_abs;
+		motors[i]->tracking.reset();
+	}
+
+	// If nobody is collecting, drop the cycle rather than block.
+	cycle_log.push(stats);
+
+	cycle_number++;
+	cycle_start_tick = now_tick;
+}
+
+void axis_group::run_stream()
+{
+	uint64_t start_ticks[MAX_GROUP_AXES];
+	bool running[MAX_GROUP_AXES];
+	bool started[MAX_GROUP_AXES];
+	bool stopped[MAX_GROUP_AXES];
+	uint32_t cycles_seen[MAX_GROUP_AXES];
+	uint64_t first_start = 0;
+	int running_count = 0;
+	int reference = -1;
+	bool stopping = false;
+
+	for (int i = 0; i < axis_count; i++)
+	{
+		start_ticks[i] = stream_tick + ((uint64_t) delays[i])*1000000;
+		started[i] = motors[i]->begin_stream_path();
+		running[i] = started[i];
+		if (started[i])
+			motors[i]->record_run(EVENT_RUN_STREAM, start_ticks[i]);
+		cycles_seen[i] = 0;
+		stopped[i] = false;
+		if (running[i])
+		{
+			if ((running_count == 0) || (start_ticks[i] < first_start))
+				first_start = start_ticks[i];
+			if (reference < 0)
+				reference = i;
+			running_count++;
+		}
+	}
+
+	if (running_count == 0)
+	{
+		stream_running.store(false);
+		return;
+	}
+
+	// Send every axis's pin writes through the shared stage.
+	outputs.sync();
+	for (int i = 0; i < axis_count; i++)
+	{
+		if (started[i])
+			motors[i]->set_output_stage(&outputs);
+	}
+
+	// Sleep until the first axis starts, then line up exactly on the tick.
+	loop_timer.start_at(first_start);
+	while(mono_tick() < first_start)
+		; // Do Nothing
+
+	printf("Starting Motors!\n");
+	cycle_number = 0;
+	cycle_start_tick = first_start;
+
+	while (running_count > 0)
+	{
+		// Wait for the start of this control period
+		loop_timer.wait_next();
+
+		// Pass a stop on to every axis. They each finish the cycle they
+		// are in and then ramp down.
+		if (!stopping && stop_requested.load())
+		{
+			stopping = true;
+			for (int i = 0; i < axis_count; i++)
+			{
+				if (started[i])
+					motors[i]->finish_stream_path();
+			}
+		}
+
+		// One timestamp for every axis this period.
+		uint64_t now = mono_tick();
+		for (int i = 0; i < axis_count; i++)
+		{
+			if (!running[i] || (now < start_ticks[i]))
+				continue;
+
+			// The step marks each new loop cycle in the telemetry. The
+			// first axis's cycles set the statistics windows.
+			if (!(motors[i]->step_stream_path(now, start_ticks[i])))
+			{
+				running[i] = false;
+				running_count--;
+				continue;
+			}
+
+			uint32_t cycles = motors[i]->segment_cursor.cycles_started();
+			if (cycles != cycles_seen[i])
+			{
+				cycles_seen[i] = cycles;
+				if (i == reference)
+					this->close_cycle(now, started);
+			}
+		}
+
+		// All axes change outputs together. An axis that finished or
+		// latched is stopped before the commit so its staged duty cycle
+		// never goes out. A limit switch can still trip before the commit
+		// and the alert only zeroes the pin, so look again after it.
+		this->stop_finished(started, running, stopped);
+		outputs.commit();
+		this->stop_finished(started, running, stopped);
+	}
+
+	// Whatever is left (the last cycle and the rampdown) is the last window.
+	this->close_cycle(mono_tick(), started);
+	loop_timer.print_stats("Axis group stream");
+
+	for (int i = 0; i < axis_count; i++)
+	{
+		if (started[i])
+		{
+			motors[i]->set_output_stage(NULL);
+			motors[i]->end_stream_path();
+		}
+	}
+	stream_running.store(false);
+}
@@ -0,0 +1,128 @@
+/* axis_group.hpp
+
+   Created 10/16/2026
+
+   This is the header file for the axis_group class.
+
+   An axis_group runs the PD-Feedforward paths of several dc_motors from a
+   single control thread. Every control period it reads the clock once and
+   steps each axis against that same timestamp, so all axes use the same
+   time index and write their outputs back to back. This replaces starting
+   one busy thread per motor and keeps the axes from drifting out of phase
+   with each other.
+
+   Each axis can have its own start delay, measured from the same
+   initialization tick.
+
+   While the group runs, every motor writes its pins through the group's
+   output_stage, which is committed once per period so all direction bits
+   change in one register write.
+
+   The group can also stream: every axis repeats the loop of its planned
+   path indefinitely, on a thread of its own, until stop_stream(). Each
+   cycle of the first axis closes a stream_cycle_stats record (loop timing
+   and each axis's tracking error for that cycle) that is queued for the
+   caller to print with poll_cycle(). Memory use is fixed however long the
+   stream runs.
+*/
+
+#ifndef __AXIS_GROUP_HPP__
+#define __AXIS_GROUP_HPP__
+
+#include <stdint.h>
+#include <pthread.h>
+#include <atomic>
+#include "dc_motor.hpp"
+#include "control_timer.hpp"
+#include "output_stage.hpp"
+#include "spsc_queue.hpp"
+
+#define MAX_GROUP_AXES 4
+
+// Cycles of statistics kept until the caller collects them
+#define STREAM_STATS_QUEUE_SIZE 64
+
+// One cycle of a streaming run
+struct stream_cycle_stats {
+	uint32_t cycle;
+	uint64_t start_tick;
+	uint32_t duration_us;
+	control_loop_stats loop;
+	int axis_count;
+	motor_axis axes[MAX_GROUP_AXES];
+	float rms_error[MAX_GROUP_AXES];  // m
+	float max_error[MAX_GROUP_AXES];  // m
+};
+
+class axis_group
+{
+public:
+
+	// Scheduler shared by every axis in the group
+	control_timer loop_timer;
+
+	// Pin writes from every axis, applied once per period
+	output_stage outputs;
+
+	// Default Constructor
+	axis_group();
+
+	// Add a motor that starts delay_seconds after the initialization tick
+	void add_axis(dc_motor* motor, int delay_seconds);
+
+	// Set the control loop rate (Hz)
+	void set_control_rate(int rate_hz);
+
+	// Run all axes on their PD-Feedforward paths. Returns when every axis
+	// is done.
+	void run_pdff(uint64_t initialization_tick);
+
+	// Start streaming on a new thread. Returns 0 on success.
+	int start_stream(uint64_t initialization_tick);
+
+	// Send every axis to its rampdown at the end of the current cycle
+	void request_stop();
+
+	// True until every axis has finished its rampdown
+	bool streaming();
+
+	// Request a stop if needed and wait for the stream to finish
+	void stop_stream();
+
+	// Take the next finished cycle's statistics, if there is one
+	bool poll_cycle(stream_cycle_stats& stats);
+
+	// Print one cycle's statistics
+	static void print_cycle(const stream_cycle_stats& stats);
+
+	// Stream thread entry point
+	static void* _static_run_stream(void *userdata);
+
+private:
+
+	// The streaming loop. Runs until every axis is done.
+	void run_stream();
+
+	// Queue the statistics of the cycle that just ended
+	void close_cycle(uint64_t now_tick, bool* started);
+
+	// Stop each started axis that is done or latched, once
+	void stop_finished(const bool* started, const bool* running, bool* stopped);
+
+	pthread_t stream_thread;
+	bool stream_started;
+	std::atomic<bool> stop_requested;
+	std::atomic<bool> stream_running;
+	uint64_t stream_tick;
+
+	// Finished cycles, from the stream thread to the caller
+	spsc_queue<stream_cycle_stats, STREAM_STATS_QUEUE_SIZE> cycle_log;
+	uint32_t cycle_number;
+	uint64_t cycle_start_tick;
+
+	dc_motor* motors[MAX_GROUP_AXES];
+	int delays[MAX_GROUP_AXES];
+	int axis_count;
+};
+
+#endif
@@ -0,0 +1,108 @@
+/* ball_predictor.cpp
+
+   Created 10/16/2026
+
+   This is the cpp file holding the function definitions for the
+   ball_predictor class. See ball_predictor.hpp.
+*/
+
+#include <cmath>
+#include "ball_predictor.hpp"
+#include "path_planner.hpp"
+
+using namespace std;
+
+// Default Constructor
+ball_predictor::ball_predictor()
+{
+	this->reset();
+}
+
+void ball_predictor::reset()
+{
+	head = 0;
+	count = 0;
+	sum_t = 0;
+	sum_tt = 0;
+	sum_x = 0;
+	sum_tx = 0;
+	sum_z = 0;
+	sum_tz = 0;
+	first_tick = 0;
+	newest_tick = 0;
+}
+
+void ball_predictor::add_sums(double t, double x, double z, double sign)
+{
+	sum_t += sign*t;
+	sum_tt += sign*t*t;
+	sum_x += sign*x;
+	sum_tx += sign*t*x;
+	sum_z += sign*z;
+	sum_tz += sign*t*z;
+}
+
+void ball_predictor::add(uint64_t tick, double x, double y)
+{
+	if ((count > 0) && ((tick <= newest_tick) || (tick - newest_tick > BALL_GAP_US)))
+		this->reset();
+	if (count == 0)
+		first_tick = tick;
+	newest_tick = tick;
+
+	double t = (tick - first_tick)*1e-6;
+	double z = y + 0.5*GRAVITY*t*t;
+
+	// Drop the oldest sample once the window is full.
+	if (count == BALL_WINDOW)
+		this->add_sums(t_samples[head], x_samples[head], z_samples[head], -1);
+	else
+		count++;
+
+	t_samples[head] = t;
+	x_samples[head] = x;
+	z_samples[head] = z;
+	head = (head + 1) % BALL_WINDOW;
+	this->add_sums(t, x, z, 1);
+}
+
+bool ball_predictor::predict(double catch_height, ball_prediction& prediction) const
+{
+	if (count < BALL_MIN_SAMPLES)
+		return(false);
+
+	double n = count;
+	double denom = n*sum_tt - sum_t*sum_t;
+	if (denom <= 1e-12)
+		return(false);
+
+	double vx = (n*sum_tx - sum_t*sum_x)/denom;
+	double x0 = (sum_x - vx*sum_t)/n;
+	double vy0 = (n*sum_tz - sum_t*sum_z)/denom;
+	double y0 = (sum_z - vy0*sum_t)/n;
+
+	// y0 + vy0*t - GRAVITY*t^2/2 = catch_height, on the way down
+	double discriminant = vy0*vy0 + 2*GRAVITY*(y0 - catch_height);
+	if (discriminant < 0)
+		return(false);
+	double t_catch = (vy0 + sqrt(discriminant))/GRAVITY;
+	if (t_catch < 0)
+		return(false);
+
+	prediction.catch_x = x0 + vx*t_catch;
+	prediction.catch_tick = first_tick + (uint64_t) llround(t_catch*1e6);
+	prediction.vx = vx;
+	prediction.vy = vy0 - GRAVITY*t_catch;
+	prediction.samples = count;
+	return(true);
+}
+
+int ball_predictor::size() const
+{
+	return(count);
+}
+
+uint64_t ball_predictor::last_tick() const
+{
+	return(newest_tick);
+}
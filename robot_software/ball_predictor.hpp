@@ -0,0 +1,95 @@
+/* ball_predictor.hpp
+
+   Created 10/16/2026
+
+   This is the header file for the ball_predictor class.
+
+   A ball_predictor fits the ball's flight to the CV's recent position
+   samples and predicts where it comes down to the catch height, so the
+   hand can go there instead of chasing where the ball is now.
+
+   The flight is the same one path_planning_level1_v10.m plans for: no
+   drag, constant gravity, so
+       x(t) = x0 + vx*t
+       y(t) = y0 + vy*t - GRAVITY*t^2/2
+   Gravity is known, so y(t) + GRAVITY*t^2/2 is a straight line too, and
+   both fits are ordinary straight line least squares. The fit keeps
+   running sums over the last BALL_WINDOW samples and subtracts the oldest
+   as a new one comes in, so each sample costs the same no matter how long
+   the ball has been in the air.
+
+   A gap of more than BALL_GAP_US between samples starts a new flight.
+   Times are in microseconds on one clock, the CV's own time stamps.
+*/
+
+#ifndef __BALL_PREDICTOR_HPP__
+#define __BALL_PREDICTOR_HPP__
+
+#include <stdint.h>
+
+// Samples in the fit
+#define BALL_WINDOW 32
+
+// Fewest samples to predict from
+#define BALL_MIN_SAMPLES 4
+
+// A longer gap between samples starts a new flight (us)
+#define BALL_GAP_US 100000
+
+struct ball_prediction {
+	double catch_x;       // m, x where the ball comes down to the catch height
+	uint64_t catch_tick;  // us, on the samples' clock
+	double vx;            // m/s, fitted velocity
+	double vy;            // m/s, at catch_tick
+	int samples;          // in the fit
+};
+
+class ball_predictor
+{
+public:
+
+	// Default Constructor
+	ball_predictor();
+
+	// Forget the flight so far
+	void reset();
+
+	// Add a ball position (m) seen at tick (us)
+	void add(uint64_t tick, double x, double y);
+
+	// Predict where the ball comes down through catch_height. Returns
+	// false if there are too few samples, or the fitted flight never
+	// comes down through that height.
+	bool predict(double catch_height, ball_prediction& prediction) const;
+
+	// Samples in the fit
+	int size() const;
+
+	// Tick of the newest sample
+	uint64_t last_tick() const;
+
+private:
+
+	void add_sums(double t, double x, double z, double sign);
+
+	// Samples, as t (s since the first sample of the flight), x and
+	// z = y + GRAVITY*t^2/2
+	double t_samples[BALL_WINDOW];
+	double x_samples[BALL_WINDOW];
+	double z_samples[BALL_WINDOW];
+	int head;
+	int count;
+
+	// Running sums over the window
+	double sum_t;
+	double sum_tt;
+	double sum_x;
+	double sum_tx;
+	double sum_z;
+	double sum_tz;
+
+	uint64_t first_tick;
+	uint64_t newest_tick;
+};
+
+#endif
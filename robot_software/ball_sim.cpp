@@ -0,0 +1,352 @@
+/* ball_sim.cpp
+
+   Created 10/16/2026
+
+   This is the cpp file holding the function definitions for the ball and
+   hand simulator. See ball_sim.hpp.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <cmath>
+#include "ball_sim.hpp"
+#include "telemetry.hpp"
+
+using namespace std;
+
+ball_sim_params::ball_sim_params()
+{
+	throw_tolerance = 0.01;
+	catch_tolerance = 0.02;
+	restitution = 0.2;
+	hand_width = 0.1;
+	hand_height = 0.05;
+	gravity = GRAVITY;
+}
+
+double hand_track::duration() const
+{
+	return((y.size() > 1) ? (y.size() - 1)*sample_period : 0);
+}
+
+// Vertical acceleration as the slope of the velocity either side
+static void differentiate(hand_track& track)
+{
+	int n = (int) track.size();
+	int half = (int) round(HAND_TRACK_ACCEL_HALF_WINDOW / track.sample_period);
+	if (half < 1)
+		half = 1;
+	track.ay.assign(n, 0);
+	for (int i = 0; i < n; i++)
+	{
+		int lo = (i < half) ? 0 : (i - half);
+		int hi = (i + half >= n) ? (n - 1) : (i + half);
+		if (hi > lo)
+			track.ay[i] = (track.vy[hi] - track.vy[lo]) / ((hi - lo)*track.sample_period);
+	}
+}
+
+void hand_track_from_paths(const piecewise_path& x_path, const piecewise_path& y_path, double sample_rate_hz,
+                           hand_track& track)
+{
+	track = hand_track();
+	track.sample_period = 1.0 / sample_rate_hz;
+	uint32_t samples = (uint32_t) floor(y_path.total_duration()*sample_rate_hz) + 1;
+	double x_end = x_path.total_duration();
+	path_point last_x = x_path.evaluate(x_end);
+	for (uint32_t i = 0; i < samples; i++)
+	{
+		double t = i*track.sample_period;
+
+		// X holds where it ends if its path is the shorter one.
+		path_point px = (t <= x_end) ? x_path.evaluate(t) : last_x;
+		path_point py = y_path.evaluate(t);
+		track.x.push_back(px.d);
+		track.vx.push_back((t <= x_end) ? px.v : 0);
+		track.y.push_back(py.d);
+		track.vy.push_back(py.v);
+		track.ay.push_back(py.a);
+	}
+}
+
+void hand_track_from_tables(const path_view& position, const path_view& velocity, const path_view& acceleration,
+                            double sample_rate_hz, double x, hand_track& track)
+{
+	track = hand_track();
+	track.sample_period = 1.0 / sample_rate_hz;
+	uint32_t samples = (position.size() < velocity.size()) ? position.size() : velocity.size();
+	for (uint32_t i = 0; i < samples; i++)
+	{
+		track.x.push_back(x);
+		track.vx.push_back(0);
+		track.y.push_back(position[i]);
+		track.vy.push_back(velocity[i]);
+	}
+	if (acceleration.size() >= samples)
+		track.ay.assign(acceleration.data, acceleration.data + samples);
+	else
+		differentiate(track);
+}
+
+int hand_track_from_telemetry(string filename, int run, double x, double sample_rate_hz, hand_track& track)
+{
+	FILE* file = fopen(filename.c_str(), "rb");
+	if (!file)
+	{
+		printf("Could not open %s\n", filename.c_str());
+		return(1);
+	}
+
+	telemetry_file_header header;
+	if ((fread(&header, sizeof(header), 1, file) != 1) || (memcmp(header.magic, TELEMETRY_MAGIC, 4) != 0) ||
+	    (header.record_size != sizeof(telemetry_record)))
+	{
+		printf("%s is not a telemetry file from this build.\n", filename.c_str());
+		fclose(file);
+		return(1);
+	}
+
+	vector<telemetry_record> records;
+	telemetry_record rec;
+	int current = 0;
+	while (fread(&rec, sizeof(rec), 1, file) == 1)
+	{
+		if (rec.flags & TELEMETRY_RUN_START)
+			current++;
+		if (current == run)
+			records.push_back(rec);
+		else if (current > run)
+			break;
+	}
+	fclose(file);
+
+	if (records.size() < 2)
+	{
+		printf("%s has no run %d.\n", filename.c_str(), run);
+		return(1);
+	}
+
+	// Resample the measured motion at a fixed rate.
+	track = hand_track();
+	track.sample_period = 1.0 / sample_rate_hz;
+	uint64_t start = records[0].tick;
+	double span = (records.back().tick - start) * 1e-6;
+	uint32_t samples = (uint32_t) floor(span*sample_rate_hz) + 1;
+	size_t j = 0;
+	for (uint32_t i = 0; i < samples; i++)
+	{
+		double t = i*track.sample_period*1e6 + start;
+		while ((j + 2 < records.size()) && (records[j + 1].tick <= t))
+			j++;
+		const telemetry_record& a = records[j];
+		const telemetry_record& b = records[j + 1];
+		double f = (b.tick > a.tick) ? (t - a.tick)/(b.tick - a.tick) : 0;
+		f = (f < 0) ? 0 : ((f > 1) ? 1 : f);
+		track.x.push_back(x);
+		track.vx.push_back(0);
+		track.y.push_back(a.position + f*(b.position - a.position));
+		track.vy.push_back(a.velocity + f*(b.velocity - a.velocity));
+	}
+	differentiate(track);
+	return(0);
+}
+
+// Default Constructor
+ball_batch::ball_batch()
+{
+}
+
+void ball_batch::resize(uint32_t count)
+{
+	x.resize(count);
+	y.resize(count);
+	vx.resize(count);
+	vy.resize(count);
+	state.resize(count);
+	throw_error_x.resize(count, 0);
+	throw_error_y.resize(count, 0);
+	throws.resize(count);
+	catches.resize(count);
+	bounces.resize(count);
+	catch_speed.resize(count);
+}
+
+uint32_t ball_batch::size() const
+{
+	return((uint32_t) state.size());
+}
+
+void ball_batch::reset(const hand_track& track)
+{
+	uint32_t count = this->size();
+	for (uint32_t i = 0; i < count; i++)
+	{
+		x[i] = track.size() ? track.x[0] : 0;
+		y[i] = track.size() ? track.y[0] : 0;
+		vx[i] = track.size() ? track.vx[0] : 0;
+		vy[i] = track.size() ? track.vy[0] : 0;
+		state[i] = BALL_HELD;
+		throws[i] = 0;
+		catches[i] = 0;
+		bounces[i] = 0;
+		catch_speed[i] = 0;
+	}
+}
+
+bool ball_batch::caught_every_throw(uint32_t ball) const
+{
+	return((throws[ball] > 0) && (catches[ball] == throws[ball]) && (state[ball] == BALL_HELD));
+}
+
+// Where the hand is when a ball leaves it during step k, and the time left
+// in the step after that
+struct release {
+	double x;
+	double y;
+	double vx;
+	double vy;
+	double rest;
+};
+
+static release release_state(const hand_track& track, uint32_t k, double release_accel)
+{
+	double dt = track.sample_period;
+	double a0 = track.ay[k - 1];
+	double a1 = track.ay[k];
+
+	// Already past the release point at the last sample (just caught)
+	double tr = 0;
+	if ((a0 >= release_accel) && (a0 > a1))
+		tr = (track.vy[k] - track.vy[k - 1] - a1*dt) / (a0 - a1);
+	tr = (tr < 0) ? 0 : ((tr > dt) ? dt : tr);
+
+	double f = tr / dt;
+	release point;
+	point.x = track.x[k - 1] + f*(track.x[k] - track.x[k - 1]);
+	point.vx = track.vx[k - 1] + f*(track.vx[k] - track.vx[k - 1]);
+	point.y = track.y[k - 1] + track.vy[k - 1]*tr + 0.5*a0*tr*tr;
+	point.vy = track.vy[k - 1] + a0*tr;
+	point.rest = dt - tr;
+	return(point);
+}
+
+void simulate_balls(const ball_sim_params& params, const hand_track& track, ball_batch& balls)
+{
+	uint32_t count = balls.size();
+	uint32_t samples = track.size();
+	if (samples < 2)
+		return;
+
+	double dt = track.sample_period;
+	double g = params.gravity;
+	double release_accel = -g*(1 + params.throw_tolerance);
+	double half_width = params.hand_width/2;
+
+	// A ball this far below the lowest the hand goes is on the floor.
+	double floor = track.y[0];
+	for (uint32_t k = 1; k < samples; k++)
+		floor = (track.y[k] < floor) ? track.y[k] : floor;
+	floor -= params.hand_height;
+
+	double* x = &balls.x[0];
+	double* y = &balls.y[0];
+	double* vx = &balls.vx[0];
+	double* vy = &balls.vy[0];
+	uint8_t* state = &balls.state[0];
+
+	for (uint32_t k = 1; k < samples; k++)
+	{
+		double hx = track.x[k];
+		double hy = track.y[k];
+		double hvx = track.vx[k];
+		double hvy = track.vy[k];
+		double last_hy = track.y[k - 1];
+		double hand_speed = sqrt(hvx*hvx + hvy*hvy);
+		bool releasing = (track.ay[k] < release_accel);
+
+		// A ball leaves the hand when its deceleration passes the release
+		// point, which is inside the step, not at its end. The hand's
+		// velocity falls at nearly g from then on, so releasing at the
+		// sample would throw every ball slow by up to g*dt. Take the
+		// acceleration as the last sample's until a jump to this one's at
+		// tr, with tr chosen so the velocity comes out at this sample. That
+		// is exact for the planner's constant acceleration periods.
+		release release_point;
+		if (releasing)
+			release_point = release_state(track, k, release_accel);
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (state[i] == BALL_HELD)
+			{
+				x[i] = hx;
+				y[i] = hy;
+				vx[i] = hvx;
+				vy[i] = hvy;
+				if (releasing)
+				{
+					// Thrown at the release point, then free fall for the
+					// rest of the step
+					double rest = release_point.rest;
+					vx[i] = release_point.vx + balls.throw_error_x[i];
+					vy[i] = release_point.vy + balls.throw_error_y[i];
+					x[i] = release_point.x + vx[i]*rest;
+					y[i] = release_point.y + vy[i]*rest - 0.5*g*rest*rest;
+					vy[i] -= g*rest;
+					state[i] = BALL_FLYING;
+					balls.throws[i]++;
+				}
+				continue;
+			}
+			if (state[i] != BALL_FLYING)
+				continue;
+
+			// Free fall, exact for constant gravity
+			double last_y = y[i];
+			x[i] += vx[i]*dt;
+			y[i] += vy[i]*dt - 0.5*g*dt*dt;
+			vy[i] -= g*dt;
+
+			// Came down through the top of the hand since the last step,
+			// and still closing on it. A ball that was on the hand, just
+			// thrown or bounced, is not; a slow throw can dip a little
+			// below a hand decelerating away from it.
+			if ((last_y > last_hy) && (y[i] < hy) && (vy[i] < hvy) && (fabs(x[i] - hx) <= half_width))
+			{
+				double dvx = vx[i] - hvx;
+				double dvy = vy[i] - hvy;
+				double tolerance = params.catch_tolerance*hand_speed;
+				if ((fabs(dvx) <= tolerance) && (fabs(dvy) <= tolerance))
+				{
+					double speed = sqrt(dvx*dvx + dvy*dvy);
+					if (speed > balls.catch_speed[i])
+						balls.catch_speed[i] = speed;
+					x[i] = hx;
+					y[i] = hy;
+					vx[i] = hvx;
+					vy[i] = hvy;
+					state[i] = BALL_HELD;
+					balls.catches[i]++;
+				}
+				else
+				{
+					balls.bounces[i]++;
+					y[i] = hy;
+					vy[i] = hvy - params.restitution*dvy;
+
+					// Too slow to get clear of the hand by the next step:
+					// it comes to rest in the hand, but was not caught.
+					if (vy[i] - hvy < (g + fabs(track.ay[k]))*dt)
+					{
+						x[i] = hx;
+						vx[i] = hvx;
+						vy[i] = hvy;
+						state[i] = BALL_HELD;
+					}
+				}
+			}
+			else if (y[i] < floor)
+				state[i] = BALL_DROPPED;
+		}
+	}
+}
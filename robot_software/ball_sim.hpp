@@ -0,0 +1,139 @@
+/* ball_sim.hpp
+
+   Created 10/16/2026
+
+   This is the header file for the ball and hand simulator. It is a port of
+   phys_sim.m and phys_obj.m from path_planning/, for scoring hand
+   trajectories in bulk instead of watching one animation at a time.
+
+   A hand follows a hand_track: its position, velocity and vertical
+   acceleration sampled at a fixed rate, from planned paths, the tables a
+   dc_motor runs, or the measured motion in a telemetry file. The hand is a
+   rectangle hand_width wide with its top center at the track position;
+   the ball is a point, as in phys_obj (reduction_factor).
+
+   The rules are phys_sim's:
+     A ball in the hand moves with it, and is released when the hand
+     decelerates faster than gravity by more than the throw tolerance.
+     A flying ball falls freely. When it comes down onto the hand it is
+     caught if its velocity is within the catch tolerance of the hand's,
+     and otherwise bounces with the coefficient of restitution, the hand
+     having infinite mass.
+   A bounce too small to leave the hand for a whole step leaves the ball at
+   rest in the hand without being caught; phys_sim bounces it forever.
+   Some things are done differently from the MATLAB:
+     The bounce reflects the velocity relative to the hand,
+     v = vh - e (v - vh). phys_sim's e (2 vh - v) is only right for e = 1.
+     Contact is the ball crossing the top of the hand between two steps
+     while closing on it, so a fast ball cannot step through the hand, and
+     a ball that has just bounced or been thrown is not hit again.
+     The catch tolerance is a fraction of the hand's speed, not of each
+     velocity component, so a hand that is still in x can still catch.
+     A ball is released where the deceleration passes the release point
+     inside a step, not at the next sample, so its speed does not depend
+     on the sample rate.
+   Ball-ball and hand-hand collisions are not modelled.
+
+   Balls are kept as a structure of arrays (ball_batch) and all of them are
+   stepped together against one track, so thousands of balls with
+   different throw errors cost one pass over the track. Batches share
+   nothing, so separate batches can run on separate threads.
+*/
+
+#ifndef __BALL_SIM_HPP__
+#define __BALL_SIM_HPP__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "path_planner.hpp"
+#include "trajectory_file.hpp"
+
+// Acceleration from velocity is the slope over this long either side (s)
+#define HAND_TRACK_ACCEL_HALF_WINDOW 0.001
+
+// Ball and hand properties. Defaults are phys_sim's.
+struct ball_sim_params {
+	double throw_tolerance;   // fraction of g past g to release
+	double catch_tolerance;   // fraction of the hand speed
+	double restitution;       // ball on hand
+	double hand_width;        // m
+	double hand_height;       // m
+	double gravity;           // m/s^2
+
+	ball_sim_params();
+};
+
+// Where a hand is, sampled at a fixed rate. Structure of arrays.
+struct hand_track {
+	double sample_period;     // s
+	std::vector<double> x;
+	std::vector<double> y;
+	std::vector<double> vx;
+	std::vector<double> vy;
+	std::vector<double> ay;
+
+	hand_track() : sample_period(0) {}
+
+	uint32_t size() const { return((uint32_t) y.size()); }
+	double duration() const;
+};
+
+// From planned x and y paths, over the whole of the y path
+void hand_track_from_paths(const piecewise_path& x_path, const piecewise_path& y_path, double sample_rate_hz,
+                           hand_track& track);
+
+// From position and velocity tables (as a dc_motor runs them) for the y
+// axis, with the hand at a fixed x. If acceleration is empty it is worked
+// out from the velocity.
+void hand_track_from_tables(const path_view& position, const path_view& velocity, const path_view& acceleration,
+                            double sample_rate_hz, double x, hand_track& track);
+
+// From the measured position and velocity in one run of a telemetry file,
+// resampled at sample_rate_hz. Runs are numbered from 1. Returns 0 on
+// success.
+int hand_track_from_telemetry(std::string filename, int run, double x, double sample_rate_hz, hand_track& track);
+
+enum ball_state {BALL_HELD = 0, BALL_FLYING = 1, BALL_DROPPED = 2};
+
+// A batch of balls as a structure of arrays
+class ball_batch
+{
+public:
+
+	// Default Constructor
+	ball_batch();
+
+	void resize(uint32_t count);
+	uint32_t size() const;
+
+	// Put every ball in the hand at the start of the track and clear the
+	// counts. The throw errors are kept.
+	void reset(const hand_track& track);
+
+	// Thrown at least once and caught every time
+	bool caught_every_throw(uint32_t ball) const;
+
+	std::vector<double> x;
+	std::vector<double> y;
+	std::vector<double> vx;
+	std::vector<double> vy;
+	std::vector<uint8_t> state;
+
+	// Added to the hand's velocity at every release (m/s)
+	std::vector<double> throw_error_x;
+	std::vector<double> throw_error_y;
+
+	// Releases, catches within the tolerance, and bounces
+	std::vector<uint32_t> throws;
+	std::vector<uint32_t> catches;
+	std::vector<uint32_t> bounces;
+
+	// Largest speed relative to the hand at a catch (m/s)
+	std::vector<double> catch_speed;
+};
+
+// Run every ball in the batch along the whole track
+void simulate_balls(const ball_sim_params& params, const hand_track& track, ball_batch& balls);
+
+#endif
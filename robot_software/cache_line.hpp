@@ -0,0 +1,15 @@
+/* cache_line.hpp
+
+   Created 10/16/2026
+
+   The cache line size, for laying out data shared between threads so that
+   what one thread writes does not share a line with what another polls.
+   64 bytes on the Pi's Cortex-A cores and on x86.
+*/
+
+#ifndef __CACHE_LINE_HPP__
+#define __CACHE_LINE_HPP__
+
+#define CACHE_LINE_SIZE 64
+
+#endif
@@ -0,0 +1,323 @@
+/* catch_score.cpp
+
+   Created 10/16/2026
+
+   Scores hand trajectories by how often they catch what they throw. Each
+   candidate trajectory throws a batch of balls (ball_sim.hpp), each
+   released with its own random velocity error, and the score is the
+   fraction caught every time. Beside it is the fraction held, back in the
+   hand at the end even if it bounced there. Ball 0 has no error, and
+   nominal says whether it is caught every time. Every candidate gets the
+   same errors, so candidates are compared on the same throws. Candidates
+   and batches of balls are spread over all cores (work_pool.hpp).
+
+   Candidates can be:
+       height=H             a level 1 plan for a ball height of H m
+       name.traj            a trajectory file
+       position.txt,velocity.txt
+                            position and velocity tables, as dc_motor runs
+       name.bin[:run]       the measured motion in a telemetry file (run 1
+                            by default), e.g. from sim_throw or the robot
+
+   Usage: ./catch_score [--balls N] [--throw-sigma M/S] [--aim-sigma M/S]
+                        [--catch-tolerance F] [--throw-tolerance F]
+                        [--restitution E] [--threads N] [--seed S]
+                        candidate ...
+
+   --throw-sigma and --aim-sigma are the standard deviations of the
+   release velocity error along and across the hand's travel. One CSV
+   line per candidate goes to stdout, and the time taken to stderr.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <random>
+#include "ball_sim.hpp"
+#include "path_planner.hpp"
+#include "trajectory_file.hpp"
+#include "work_pool.hpp"
+
+// Hand tracks from plans and telemetry are sampled at this rate, as the
+// exported tables are.
+#define CATCH_SAMPLE_RATE_HZ 1000
+
+// Planned paths cover one throw and catch, as path_plan's do
+#define CATCH_SIMULATION_TIME 2.0
+
+// Balls per job
+#define CATCH_CHUNK 1024
+
+#define CATCH_DEFAULT_BALLS 1000
+#define CATCH_DEFAULT_THROW_SIGMA 0.02
+#define CATCH_DEFAULT_AIM_SIGMA 0.02
+
+using namespace std;
+
+// Counts over one chunk of balls
+struct chunk_result {
+	uint32_t caught;
+	uint32_t held;
+	uint32_t dropped;
+	uint32_t flying;
+	uint64_t throws;
+	uint64_t bounces;
+	double catch_speed;
+	bool nominal;
+};
+
+class score_job
+{
+public:
+
+	score_job(const ball_sim_params& params, const vector<hand_track>& tracks,
+	          const vector<double>& error_x, const vector<double>& error_y, vector<chunk_result>& results)
+		: params(params), tracks(tracks), error_x(error_x), error_y(error_y), results(results)
+	{
+		chunks = (uint32_t) ((error_y.size() + CATCH_CHUNK - 1) / CATCH_CHUNK);
+	}
+
+	uint32_t jobs() const
+	{
+		return(chunks * (uint32_t) tracks.size());
+	}
+
+	void operator()(uint32_t index, int worker)
+	{
+		const hand_track& track = tracks[index / chunks];
+		uint32_t first = (index % chunks) * CATCH_CHUNK;
+		uint32_t count = (uint32_t) error_y.size() - first;
+		count = (count > CATCH_CHUNK) ? CATCH_CHUNK : count;
+
+		ball_batch balls;
+		balls.resize(count);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			balls.throw_error_x[i] = error_x[first + i];
+			balls.throw_error_y[i] = error_y[first + i];
+		}
+		balls.reset(track);
+		simulate_balls(params, track, balls);
+
+		chunk_result& result = results[index];
+		memset(&result, 0, sizeof(result));
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (balls.caught_every_throw(i))
+			{
+				result.caught++;
+				result.catch_speed += balls.catch_speed[i];
+			}
+			if (balls.state[i] == BALL_HELD)
+				result.held++;
+			if (balls.state[i] == BALL_DROPPED)
+				result.dropped++;
+			if (balls.state[i] == BALL_FLYING)
+				result.flying++;
+			result.throws += balls.throws[i];
+			result.bounces += balls.bounces[i];
+		}
+		result.nominal = (first == 0) && balls.caught_every_throw(0);
+	}
+
+private:
+	const ball_sim_params& params;
+	const vector<hand_track>& tracks;
+	const vector<double>& error_x;
+	const vector<double>& error_y;
+	vector<chunk_result>& results;
+	uint32_t chunks;
+};
+
+static void print_usage(const char* name)
+{
+	printf("Usage: %s [--balls N] [--throw-sigma M/S] [--aim-sigma M/S] [--catch-tolerance F]\n"
+	       "       [--throw-tolerance F] [--restitution E] [--threads N] [--seed S] candidate ...\n"
+	       "Candidates: height=H, name.traj, position.txt,velocity.txt or telemetry.bin[:run]\n", name);
+}
+
+// Read one value per line
+static int read_column(string filename, vector<double>& values)
+{
+	ifstream myfile(filename.c_str());
+	if (!myfile.is_open())
+	{
+		printf("%s failed to open.\n", filename.c_str());
+		return(1);
+	}
+
+	string line;
+	while (getline(myfile, line))
+	{
+		if (line.empty())
+			continue;
+		values.push_back(atof(line.c_str()));
+	}
+	myfile.close();
+	return(0);
+}
+
+// Build the hand track for one candidate. Returns 0 on success.
+static int load_candidate(string candidate, hand_track& track)
+{
+	if (candidate.compare(0, 7, "height=") == 0)
+	{
+		planner_params params;
+		params.ball_trajectory_height = atof(candidate.c_str() + 7);
+		level1_plan plan;
+		if (plan_level1(params, CATCH_SIMULATION_TIME, plan))
+			return(1);
+		hand_track_from_paths(plan.x, plan.y, CATCH_SAMPLE_RATE_HZ, track);
+		return(0);
+	}
+
+	if (is_trajectory_file(candidate))
+	{
+		const trajectory_file* traj = load_trajectory(candidate);
+		if (!traj)
+			return(1);
+		hand_track_from_tables(traj->position, traj->velocity, traj->acceleration,
+		                       traj->header.sample_rate_hz, 0, track);
+		return(0);
+	}
+
+	size_t comma = candidate.find(',');
+	if (comma != string::npos)
+	{
+		vector<double> position;
+		vector<double> velocity;
+		if (read_column(candidate.substr(0, comma), position) || read_column(candidate.substr(comma + 1), velocity))
+			return(1);
+		hand_track_from_tables(path_view(position.data(), position.size()), path_view(velocity.data(), velocity.size()),
+		                       path_view(), 1000, 0, track);
+		return(0);
+	}
+
+	size_t colon = candidate.rfind(':');
+	string filename = candidate;
+	int run = 1;
+	if ((colon != string::npos) && (colon > candidate.rfind(".bin")))
+	{
+		filename = candidate.substr(0, colon);
+		run = atoi(candidate.c_str() + colon + 1);
+	}
+	if ((filename.size() > 4) && (filename.compare(filename.size() - 4, 4, ".bin") == 0))
+		return(hand_track_from_telemetry(filename, run, 0, CATCH_SAMPLE_RATE_HZ, track));
+
+	printf("Do not know what %s is.\n", candidate.c_str());
+	return(1);
+}
+
+static double wall_ms()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return(ts.tv_sec*1000.0 + ts.tv_nsec/1000000.0);
+}
+
+int main(int argc, char *argv[])
+{
+	ball_sim_params params;
+	uint32_t balls = CATCH_DEFAULT_BALLS;
+	double throw_sigma = CATCH_DEFAULT_THROW_SIGMA;
+	double aim_sigma = CATCH_DEFAULT_AIM_SIGMA;
+	int threads = 0;
+	uint64_t seed = 1;
+	vector<string> candidates;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool value = (i + 1 < argc);
+		if ((strcmp(argv[i], "--balls") == 0) && value)
+			balls = atoi(argv[++i]);
+		else if ((strcmp(argv[i], "--throw-sigma") == 0) && value)
+			throw_sigma = atof(argv[++i]);
+		else if ((strcmp(argv[i], "--aim-sigma") == 0) && value)
+			aim_sigma = atof(argv[++i]);
+		else if ((strcmp(argv[i], "--catch-tolerance") == 0) && value)
+			params.catch_tolerance = atof(argv[++i]);
+		else if ((strcmp(argv[i], "--throw-tolerance") == 0) && value)
+			params.throw_tolerance = atof(argv[++i]);
+		else if ((strcmp(argv[i], "--restitution") == 0) && value)
+			params.restitution = atof(argv[++i]);
+		else if ((strcmp(argv[i], "--threads") == 0) && value)
+			threads = atoi(argv[++i]);
+		else if ((strcmp(argv[i], "--seed") == 0) && value)
+			seed = strtoull(argv[++i], NULL, 10);
+		else if (argv[i][0] == '-')
+		{
+			print_usage(argv[0]);
+			return 1;
+		}
+		else
+			candidates.push_back(argv[i]);
+	}
+	if (candidates.empty() || (balls == 0))
+	{
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	vector<hand_track> tracks(candidates.size());
+	for (unsigned c = 0; c < candidates.size(); c++)
+	{
+		if (load_candidate(candidates[c], tracks[c]))
+			return 1;
+	}
+
+	// The same throw errors for every candidate. Ball 0 is a perfect throw.
+	vector<double> error_x(balls, 0);
+	vector<double> error_y(balls, 0);
+	mt19937_64 random(seed);
+	normal_distribution<double> aim(0, aim_sigma);
+	normal_distribution<double> speed(0, throw_sigma);
+	for (uint32_t i = 1; i < balls; i++)
+	{
+		error_x[i] = (aim_sigma > 0) ? aim(random) : 0;
+		error_y[i] = (throw_sigma > 0) ? speed(random) : 0;
+	}
+
+	vector<chunk_result> results;
+	score_job job(params, tracks, error_x, error_y, results);
+	results.resize(job.jobs());
+	work_pool pool(threads);
+	double start = wall_ms();
+	pool.run(job.jobs(), job);
+	double elapsed = wall_ms() - start;
+
+	printf("candidate,duration,nominal,caught,held,dropped,in_air,releases_per_ball,bounces_per_ball,catch_speed\n");
+	uint32_t per_track = job.jobs() / (uint32_t) tracks.size();
+	for (unsigned c = 0; c < candidates.size(); c++)
+	{
+		chunk_result total;
+		memset(&total, 0, sizeof(total));
+		for (uint32_t k = 0; k < per_track; k++)
+		{
+			const chunk_result& r = results[c*per_track + k];
+			total.caught += r.caught;
+			total.held += r.held;
+			total.dropped += r.dropped;
+			total.flying += r.flying;
+			total.throws += r.throws;
+			total.bounces += r.bounces;
+			total.catch_speed += r.catch_speed;
+			total.nominal = total.nominal || r.nominal;
+		}
+		printf("%s,%.3f,%d,%.4f,%.4f,%.4f,%.4f,%.3f,%.3f,%.4f\n", candidates[c].c_str(), tracks[c].duration(),
+		       total.nominal ? 1 : 0, (double) total.caught/balls, (double) total.held/balls, (double) total.dropped/balls,
+		       (double) total.flying/balls, (double) total.throws/balls, (double) total.bounces/balls,
+		       total.caught ? total.catch_speed/total.caught : 0.0);
+	}
+
+	uint64_t ball_steps = 0;
+	for (unsigned c = 0; c < tracks.size(); c++)
+		ball_steps += (uint64_t) tracks[c].size() * balls;
+	fprintf(stderr, "%u candidates x %u balls in %.1f ms on %d threads (%.1f ns per ball step)\n",
+	        (unsigned) candidates.size(), balls, elapsed, pool.size(), (ball_steps > 0) ? elapsed*1e6/ball_steps : 0.0);
+	return 0;
+}
@@ -0,0 +1,446 @@
+/* control_loop.hpp
+
+   Created 10/16/2026
+
+   This is the header file for the control_loop class template and the
+   policies it is built from.
+
+   Every dc_motor run mode does the same thing each control period: get a
+   setpoint, read the encoder, compute a control effort, drive the motor,
+   record the iteration and check the workspace. Only three parts change
+   between modes, and each one is a policy class chosen at compile time:
+
+   Control law: turns a setpoint and the measured state into a control
+   effort (signed PWM duty cycle, before clipping).
+       double effort(const setpoint& sp, const axis_state& state) const;
+       static const bool uses_velocity;   // reads the encoder velocity
+       static const int workspace_margin; // counts allowed past the workspace
+       static const bool abort_outside_workspace;
+
+   Trajectory source: gives the setpoint for a tick, or false when the
+   run is over. Path sources are built with the motor's lookahead: the
+   setpoint is the path at the tick, and its feedforward velocity is the
+   path velocity the lookahead later, when the output actually takes
+   effect. Only the feedforward acts on that; the feedback, tracking error
+   and telemetry compare the axis with where the path is now.
+       bool sample(uint64_t now_tick, setpoint& sp);
+       static const bool has_velocity;    // a path: feeds the latency
+                                          // estimate and tracking error
+
+   Telemetry sink: what to do with each iteration.
+       void record(dc_motor& motor, uint64_t tick, const setpoint& sp,
+                   const axis_state& state, double effort, int duty_cycle);
+       static const bool enabled;
+
+   Everything is inlined into one loop per mode with no virtual calls, and
+   branches a policy does not need (such as reading the encoder velocity
+   for an open loop run with no telemetry) are compiled out. A new control
+   mode is a new policy, not another copy of the loop.
+
+   When the motor has an event recorder, each period also notes the alert
+   sequence (event_log.hpp) its encoder and limit state was read at, so
+   event_replay can give it exactly the same alerts.
+*/
+
+#ifndef __CONTROL_LOOP_HPP__
+#define __CONTROL_LOOP_HPP__
+
+#include <stdint.h>
+#include <stdio.h>
+#include "dc_motor.hpp"
+#include "mono_clock.hpp"
+#include "event_log.hpp"
+
+// Desired position (m) and velocity (m/s) for one control period, and
+// the velocity to feed forward (m/s)
+struct setpoint {
+	double position;
+	double velocity;
+	double ff_velocity;
+};
+
+// Measured position (m) and velocity (m/s), the alert sequence they were
+// read at, and whether an alert ran while they were read
+struct axis_state {
+	double position;
+	double velocity;
+	uint32_t alert_sequence;
+	bool alert_race;
+};
+
+//*****************************************
+// Control laws
+//*****************************************
+
+// Open loop: velocity times the PWM constant.
+class ol_law
+{
+public:
+	static const bool uses_velocity = false;
+	static const int workspace_margin = 0;
+	static const bool abort_outside_workspace = true;
+
+	ol_law(const dc_motor& motor)
+	{
+		gain = motor.dir_factor * motor.pwm_constant;
+	}
+
+	double effort(const setpoint& sp, const axis_state& state) const
+	{
+		return(gain * sp.ff_velocity);
+	}
+
+private:
+	double gain;
+};
+
+// PD-Feedforward: velocity and friction feedforward plus PD on the path
+// error.
+class pdff_law
+{
+public:
+	static const bool uses_velocity = true;
+	static const int workspace_margin = 150;
+	static const bool abort_outside_workspace = true;
+
+	pdff_law(const dc_motor& motor)
+	{
+		kff = motor.velocity_ff_constant;
+		kp = motor.proportional_constant;
+		kd = motor.derivative_constant;
+		friction_up = motor.friction_up_ff;
+		friction_down = motor.friction_down_ff;
+		dir = motor.dir_factor;
+	}
+
+	double effort(const setpoint& sp, const axis_state& state) const
+	{
+		double friction = (sp.ff_velocity > 0) ? friction_up : ((sp.ff_velocity < 0) ? -friction_down : 0);
+		return(dir * (kff*sp.ff_velocity + friction + kp*(sp.position - state.position) + kd*(sp.velocity - state.velocity)));
+	}
+
+private:
+	double kff;
+	double kp;
+	double kd;
+	double friction_up;
+	double friction_down;
+	int dir;
+};
+
+// CV tracking: proportional on the position error from the kinect. Going
+// past the workspace stops the motor but keeps tracking.
+class cv_law
+{
+public:
+	static const bool uses_velocity = false;
+	static const int workspace_margin = 50;
+	static const bool abort_outside_workspace = false;
+
+	cv_law(const dc_motor& motor)
+	{
+		kp = motor.kinect_constant;
+		dir = motor.dir_factor;
+	}
+
+	double effort(const setpoint& sp, const axis_state& state) const
+	{
+		return(dir * (kp*(sp.position - state.position) - 50));
+	}
+
+private:
+	double kp;
+	int dir;
+};
+
+//*****************************************
+// Trajectory sources
+//*****************************************
+
+// Precomputed paths, one sample per millisecond since start_tick,
+// interpolated to the microsecond. The position path may be empty (open
+// loop), in which case it reads as zero. The feedforward looks
+// lookahead_us further on, holding the last sample past the end.
+class table_trajectory
+{
+public:
+	static const bool has_velocity = true;
+
+	table_trajectory(const path_view& velocity, const path_view& position, uint64_t start_tick, int lookahead_us = 0)
+	{
+		this->velocity = velocity;
+		this->position = position;
+		this->start_tick = start_tick;
+		this->lookahead_us = lookahead_us;
+
+		// Stop one short of the end, as the original loops did.
+		end_millis = velocity.empty() ? 0 : (velocity.size() - 1);
+		if (!position.empty() && (position.size() - 1 < end_millis))
+			end_millis = position.size() - 1;
+	}
+
+	bool sample(uint64_t now_tick, setpoint& sp)
+	{
+		uint64_t elapsed_us = now_tick - start_tick;
+		if (elapsed_us/1000 >= end_millis)
+			return(false);
+
+		sp.velocity = this->interpolate(velocity, elapsed_us);
+		sp.position = 0;
+		if (!position.empty())
+			sp.position = this->interpolate(position, elapsed_us);
+		sp.ff_velocity = sp.velocity;
+		if (lookahead_us > 0)
+			sp.ff_velocity = this->interpolate(velocity, elapsed_us + lookahead_us);
+		return(true);
+	}
+
+private:
+	path_view velocity;
+	path_view position;
+	uint64_t start_tick;
+	int lookahead_us;
+	uint32_t end_millis;
+
+	// A path elapsed_us in, or its last sample used past end_millis. Below
+	// end_millis (at most size - 1) the next sample is always there.
+	double interpolate(const path_view& path, uint64_t elapsed_us) const
+	{
+		uint64_t current_time_millis = elapsed_us/1000;
+		if (current_time_millis >= end_millis)
+			return(path[end_millis]);
+
+		double fraction = (elapsed_us % 1000)*0.001;
+		return(path[current_time_millis] + fraction*(path[current_time_millis + 1] - path[current_time_millis]));
+	}
+};
+
+// Polynomial segments (path_planner.hpp), evaluated at the exact tick
+// instead of the last whole millisecond. The cursor belongs to the motor
+// so it keeps its place between control periods. The motor's path_slot
+// hands it any newly staged path first. The feedforward is evaluated
+// lookahead_us further on by a copy of the cursor, and is zero once that
+// is past the end of the path, which ends at rest. Given a telemetry
+// channel, the period that starts each loop cycle is marked in it before
+// it is recorded.
+class segment_trajectory
+{
+public:
+	static const bool has_velocity = true;
+
+	segment_trajectory(path_cursor* cursor, path_slot* slot, uint64_t start_tick, int lookahead_us = 0,
+	                   telemetry_channel* cycle_marks = NULL)
+	{
+		this->cursor = cursor;
+		this->slot = slot;
+		this->start_tick = start_tick;
+		this->lookahead_us = lookahead_us;
+		this->cycle_marks = cycle_marks;
+	}
+
+	bool sample(uint64_t now_tick, setpoint& sp)
+	{
+		slot->service(*cursor);
+
+		path_point point;
+		double t = (now_tick - start_tick)*1e-6;
+		uint32_t cycles = cursor->cycles_started();
+		if (!(cursor->evaluate(t, point)))
+			return(false);
+		if (cycle_marks && (cursor->cycles_started() != cycles))
+			cycle_marks->mark_cycle_start();
+
+		sp.position = point.d;
+		sp.velocity = point.v;
+		sp.ff_velocity = point.v;
+		if (lookahead_us > 0)
+		{
+			path_cursor ahead = *cursor;
+			sp.ff_velocity = ahead.evaluate(t + lookahead_us*1e-6, point) ? point.v : 0;
+		}
+		return(true);
+	}
+
+private:
+	path_cursor* cursor;
+	path_slot* slot;
+	uint64_t start_tick;
+	int lookahead_us;
+	telemetry_channel* cycle_marks;
+};
+
+// Latest kinect command for an X axis, until tracking stops or the timeout.
+// A command outside [min_position, max_position] ends the run. The first
+// period to act on each new command adds it to the delay statistics.
+class cv_target
+{
+public:
+	static const bool has_velocity = false;
+
+	cv_target(udp_connection* comm, motor_axis axis, uint64_t timeout_tick, double min_position, double max_position, cv_delay_stats* delay)
+	{
+		this->comm = comm;
+		this->axis = axis;
+		this->timeout_tick = timeout_tick;
+		this->min_position = min_position;
+		this->max_position = max_position;
+		this->delay = delay;
+		last_sequence = 0;
+	}
+
+	bool sample(uint64_t now_tick, setpoint& sp)
+	{
+		cv_command command;
+		if ((now_tick >= timeout_tick) || !(comm->get_command(command)))
+			return(false);
+
+		sp.position = (axis == RX) ? command.RX : command.LX;
+		sp.velocity = 0;
+		if (command.has_velocity)
+			sp.velocity = (axis == RX) ? command.RX_velocity : command.LX_velocity;
+		sp.ff_velocity = sp.velocity;
+
+		if ((sp.position > max_position) || (sp.position < min_position))
+		{
+			printf("CV command is: %f This is past the workspace. Aborting.\n", sp.position);
+			return(false);
+		}
+
+		if (command.sequence != last_sequence)
+		{
+			last_sequence = command.sequence;
+			delay->add(command, now_tick);
+		}
+		return(true);
+	}
+
+private:
+	udp_connection* comm;
+	motor_axis axis;
+	uint64_t timeout_tick;
+	double min_position;
+	double max_position;
+	cv_delay_stats* delay;
+	uint32_t last_sequence;
+};
+
+//*****************************************
+// Telemetry sinks
+//*****************************************
+
+// Record every iteration to the motor's telemetry channel.
+class telemetry_sink
+{
+public:
+	static const bool enabled = true;
+
+	void record(dc_motor& motor, uint64_t tick, const setpoint& sp, const axis_state& state, double effort, int duty_cycle)
+	{
+		motor.record_telemetry(tick, sp.position, sp.velocity, state.position, state.velocity, effort, duty_cycle,
+		                       state.alert_sequence, state.alert_race);
+	}
+};
+
+// Record nothing.
+class null_sink
+{
+public:
+	static const bool enabled = false;
+
+	void record(dc_motor& motor, uint64_t tick, const setpoint& sp, const axis_state& state, double effort, int duty_cycle)
+	{
+	}
+};
+
+//*****************************************
+// The loop
+//*****************************************
+
+template <class ControlLaw, class TrajectorySource, class TelemetrySink>
+class control_loop
+{
+public:
+
+	control_loop(dc_motor& motor, const ControlLaw& law, const TrajectorySource& source, const TelemetrySink& sink = TelemetrySink())
+		: motor(motor), law(law), source(source), sink(sink)
+	{
+	}
+
+	// One control period at now_tick. Returns false when the run is over.
+	bool step(uint64_t now_tick)
+	{
+		event_recorder* recorder = motor.recorder;
+		uint32_t alerts = recorder ? recorder->alert_sequence() : 0;
+
+		if (motor.limit_latch)
+			return(false);
+
+		setpoint sp;
+		if (!(source.sample(now_tick, sp)))
+			return(false);
+
+		// Get current position and velocity from encoders (m/s, m)
+		int count = motor.encoder->getCount();
+		axis_state state;
+		state.position = count/motor.count_per_meter;
+		state.velocity = 0;
+		if (ControlLaw::uses_velocity || TelemetrySink::enabled || TrajectorySource::has_velocity)
+			state.velocity = (motor.encoder->getCPS())/motor.count_per_meter;
+		state.alert_sequence = alerts;
+		state.alert_race = recorder && ((alerts & 1) || (recorder->alert_sequence_after() != alerts));
+
+		double effort = law.effort(sp, state);
+		int duty_cycle = motor.drive(effort);
+
+		if (TrajectorySource::has_velocity)
+		{
+			motor.latency.add(now_tick, sp.ff_velocity, state.velocity);
+			motor.tracking.add(sp.position - state.position);
+		}
+
+		if (TelemetrySink::enabled)
+			sink.record(motor, now_tick, sp, state, effort, duty_cycle);
+
+		if ((count > (ControlLaw::workspace_margin + motor.workspace_width_count)) || (count < (-50)))
+		{
+			printf("Encoder Count: %d ", count);
+			printf("Motor went past workspace. %s\n", ControlLaw::abort_outside_workspace ? "Aborting." : "Skipping.");
+			motor.stop();
+			return(!ControlLaw::abort_outside_workspace);
+		}
+		return(true);
+	}
+
+	// Sleep until start_tick, then step once per control period of the
+	// motor's loop_timer until the run is over.
+	void run(uint64_t start_tick)
+	{
+		// Sleep until the start, then line up exactly on the tick.
+		motor.loop_timer.start_at(start_tick);
+		while(mono_tick() < start_tick)
+			; // Do Nothing
+
+		while (true)
+		{
+			// Wait for the start of this control period
+			motor.loop_timer.wait_next();
+			if (!(this->step(mono_tick())))
+				break;
+		}
+	}
+
+private:
+	dc_motor& motor;
+	ControlLaw law;
+	TrajectorySource source;
+	TelemetrySink sink;
+};
+
+// The dc_motor run modes
+typedef control_loop<ol_law, table_trajectory, telemetry_sink> ol_loop;
+typedef control_loop<pdff_law, table_trajectory, telemetry_sink> pdff_loop;
+typedef control_loop<ol_law, segment_trajectory, telemetry_sink> ol_segment_loop;
+typedef control_loop<pdff_law, segment_trajectory, telemetry_sink> pdff_segment_loop;
+typedef control_loop<cv_law, cv_target, telemetry_sink> cv_loop;
+
+#endif
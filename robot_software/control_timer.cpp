@@ -0,0 +1,200 @@
+/* control_timer.cpp
+
+   Created 10/16/2026
+
+   This is the cpp file holding the function definitions for the
+   control_timer class. See control_timer.hpp.
+*/
+
+#include <stdio.h>
+#include "control_timer.hpp"
+#include "mono_clock.hpp"
+#include "hal.hpp"
+
+using namespace std;
+
+// Default Constructor
+control_timer::control_timer()
+{
+	this->set_rate(DEFAULT_CONTROL_RATE_HZ);
+	next_ns = 0;
+	last_wake_ns = 0;
+	iterations = 0;
+	deadline_misses = 0;
+	skipped_periods = 0;
+	period_sum_us = 0;
+	max_period = 0;
+	jitter_sum_us = 0;
+	max_jitter = 0;
+	this->reset_window();
+}
+
+// Constructor
+control_timer::control_timer(int rate_hz)
+{
+	this->set_rate(rate_hz);
+	next_ns = 0;
+	last_wake_ns = 0;
+	iterations = 0;
+	deadline_misses = 0;
+	skipped_periods = 0;
+	period_sum_us = 0;
+	max_period = 0;
+	jitter_sum_us = 0;
+	max_jitter = 0;
+	this->reset_window();
+}
+
+void control_timer::set_rate(int rate_hz)
+{
+	if (rate_hz <= 0)
+	{
+		printf("Invalid control rate %d Hz. Using %d Hz.\n", rate_hz, DEFAULT_CONTROL_RATE_HZ);
+		rate_hz = DEFAULT_CONTROL_RATE_HZ;
+	}
+	rate = rate_hz;
+	period_ns = 1000000000LL / rate_hz;
+}
+
+int control_timer::get_rate()
+{
+	return(rate);
+}
+
+double control_timer::period_us()
+{
+	return(period_ns / 1000.0);
+}
+
+int64_t control_timer::now_ns()
+{
+	return(hal_time_ns());
+}
+
+void control_timer::start_at(uint64_t start_tick)
+{
+	// The start tick is on the pigpio clock, the deadlines are on
+	// hal_time_ns() (CLOCK_MONOTONIC). Both count real microseconds, so
+	// carry the offset over.
+	uint64_t tick_now = mono_tick();
+	int64_t start_ns = now_ns();
+	if (start_tick > tick_now)
+		start_ns += ((int64_t) (start_tick - tick_now)) * 1000;
+
+	next_ns = start_ns;
+	last_wake_ns = 0;
+	iterations = 0;
+	deadline_misses = 0;
+	skipped_periods = 0;
+	period_sum_us = 0;
+	max_period = 0;
+	jitter_sum_us = 0;
+	max_jitter = 0;
+	this->reset_window();
+
+	hal_sleep_until_ns(start_ns);
+}
+
+void control_timer::wait_next()
+{
+	int64_t now = now_ns();
+
+	// The first call comes straight after start_at(), which has already
+	// slept until the first deadline, so it always finds the clock a little
+	// past it. Waking late is only a miss there if a whole period went by.
+	bool late = (now > next_ns);
+	if (late && (iterations == 0))
+		late = ((now - next_ns) >= period_ns);
+
+	if (late)
+	{
+		// The last iteration ran past the end of its period. Do not try to
+		// catch up with a burst of back-to-back iterations, just skip any
+		// whole periods it took.
+		deadline_misses++;
+		window.deadline_misses++;
+		int64_t behind = (now - next_ns) / period_ns;
+		if (behind >= 1)
+		{
+			skipped_periods += behind;
+			window.skipped_periods += behind;
+			next_ns += behind * period_ns;
+		}
+	}
+	else if (now < next_ns)
+	{
+		hal_sleep_until_ns(next_ns);
+		now = now_ns();
+	}
+
+	// Jitter is how late we woke up relative to the deadline.
+	double jitter = (now - next_ns) / 1000.0;
+	jitter_sum_us += jitter;
+	if (jitter > max_jitter)
+		max_jitter = jitter;
+	window_jitter_sum_us += jitter;
+	if (jitter > window.max_jitter_us)
+		window.max_jitter_us = jitter;
+
+	if (last_wake_ns)
+	{
+		double period = (now - last_wake_ns) / 1000.0;
+		period_sum_us += period;
+		if (period > max_period)
+			max_period = period;
+		window_period_sum_us += period;
+		if (period > window.max_period_us)
+			window.max_period_us = period;
+	}
+	last_wake_ns = now;
+	iterations++;
+	window.iterations++;
+
+	next_ns += period_ns;
+}
+
+control_loop_stats control_timer::get_stats()
+{
+	control_loop_stats stats;
+	stats.iterations = iterations;
+	stats.deadline_misses = deadline_misses;
+	stats.skipped_periods = skipped_periods;
+	stats.mean_period_us = (iterations > 1) ? (period_sum_us / (iterations - 1)) : 0;
+	stats.max_period_us = max_period;
+	stats.mean_jitter_us = (iterations > 0) ? (jitter_sum_us / iterations) : 0;
+	stats.max_jitter_us = max_jitter;
+	return(stats);
+}
+
+void control_timer::reset_window()
+{
+	window.iterations = 0;
+	window.deadline_misses = 0;
+	window.skipped_periods = 0;
+	window.mean_period_us = 0;
+	window.max_period_us = 0;
+	window.mean_jitter_us = 0;
+	window.max_jitter_us = 0;
+	window_period_sum_us = 0;
+	window_jitter_sum_us = 0;
+}
+
+control_loop_stats control_timer::take_window_stats()
+{
+	control_loop_stats stats = window;
+	stats.mean_period_us = (window.iterations > 0) ? (window_period_sum_us / window.iterations) : 0;
+	stats.mean_jitter_us = (window.iterations > 0) ? (window_jitter_sum_us / window.iterations) : 0;
+	this->reset_window();
+	return(stats);
+}
+
+void control_timer::print_stats(string name)
+{
+	control_loop_stats stats = this->get_stats();
+	printf("%s control loop: %llu iterations at %d Hz, mean period %.1f us (max %.1f us), "
+	       "mean jitter %.1f us (max %.1f us), %llu deadline misses, %llu skipped periods\n",
+	       name.c_str(), (unsigned long long) stats.iterations, rate,
+	       stats.mean_period_us, stats.max_period_us,
+	       stats.mean_jitter_us, stats.max_jitter_us,
+	       (unsigned long long) stats.deadline_misses, (unsigned long long) stats.skipped_periods);
+}
@@ -0,0 +1,108 @@
+/* control_timer.hpp
+
+   Created 10/16/2026
+
+   This is the header file for the control_timer class.
+
+   A control_timer runs a control loop at a fixed rate. Instead of spinning
+   as fast as possible, the loop calls wait_next() once per iteration, which
+   sleeps until the absolute start of the next period with clock_nanosleep.
+   Using absolute deadlines means time spent in the control law does not
+   push the schedule back, and the core is free for the encoder alert thread
+   and the UDP listener while the loop sleeps.
+
+   The timer also keeps statistics for the loop: measured period, wake-up
+   jitter (how late after the deadline we actually woke up) and deadline
+   misses (iterations that ran past the end of their period).
+*/
+
+#ifndef __CONTROL_TIMER_HPP__
+#define __CONTROL_TIMER_HPP__
+
+#include <stdint.h>
+#include <string>
+
+// Default control loop rate
+#define DEFAULT_CONTROL_RATE_HZ 2000
+
+// Statistics for one run of a control loop
+struct control_loop_stats {
+	uint64_t iterations;
+	uint64_t deadline_misses;
+	uint64_t skipped_periods;
+	double mean_period_us;
+	double max_period_us;
+	double mean_jitter_us;
+	double max_jitter_us;
+};
+
+class control_timer
+{
+public:
+
+	// Default Constructor
+	control_timer();
+
+	// Constructor
+	control_timer(int rate_hz);
+
+	// Set loop rate. Takes effect on the next start_at().
+	void set_rate(int rate_hz);
+
+	// Loop rate in Hz
+	int get_rate();
+
+	// Period in microseconds
+	double period_us();
+
+	// Sleep until start_tick (a mono_clock tick), then make that the
+	// deadline of the first period. Resets the statistics.
+	void start_at(uint64_t start_tick);
+
+	// Sleep until the start of the next period. The first call after
+	// start_at() is only a miss if it comes a whole period late.
+	void wait_next();
+
+	// Get the statistics since start_at()
+	control_loop_stats get_stats();
+
+	// Get the statistics since the last call (or start_at()) and start a
+	// new window. Used for per-cycle statistics in long runs.
+	control_loop_stats take_window_stats();
+
+	// Print the statistics with a name in front
+	void print_stats(std::string name);
+
+private:
+
+	// Nanoseconds on CLOCK_MONOTONIC
+	static int64_t now_ns();
+
+	int rate;
+	int64_t period_ns;
+
+	// Deadline of the next period (CLOCK_MONOTONIC ns)
+	int64_t next_ns;
+
+	// Wake time of the previous period
+	int64_t last_wake_ns;
+
+	// Running statistics
+	uint64_t iterations;
+	uint64_t deadline_misses;
+	uint64_t skipped_periods;
+	double period_sum_us;
+	double max_period;
+	double jitter_sum_us;
+	double max_jitter;
+
+	// The same, since the last take_window_stats()
+	control_loop_stats window;
+	double window_period_sum_us;
+	double window_jitter_sum_us;
+
+	// Clear the window
+	void reset_window();
+};
+
+#endif
@@ -0,0 +1,112 @@
+/* cv_protocol.cpp
+
+   Created 10/16/2026
+
+   This is the cpp file holding the function definitions for the binary CV
+   command protocol. See cv_protocol.hpp.
+*/
+
+#include <string.h>
+#include "cv_protocol.hpp"
+
+using namespace std;
+
+// Fields are packed byte by byte so the layout does not depend on the
+// compiler's struct padding or the host byte order.
+static void put_u32(unsigned char* p, uint32_t value)
+{
+	for (int i = 0; i < 4; i++)
+		p[i] = (unsigned char) (value >> (8*i));
+}
+
+static void put_u64(unsigned char* p, uint64_t value)
+{
+	for (int i = 0; i < 8; i++)
+		p[i] = (unsigned char) (value >> (8*i));
+}
+
+static void put_float(unsigned char* p, float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	put_u32(p, bits);
+}
+
+static uint32_t get_u32(const unsigned char* p)
+{
+	uint32_t value = 0;
+	for (int i = 3; i >= 0; i--)
+		value = (value << 8) | p[i];
+	return(value);
+}
+
+static uint64_t get_u64(const unsigned char* p)
+{
+	uint64_t value = 0;
+	for (int i = 7; i >= 0; i--)
+		value = (value << 8) | p[i];
+	return(value);
+}
+
+static float get_float(const unsigned char* p)
+{
+	uint32_t bits = get_u32(p);
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return(value);
+}
+
+bool is_cv_message(const char* buf, int length)
+{
+	return((length > 0) && ((unsigned char) buf[0] == CV_MESSAGE_MAGIC));
+}
+
+int decode_cv_message(const char* buf, int length, cv_message& message)
+{
+	const unsigned char* p = (const unsigned char*) buf;
+	if ((length < CV_MESSAGE_SIZE) || (p[0] != CV_MESSAGE_MAGIC) || (p[1] != CV_PROTOCOL_VERSION))
+		return(1);
+	if ((p[2] != CV_MESSAGE_X_COMMAND) && (p[2] != CV_MESSAGE_BALL))
+		return(1);
+
+	memset(&message, 0, sizeof(message));
+	message.type = p[2];
+	message.flags = p[3];
+	message.sequence = get_u32(p + 4);
+	message.sender_tick = get_u64(p + 8);
+	if (message.type == CV_MESSAGE_BALL)
+	{
+		message.ball_x = get_float(p + 16);
+		message.ball_y = get_float(p + 20);
+		return(0);
+	}
+	message.LX = get_float(p + 16);
+	message.RX = get_float(p + 20);
+	message.LX_velocity = get_float(p + 24);
+	message.RX_velocity = get_float(p + 28);
+	return(0);
+}
+
+int encode_cv_message(const cv_message& message, char* buf)
+{
+	unsigned char* p = (unsigned char*) buf;
+	p[0] = CV_MESSAGE_MAGIC;
+	p[1] = CV_PROTOCOL_VERSION;
+	p[2] = message.type;
+	p[3] = message.flags;
+	put_u32(p + 4, message.sequence);
+	put_u64(p + 8, message.sender_tick);
+	if (message.type == CV_MESSAGE_BALL)
+	{
+		put_float(p + 16, message.ball_x);
+		put_float(p + 20, message.ball_y);
+		put_float(p + 24, 0);
+		put_float(p + 28, 0);
+		return(CV_MESSAGE_SIZE);
+	}
+	put_float(p + 16, message.LX);
+	put_float(p + 20, message.RX);
+	put_float(p + 24, message.LX_velocity);
+	put_float(p + 28, message.RX_velocity);
+	return(CV_MESSAGE_SIZE);
+}
@@ -0,0 +1,78 @@
+/* cv_protocol.hpp
+
+   Created 10/16/2026
+
+   This is the header file for the binary CV command protocol.
+
+   Besides the text commands ("R0.125 L0.02"), the CV computer can send
+   fixed size binary messages. They are cheaper to parse, and carry a
+   sequence number and the sender's timestamp so the robot can drop
+   repeated, reordered and late datagrams and measure the delay.
+
+   Layout, 32 bytes, little endian:
+       0   uint8   CV_MESSAGE_MAGIC (never a text command character)
+       1   uint8   version (CV_PROTOCOL_VERSION)
+       2   uint8   message type (CV_MESSAGE_X_COMMAND or CV_MESSAGE_BALL)
+       3   uint8   flags (CV_HAS_LX, CV_HAS_RX, CV_HAS_VELOCITY)
+       4   uint32  sequence, +1 per message of either type
+       8   uint64  sender time (us, sender's monotonic clock)
+   CV_MESSAGE_X_COMMAND:
+       16  float   LX target (m)
+       20  float   RX target (m)
+       24  float   LX predicted velocity (m/s)
+       28  float   RX predicted velocity (m/s)
+   Targets without their flag are ignored and the hand keeps its last
+   command. Velocities are only meaningful with CV_HAS_VELOCITY.
+   CV_MESSAGE_BALL, where the ball was at the sender time:
+       16  float   x (m), in the X command coordinates of the hand that
+                   is to catch it, CV_HAS_LX or CV_HAS_RX
+       20  float   height (m) above that hand's Y zero
+       24  float   unused
+       28  float   unused
+   The robot predicts where the ball comes down from these and sends the
+   catching hand there (ball_predictor.hpp).
+*/
+
+#ifndef __CV_PROTOCOL_HPP__
+#define __CV_PROTOCOL_HPP__
+
+#include <stdint.h>
+
+#define CV_MESSAGE_MAGIC 0xC7
+#define CV_PROTOCOL_VERSION 1
+#define CV_MESSAGE_SIZE 32
+
+// Message types
+#define CV_MESSAGE_X_COMMAND 1
+#define CV_MESSAGE_BALL 2
+
+// Flags
+#define CV_HAS_LX 0x01
+#define CV_HAS_RX 0x02
+#define CV_HAS_VELOCITY 0x04
+
+struct cv_message {
+	uint8_t type;
+	uint8_t flags;
+	uint32_t sequence;
+	uint64_t sender_tick;
+	float LX;
+	float RX;
+	float LX_velocity;
+	float RX_velocity;
+	float ball_x;
+	float ball_y;
+};
+
+// True if the datagram is a binary message rather than text
+bool is_cv_message(const char* buf, int length);
+
+// Unpack a datagram. Returns 0 on success, 1 if it is too short or a
+// version or type we do not know.
+int decode_cv_message(const char* buf, int length, cv_message& message);
+
+// Pack a message into buf (at least CV_MESSAGE_SIZE bytes). Returns the
+// number of bytes to send.
+int encode_cv_message(const cv_message& message, char* buf);
+
+#endif
@@ -12,12 +12,14 @@
 */
 
 #include <iostream>
-#include <pigpio.h>
+#include "hal.hpp"
 #include <cmath>
 #include <fstream>
 #include <stdlib.h> 
 #include <sstream>
 #include "dc_motor.hpp"
+#include "mono_clock.hpp"
+#include "control_loop.hpp"
 
 using namespace std;
 
@@ -47,12 +49,18 @@ dc_motor::dc_motor()
 	velocity_ff_constant = 0.0;
 	proportional_constant = 0.0;
 	derivative_constant = 0.0;
+	friction_up_ff = 0.0;
+	friction_down_ff = 0.0;
 	limit_width = 0;
 	kinect_constant = 0;
+	current_dir = -1;
 
 	// Pointers
 	encoder = NULL;
 	udp_comm = NULL;
+	outputs = NULL;
+	recorder = NULL;
+	lookahead_us = 0;
 }
 
 // Constructor:
@@ -67,10 +75,10 @@ dc_motor::dc_motor(motor_axis MotorAxis, int DirPin, int PwmPin, int PwmFreq, in
 	encoder = enc;
 
 	// Input function settings
-	gpioSetMode(dir_pin, PI_OUTPUT);
-	gpioSetPWMfrequency(pwm_pin, PwmFreq);
-	gpioSetMode(ULimitSwitch, PI_INPUT);
-	gpioSetMode(LLimitSwitch, PI_INPUT);
+	hal_set_mode(dir_pin, HAL_OUTPUT);
+	hal_set_pwm_frequency(pwm_pin, PwmFreq);
+	hal_set_mode(ULimitSwitch, HAL_INPUT);
+	hal_set_mode(LLimitSwitch, HAL_INPUT);
 
     // Important Default Settings
     dir_factor = 1;
@@ -94,10 +102,16 @@ dc_motor::dc_motor(motor_axis MotorAxis, int DirPin, int PwmPin, int PwmFreq, in
 	velocity_ff_constant = 0.0;
 	proportional_constant = 0.0;
 	derivative_constant = 0.0;
+	friction_up_ff = 0.0;
+	friction_down_ff = 0.0;
 	d_pulley =  0.0652015;
 	limit_width = 0;
 	kinect_constant = 0;
+	current_dir = -1;
 	udp_comm = NULL;
+	outputs = NULL;
+	recorder = NULL;
+	lookahead_us = 0;
 }
 
 // Destructor:
@@ -106,9 +120,42 @@ dc_motor::~dc_motor()
 	this->deactivate_limit_latching();
 }
 
+// Map a trajectory file the tables can play. Every sample is taken as
+// one millisecond in meters, so anything else would run at the wrong speed
+// or scale. Returns NULL (and prints why) if it can not be used.
+static const trajectory_file* load_path_file(string filename)
+{
+	const trajectory_file* traj = load_trajectory(filename);
+	if (!traj)
+		return(NULL);
+
+	if (traj->header.sample_rate_hz != PATH_SAMPLE_RATE_HZ)
+	{
+		cout << "Error: " << filename << " is sampled at " << traj->header.sample_rate_hz << " Hz. Paths must be "
+		     << PATH_SAMPLE_RATE_HZ << " Hz. Not loading it." << endl;
+		return(NULL);
+	}
+
+	if (traj->header.units != TRAJ_METERS)
+	{
+		cout << "Error: " << filename << " is not in meters. Not loading it." << endl;
+		return(NULL);
+	}
+	return(traj);
+}
+
 // Set the precomputed distance file
 void dc_motor::set_distance_file(string distanceFile)
 {
+	// Binary trajectory files are mapped, not parsed.
+	if (is_trajectory_file(distanceFile))
+	{
+		const trajectory_file* traj = load_path_file(distanceFile);
+		if (traj)
+			distance_path = traj->position;
+		return;
+	}
+
 	// Initialize variables to hold data
 	string line;
 	double value;
@@ -123,7 +170,7 @@ void dc_motor::set_distance_file(string distanceFile)
 			value = atof(line.c_str());
 
 			// Push it to the back of the vector
-			distance_path.push_back(value);
+			distance_storage.push_back(value);
 		}
 	}
 
@@ -134,11 +181,21 @@ void dc_motor::set_distance_file(string distanceFile)
 
 	// Close the file
 	myfile.close();
+	distance_path = path_view(distance_storage.data(), distance_storage.size());
 }
 
 // Set the precomputed velocity file
 void dc_motor::set_velocity_file(string velocityFile)
 {
+	// Binary trajectory files are mapped, not parsed.
+	if (is_trajectory_file(velocityFile))
+	{
+		const trajectory_file* traj = load_path_file(velocityFile);
+		if (traj)
+			velocity_path = traj->velocity;
+		return;
+	}
+
 	// Initialize variables to hold data
 	string line;
 	double value;
@@ -153,7 +210,7 @@ void dc_motor::set_velocity_file(string velocityFile)
 			value = atof(line.c_str());
 
 			// Push it to the back of the vector
-			velocity_path.push_back(value);
+			velocity_storage.push_back(value);
 		}
 	}
 	else
@@ -163,13 +220,57 @@ void dc_motor::set_velocity_file(string velocityFile)
 
 	// Close the file
 	myfile.close();
+	velocity_path = path_view(velocity_storage.data(), velocity_storage.size());
+}
+
+// Set both paths from a binary trajectory file. The file is mapped once
+// and shared with any other motor using it.
+void dc_motor::set_trajectory_file(string trajectoryFile)
+{
+	const trajectory_file* traj = load_path_file(trajectoryFile);
+	if (!traj)
+		return;
+
+	distance_path = traj->position;
+	velocity_path = traj->velocity;
+}
+
+// Set both paths from vectors. They are copied into the motor's storage.
+void dc_motor::set_paths(const vector<double>& distance, const vector<double>& velocity)
+{
+	distance_storage = distance;
+	velocity_storage = velocity;
+	distance_path = path_view(distance_storage.data(), distance_storage.size());
+	velocity_path = path_view(velocity_storage.data(), velocity_storage.size());
+}
+
+// Use a polynomial path instead of the tables. The path is not copied and
+// must outlive the run. NULL goes back to the tables.
+void dc_motor::set_segment_path(const piecewise_path* path)
+{
+	segment_cursor.set_path(path);
+}
+
+// Copy a new polynomial path in to take over at the running path's next
+// swap period. Never blocks the control loop.
+bool dc_motor::stage_segment_path(const piecewise_path& path)
+{
+	return(segment_slot.stage(path));
+}
+
+bool dc_motor::segment_path_pending() const
+{
+	return(segment_slot.pending());
 }
 
 // Run open-loop velocity path. 
-void dc_motor::run_ol_path(uint32_t initialization_tick, int delay_seconds)
+void dc_motor::run_ol_path(uint64_t initialization_tick, int delay_seconds)
 {
 	// Check if velocity path is set:
-	if (velocity_path.empty())
+	// A path staged while no run was going takes over now.
+	segment_slot.apply_now(segment_cursor);
+
+	if (velocity_path.empty() && !(segment_cursor.get_path()))
 	{
 		cout << "Velocity vector is empty. Aborting." << endl;
 		return;
@@ -187,236 +288,184 @@ void dc_motor::run_ol_path(uint32_t initialization_tick, int delay_seconds)
 	// microseconds in order to allow for the overhead involved in starting the
 	// four threads.
 
-	// Convert to microseconds for the tick.
-	uint32_t delay_second_cast = (uint32_t) delay_seconds;
-	uint32_t start_tick = initialization_tick + delay_second_cast*1000000;
-	uint32_t max_time_millis = velocity_path.size() - 1;
-	uint32_t current_time_millis;
+	// Convert to microseconds for the tick. Ticks are 64 bit (mono_clock), so
+	// they never wrap during a run.
+	uint64_t delay_second_cast = (uint64_t) delay_seconds;
+	uint64_t start_tick = initialization_tick + delay_second_cast*1000000;
 
     // Activate the limit latching!
     this->activate_limit_latching();
-	
-	while(gpioTick() < start_tick)
-		; // Do Nothing
-
-        
-        printf("Starting Motor! \n");
-
-
-	// For each time step we need to get the current time in milliseconds since
-	// the motor started, grab the correct angular velocity from the path 
-	// planning vector, convert it to PWM range (0-255), and apply it to the
-	// motor.
-
-	// Fancy changes for the future:
-	// - Scale it between min_pwm instead of 0
-	// - Do an offset so by the time it actually applies the gpio command it
-	//   knows what to do.
 
+	// For each time step, grab the velocity for the current millisecond from
+	// the path planning vector, convert it to PWM range (0-255), and apply
+	// it to the motor. See control_loop.hpp.
 	path_start_flag = true;
-	current_time_millis = (gpioTick() - start_tick)/1000;
-
-	while (!(limit_latch) && (current_time_millis < max_time_millis) ) {
-
-		// Grab current angular speed from vector
-		double angular_speed = dir_factor * velocity_path[current_time_millis];
-		// Note that for DIR Pins, 0 is up and 1 is down. 
-		if (angular_speed < 0) {
-            gpioWrite(dir_pin, 1);
-        }
-        else {
-        	gpioWrite(dir_pin, 0);
-        }
-		// Convert angular speed to a duty cycle from 0-255
-		int duty_cycle = abs(round(pwm_constant * angular_speed));
-
-		// Clip duty_cycle at 255 using a ternary operator. 
-		duty_cycle = ((duty_cycle > 255) ? 255 : duty_cycle);
-
-		// Change output PWM if duty_cycle is different from what it is
-		// already outputing
-		if (current_pwm != duty_cycle) {
-			gpioPWM(pwm_pin, duty_cycle);
-                        current_pwm = duty_cycle;
-                        cout << "Time is: "<< current_time_millis << "  Activating Motor with duty cycle: " << duty_cycle << endl;
-		}
-
-		if ((encoder->getCount() > workspace_width_count) || (encoder->getCount() < (-50)))
-		{
-			cout << "Motor went past workspace. Aborting." << endl;
-			this->stop();
-			break;
-		}
-
-		double encoder_velocity = encoder->getCPS();
-		cout << "Current Encoder Velocity (Counts per second) is: " << encoder_velocity << endl;
-		current_time_millis = (gpioTick() - start_tick)/1000;
+	telemetry.mark_run_start();
+	segment_cursor.reset();
+	latency.reset();
+	tracking.reset();
+	this->record_run(EVENT_RUN_OL, start_tick);
+	printf("Starting Motor!\n");
+
+	if (segment_cursor.get_path())
+	{
+		ol_segment_loop loop(*this, ol_law(*this), segment_trajectory(&segment_cursor, &segment_slot, start_tick, lookahead_us));
+		loop.run(start_tick);
+	}
+	else
+	{
+		ol_loop loop(*this, ol_law(*this), table_trajectory(velocity_path, path_view(), start_tick, lookahead_us));
+		loop.run(start_tick);
 	}
     
     // Make sure it's off!
     cout << "Turning off motor" << endl;
     this->stop();
     this->deactivate_limit_latching();
+    loop_timer.print_stats(enum2string(axis));
+	latency.print(enum2string(axis), lookahead_us);
 	path_done_flag = true;
 	all_done_flag = true;
 }
 
-void dc_motor::run_pdff_path(uint32_t initialization_tick, int delay_seconds)
+void dc_motor::run_pdff_path(uint64_t initialization_tick, int delay_seconds)
+{
+	// start_tick is the system tick that all the motors are given. In order to 
+	// ensure that all motors start at the same time, we wait for delay_seconds
+	// microseconds in order to allow for the overhead involved in starting the
+	// four threads.
+
+	// Convert to microseconds for the tick. Ticks are 64 bit (mono_clock), so
+	// they never wrap during a run.
+	uint64_t delay_second_cast = (uint64_t) delay_seconds;
+	uint64_t start_tick = initialization_tick + delay_second_cast*1000000;
+
+	if (!(this->begin_pdff_path()))
+		return;
+	this->record_run(EVENT_RUN_PDFF, start_tick);
+
+    printf("Starting Motor!\n");
+
+	if (segment_cursor.get_path())
+	{
+		pdff_segment_loop loop(*this, pdff_law(*this), segment_trajectory(&segment_cursor, &segment_slot, start_tick, lookahead_us));
+		loop.run(start_tick);
+	}
+	else
+	{
+		pdff_loop loop(*this, pdff_law(*this), table_trajectory(velocity_path, distance_path, start_tick, lookahead_us));
+		loop.run(start_tick);
+	}
+
+	loop_timer.print_stats(enum2string(axis));
+	this->end_pdff_path();
+}
+
+bool dc_motor::begin_pdff_path()
 {
+	// A path staged while no run was going takes over now.
+	segment_slot.apply_now(segment_cursor);
+
+	// A polynomial path has both position and velocity.
+	bool segments = (segment_cursor.get_path() != NULL);
+
 	// Check if velocity path is set:
-	if (velocity_path.empty())
+	if (velocity_path.empty() && !segments)
 	{
 		printf("Velocity vector is empty. Aborting.\n");
-		return;
+		return(false);
 	}
 
 	// Check if distance path is set:
-	if (distance_path.empty())
+	if (distance_path.empty() && !segments)
 	{
 		printf("Distance vector is empty. Aborting.\n");
-		return;
+		return(false);
 	}
 		// Check if it has been homed yet
 	if (!(home_flag))
 	{
 		printf("Home axis first. Aborting.\n");
-		return;
+		return(false);
 	}
 
-	// start_tick is the system tick that all the motors are given. In order to 
-	// ensure that all motors start at the same time, we wait for delay_seconds
-	// microseconds in order to allow for the overhead involved in starting the
-	// four threads.
-
-	// Convert to microseconds for the tick.
-	uint32_t delay_second_cast = (uint32_t) delay_seconds;
-	uint32_t start_tick = initialization_tick + delay_second_cast*1000000;
-	uint32_t max_time_millis = velocity_path.size() - 1;
-	uint32_t current_time_millis;
+	// Data is recorded every iteration and written out by the telemetry
+	// writer while we run.
+	telemetry.mark_run_start();
 
     // Activate the limit latching!
     this->activate_limit_latching();
-	
-	while(gpioTick() < start_tick)
-		; // Do Nothing
-
-    printf("Starting Motor!\n");
-
-	// For each time step we need to get the current time in milliseconds since
-	// the motor started, grab the correct angular velocity from the path 
-	// planning vector, convert it to PWM range (0-255), Apply the control law,
-	// clip it at 255, then activate the motor. 
-
-	// Fancy changes for the future:
-	// - Scale it between min_pwm instead of 0
-	// - Do an offset so by the time it actually applies the gpio command it
-	//   knows what to do.
-
-	// DATA OUTPUT Vectors
-	vector<uint32_t> tdata(max_time_millis + 1);
-	vector<double> vdata(max_time_millis + 1);
-	vector<double> ddata(max_time_millis + 1);
-
-
+	segment_cursor.reset();
+	latency.reset();
+	tracking.reset();
 	path_start_flag = true;
-	current_time_millis = (gpioTick() - start_tick)/1000;
-	int j = 0;
-	uint32_t prev_time_millis = 0;
+	return(true);
+}
 
-	while (!(limit_latch) && (current_time_millis < max_time_millis) ) 
+bool dc_motor::step_pdff_path(uint64_t now_tick, uint64_t start_tick)
+{
+	// The policies are plain values, so building the loop each period
+	// costs nothing once inlined. The segment cursor lives in the motor,
+	// so it carries over from one period to the next.
+	if (segment_cursor.get_path())
 	{
-		// Get desired velocity (m/s) and desired distance (m) from file.
-		// Do all computation in meters/s and meters. 
-		double v_d = velocity_path[current_time_millis]; // meters/sec
-		double d_d = distance_path[current_time_millis]; // meters
-
-		// Get current position and velocity from encoders (m/s, m)
-		// Convert counts per second into meters/sec
-		double v = (encoder->getCPS())/count_per_meter;
-		double d = (encoder->getCount())/count_per_meter;
-		//cout << "Current Linear Velocity is: " << v << endl;
-		//cout << "Current Position (m) is: " << d << endl;
-		if (prev_time_millis != current_time_millis)
-		{
-		   vdata[j] = v;
-		   ddata[j] = d;
-		   tdata[j] = current_time_millis;
-		   j++;
-		}
-		prev_time_millis = current_time_millis;
-
-		double control_law = velocity_ff_constant*v_d + proportional_constant*(d_d - d) + derivative_constant*(v_d - v);
-
-		control_law *= dir_factor;
-
-		if (control_law < 0) {
-            gpioWrite(dir_pin, 1);
-        }
-        else {
-        	gpioWrite(dir_pin, 0);
-        }
-
-        int duty_cycle = abs(round(control_law));
-
-        // Clip duty_cycle at 255 using a ternary operator. 
-		duty_cycle = ((duty_cycle > 255) ? 255 : duty_cycle);
-
-		// Change output PWM if duty_cycle is different from what it is
-		// already outputing
-		if (current_pwm != duty_cycle) {
-			gpioPWM(pwm_pin, duty_cycle);
-            current_pwm = duty_cycle;
-            //cout << "Time is: "<< current_time_millis << "  Activating Motor with duty cycle: " << duty_cycle << endl;
-		}
-
-		if ((encoder->getCount() > (150+workspace_width_count)) || (encoder->getCount() < (-50)))
-		{
-			printf("Encoder Count: %d", encoder->getCount());
-			printf("Motor went past workspace. Aborting \n");
-			this->stop();
-			break;
-		}
-		current_time_millis = (gpioTick() - start_tick)/1000;
+		pdff_segment_loop loop(*this, pdff_law(*this), segment_trajectory(&segment_cursor, &segment_slot, start_tick, lookahead_us));
+		return(loop.step(now_tick));
 	}
 
+	pdff_loop loop(*this, pdff_law(*this), table_trajectory(velocity_path, distance_path, start_tick, lookahead_us));
+	return(loop.step(now_tick));
+}
 
-
-
+void dc_motor::end_pdff_path()
+{
 	// Make sure it's off!
     printf("Turning off motor\n");
     this->stop();
     this->deactivate_limit_latching();
+	latency.print(enum2string(axis), lookahead_us);
 	path_done_flag = true;
-	
+	all_done_flag = true;
+}
 
-	string motor_name = enum2string(axis);
-	string toutfile = "time_data_" + motor_name + ".txt";
-	string voutifle = "velocity_data_" + motor_name + ".txt";
-	string doutfile = "distance_data_" + motor_name + ".txt";
-
-	// Open files
-    ofstream tfile(toutfile.c_str());
-    ofstream vfile(voutifle.c_str());
-    ofstream dfile(doutfile.c_str());
-
-    if ((tfile.is_open()) && (vfile.is_open()) && (dfile.is_open()))
-    {
-    	printf("Writing Files. \n");
-    	for (int i = 0; i < ((int) tdata.size()); i++)
-    	{
-    		tfile << tdata[i] << "\n";
-    		dfile << ddata[i] << "\n";
-    		vfile << vdata[i] << "\n";
-    	}
-    }
+bool dc_motor::begin_stream_path()
+{
+	segment_slot.apply_now(segment_cursor);
+	const piecewise_path* path = segment_cursor.get_path();
+	if (!path || path->loop.empty())
+	{
+		printf("Streaming needs a planned path with a loop. Aborting.\n");
+		return(false);
+	}
 
-	tfile.close();
-	vfile.close();
-	dfile.close();
-	all_done_flag = true;
+	segment_cursor.set_repeat(true);
+	if (!(this->begin_pdff_path()))
+	{
+		segment_cursor.set_repeat(false);
+		return(false);
+	}
+	return(true);
 }
 
-void dc_motor::run_pdff_cv_path(uint32_t InitializationTick, int DelaySeconds)
+bool dc_motor::step_stream_path(uint64_t now_tick, uint64_t start_tick)
+{
+	pdff_segment_loop loop(*this, pdff_law(*this),
+	                       segment_trajectory(&segment_cursor, &segment_slot, start_tick, lookahead_us, &telemetry));
+	return(loop.step(now_tick));
+}
+
+void dc_motor::finish_stream_path()
+{
+	segment_cursor.finish();
+}
+
+void dc_motor::end_stream_path()
+{
+	segment_cursor.set_repeat(false);
+	this->end_pdff_path();
+}
+
+void dc_motor::run_pdff_cv_path(uint64_t InitializationTick, int DelaySeconds)
 //DEFAULT 15 second timeout.
 {
 	int timeout = 15; //Seconds. THIS IS HARDCODED. CHANGE IN FUTURE.
@@ -438,128 +487,48 @@ void dc_motor::run_pdff_cv_path(uint32_t InitializationTick, int DelaySeconds)
 		return;
 	}
 
-    //THIS BEGINS THE PATH FOLLOWING PORTION. 
-
-	// Check if velocity path is set:
-	if (velocity_path.empty())
+	if ((axis == LY) || (axis == RY))
 	{
-		printf("Velocity vector is empty. Aborting.\n");
+		printf("Can't follow kinect on Y Motor. Aborting. \n");
 		return;
 	}
 
-	// Check if distance path is set:
-	if (distance_path.empty())
-	{
-		printf("Distance vector is empty. Aborting.\n");
-		return;
-	}
-		// Check if it has been homed yet
-	if (!(home_flag))
-	{
-		printf("Home axis first. Aborting.\n");
-		return;
-	}
+    //THIS BEGINS THE PATH FOLLOWING PORTION. 
 
 	// start_tick is the system tick that all the motors are given. In order to 
 	// ensure that all motors start at the same time, we wait for delay_seconds
 	// microseconds in order to allow for the overhead involved in starting the
 	// four threads.
 
-	// Convert to microseconds for the tick.
-	uint32_t delay_second_cast = (uint32_t) DelaySeconds;
-	uint32_t start_tick = InitializationTick + delay_second_cast*1000000;
-	uint32_t max_time_millis = velocity_path.size() - 1;
-	uint32_t current_time_millis;
+	// Convert to microseconds for the tick. Ticks are 64 bit (mono_clock), so
+	// they never wrap during a run.
+	uint64_t delay_second_cast = (uint64_t) DelaySeconds;
+	uint64_t start_tick = InitializationTick + delay_second_cast*1000000;
 
-    // Activate the limit latching!
-    this->activate_limit_latching();
-	
-	while(gpioTick() < start_tick)
-		; // Do Nothing
+	// Checks the paths, arms the limit switches and marks the run.
+	if (!(this->begin_pdff_path()))
+		return;
+	this->record_run(EVENT_RUN_PDFF, start_tick);
 
     printf("Starting Motor!\n");
 
-	// For each time step we need to get the current time in milliseconds since
-	// the motor started, grab the correct angular velocity from the path 
-	// planning vector, convert it to PWM range (0-255), Apply the control law,
-	// clip it at 255, then activate the motor. 
-
-	// Fancy changes for the future:
-	// - Scale it between min_pwm instead of 0
-	// - Do an offset so by the time it actually applies the gpio command it
-	//   knows what to do.
-
-	// DATA OUTPUT Vectors
-	vector<uint32_t> tdata(max_time_millis + 1);
-	vector<double> vdata(max_time_millis + 1);
-	vector<double> ddata(max_time_millis + 1);
-
-
-	path_start_flag = true;
-	current_time_millis = (gpioTick() - start_tick)/1000;
-	int j = 0;
-	uint32_t prev_time_millis = 0;
-
-	while (!(limit_latch) && (current_time_millis < max_time_millis) ) 
+	if (segment_cursor.get_path())
 	{
-		// Get desired velocity (m/s) and desired distance (m) from file.
-		// Do all computation in meters/s and meters. 
-		double v_d = velocity_path[current_time_millis]; // meters/sec
-		double d_d = distance_path[current_time_millis]; // meters
-
-		// Get current position and velocity from encoders (m/s, m)
-		// Convert counts per second into meters/sec
-		double v = (encoder->getCPS())/count_per_meter;
-		double d = (encoder->getCount())/count_per_meter;
-		//cout << "Current Linear Velocity is: " << v << endl;
-		//cout << "Current Position (m) is: " << d << endl;
-		if (prev_time_millis != current_time_millis)
-		{
-		   vdata[j] = v;
-		   ddata[j] = d;
-		   tdata[j] = current_time_millis;
-		   j++;
-		}
-		prev_time_millis = current_time_millis;
-
-		double control_law = velocity_ff_constant*v_d + proportional_constant*(d_d - d) + derivative_constant*(v_d - v);
-
-		control_law *= dir_factor;
-
-		if (control_law < 0) {
-            gpioWrite(dir_pin, 1);
-        }
-        else {
-        	gpioWrite(dir_pin, 0);
-        }
-
-        int duty_cycle = abs(round(control_law));
-
-        // Clip duty_cycle at 255 using a ternary operator. 
-		duty_cycle = ((duty_cycle > 255) ? 255 : duty_cycle);
-
-		// Change output PWM if duty_cycle is different from what it is
-		// already outputing
-		if (current_pwm != duty_cycle) {
-			gpioPWM(pwm_pin, duty_cycle);
-            current_pwm = duty_cycle;
-            //cout << "Time is: "<< current_time_millis << "  Activating Motor with duty cycle: " << duty_cycle << endl;
-		}
-
-		if ((encoder->getCount() > (150+workspace_width_count)) || (encoder->getCount() < (-50)))
-		{
-			printf("Encoder Count: %d", encoder->getCount());
-			printf("Motor went past workspace. Aborting \n");
-			this->stop();
-			break;
-		}
-		current_time_millis = (gpioTick() - start_tick)/1000;
+		pdff_segment_loop path_loop(*this, pdff_law(*this), segment_trajectory(&segment_cursor, &segment_slot, start_tick, lookahead_us));
+		path_loop.run(start_tick);
+	}
+	else
+	{
+		pdff_loop path_loop(*this, pdff_law(*this), table_trajectory(velocity_path, distance_path, start_tick, lookahead_us));
+		path_loop.run(start_tick);
 	}
 
 	// Make sure it's off!
     printf("Turning off motor\n");
     this->stop();
     this->deactivate_limit_latching();
+    loop_timer.print_stats(enum2string(axis));
+	latency.print(enum2string(axis), lookahead_us);
 	path_done_flag = true;
 
 	
@@ -568,100 +537,31 @@ void dc_motor::run_pdff_cv_path(uint32_t InitializationTick, int DelaySeconds)
     //*****************************************
 	//THIS BEGINS CV PORTION....
 	//*****************************************
-	uint32_t timeout_tick = gpioTick() + ((uint32_t) timeout)*1000000;
+	uint64_t timeout_tick = mono_tick() + ((uint64_t) timeout)*1000000;
 
-	while(!(udp_comm->track_flag) && (gpioTick() < timeout_tick))
+	// Poll for the kinect once per control period instead of spinning.
+	loop_timer.start_at(mono_tick());
+	while(!(udp_comm->track_flag) && (mono_tick() < timeout_tick))
 	{
-		; //Do Nothing...
+		loop_timer.wait_next();
 	}
 
-	if((gpioTick() > timeout_tick))
+	if((mono_tick() > timeout_tick))
 	{
 		printf("Timed Out \n");
 		return;
 	} 
 
-	while((udp_comm->track_flag) && (gpioTick() < timeout_tick))
-	{
-		double d = (encoder->getCount())/count_per_meter;
-		double d_d;
-
-		switch (axis)
-		{
-			case RX: d_d = (udp_comm->get_RX())*count_per_meter;
-			         break;
-			case LX: d_d = (udp_comm->get_LX())*count_per_meter;
-			         break;
-			case LY: printf("Can't follow kinect on Y Motor. Aborting. \n");
-					 return;
-			case RY: printf("Can't follow kinect on Y Motor. Aborting. \n");
-					 return;
-		}
-
-		if ((d_d > (50+workspace_width_count)) || (d_d < (-50)))
-		{
-			printf("CV command is: %f This is past the workspace. Aborting.", d_d);
-			this->stop();
-			break;
-		}
-
-		//CONTROL LAW
-		double control_law = kinect_constant*(d_d - d) - 50;
-
-		control_law *= dir_factor;
-
-		if (control_law < 0) {
-            gpioWrite(dir_pin, 1);
-        }
-        else {
-        	gpioWrite(dir_pin, 0);
-        }
-
-        int duty_cycle = abs(round(control_law));
-
-        // Clip duty_cycle at 255 using a ternary operator. 
-		duty_cycle = ((duty_cycle > 255) ? 255 : duty_cycle);
-
-		// Change output PWM if duty_cycle is different from what it is
-		// already outputing
-		if (current_pwm != duty_cycle) {
-			gpioPWM(pwm_pin, duty_cycle);
-            current_pwm = duty_cycle;
-		}
+	// Commands more than 50 counts past either end of the workspace abort.
+	double margin = 50/count_per_meter;
+	cv_delay.reset();
+	this->record_run(EVENT_RUN_CV, timeout_tick);
+	cv_loop track_loop(*this, cv_law(*this), cv_target(udp_comm, axis, timeout_tick, -margin, workspace_width_count/count_per_meter + margin, &cv_delay));
+	track_loop.run(mono_tick());
 
-		if ((encoder->getCount() > (50+workspace_width_count)) || (encoder->getCount() < (-50)))
-		{
-		    cout << "Encoder Count: " << encoder->getCount() << endl;
-			cout << "Motor went past workspace. Skipping.\n" << endl;
-			this->stop();
-			continue;
-		}
-	}
-
-	//FILE PRINTING. PUT AT END, AFTER CV PORTION. 
-	string motor_name = enum2string(axis);
-	string toutfile = "time_data_" + motor_name + ".txt";
-	string voutifle = "velocity_data_" + motor_name + ".txt";
-	string doutfile = "distance_data_" + motor_name + ".txt";
-
-	// Open files
-    ofstream tfile(toutfile.c_str());
-    ofstream vfile(voutifle.c_str());
-    ofstream dfile(doutfile.c_str());
-
-    if ((tfile.is_open()) && (vfile.is_open()) && (dfile.is_open()))
-    {
-    	printf("Writing Files. \n");
-    	for (int i = 0; i < ((int) tdata.size()); i++)
-    	{
-    		tfile << tdata[i] << "\n";
-    		dfile << ddata[i] << "\n";
-    		vfile << vdata[i] << "\n";
-    	}
-    }
-	tfile.close();
-	vfile.close();
-	dfile.close();
+	this->stop();
+	loop_timer.print_stats(enum2string(axis) + " CV");
+	cv_delay.print(enum2string(axis));
 
 	all_done_flag = true;
 	return;
@@ -687,25 +587,32 @@ void dc_motor::follow_kinect(int timeout)
 		return;
 	}
 
-	uint32_t timeout_tick = gpioTick() + ((uint32_t) timeout)*1000000;
+	uint64_t timeout_tick = mono_tick() + ((uint64_t) timeout)*1000000;
 
-	while(!(udp_comm->track_flag) && (gpioTick() < timeout_tick))
+	// Poll for the kinect once per control period instead of spinning.
+	loop_timer.start_at(mono_tick());
+	while(!(udp_comm->track_flag) && (mono_tick() < timeout_tick))
 	{
-		; //Do Nothing...
+		loop_timer.wait_next();
 	}
 
-	if((gpioTick() > timeout_tick))
+	if((mono_tick() > timeout_tick))
 	{
 		printf("Timed Out \n");
 		return;
 	} 
 	cout << "Getting data from kinect..." << endl;
+	telemetry.mark_run_start();
+	this->record_run(EVENT_RUN_OTHER, timeout_tick);
 
 	// Activate the limit latching!
     this->activate_limit_latching();
 
-	while((udp_comm->track_flag) && (gpioTick() < timeout_tick))
+	while((udp_comm->track_flag) && (mono_tick() < timeout_tick))
 	{
+		// Wait for the start of this control period
+		loop_timer.wait_next();
+
 		double d = (encoder->getCount())/count_per_meter;
 		double d_d;
 
@@ -739,34 +646,16 @@ void dc_motor::follow_kinect(int timeout)
 			continue;
 		}
 
-		printf("d: %f\n",d);
-		printf("d_d: %f\n", d_d);
-
 		double control_law = kinect_constant*(d_d - d) + (50*((d_d-d)/abs(d_d-d)));
-		cout << "Control law: " << control_law << endl;
 
 		control_law *= dir_factor;
 
-		if (control_law < 0) {
-            gpioWrite(dir_pin, 1);
-        }
-        else {
-        	gpioWrite(dir_pin, 0);
-        }
+		int duty_cycle = this->drive(control_law);
 
-        int duty_cycle = abs(round(control_law));
-
-        // Clip duty_cycle at 255 using a ternary operator. 
-		duty_cycle = ((duty_cycle > 255) ? 255 : duty_cycle);
-
-		// Change output PWM if duty_cycle is different from what it is
-		// already outputing
-		if (current_pwm != duty_cycle) {
-			gpioPWM(pwm_pin, duty_cycle);
-            current_pwm = duty_cycle;
-		}
+		this->record_telemetry(mono_tick(), d_d, 0, d, (encoder->getCPS())/count_per_meter, control_law, duty_cycle);
 	}
 	this->deactivate_limit_latching();
+	loop_timer.print_stats(enum2string(axis));
 	all_done_flag = true;
 }
 
@@ -823,7 +712,7 @@ void dc_motor::point_control()
 				this->run_speed_no_limit(min_up_pwm, 1);
 			}
 
-			if (((encoder->getCount()) > (target_position - move_precision)) && ((encoder->getCount()) < (target_position + move_precision)))
+			if (((encoder->getCount()) >= (target_position - move_precision)) && ((encoder->getCount()) <= (target_position + move_precision)))
 			{
 				cout << "Target Position Reached!" << endl;
 				position_reached = 1;
@@ -875,7 +764,7 @@ void dc_motor::go_to_point(double point)
 			this->run_speed_no_limit(min_up_pwm, 1);
 		}
 
-		if (((encoder->getCount()) > (target_position - move_precision)) && ((encoder->getCount()) < (target_position + move_precision)))
+		if (((encoder->getCount()) >= (target_position - move_precision)) && ((encoder->getCount()) <= (target_position + move_precision)))
 		{
 			cout << "Target Position Reached!" << endl;
 			position_reached = 1;
@@ -894,51 +783,152 @@ void dc_motor::run_speed_no_limit(int duty_cycle, int direction)
 {
 	direction *= dir_factor;
 	if (direction < 0) {
-            gpioWrite(dir_pin, 1);
+            this->write_direction(1);
         }
         else {
-        	gpioWrite(dir_pin, 0);
+        	this->write_direction(0);
         }
 
 	//cout << "Activating motor with duty_cycle: " << duty_cycle << endl;
-	gpioPWM(pwm_pin, duty_cycle);
+	this->write_pwm(duty_cycle);
 	current_pwm = duty_cycle;
 }
 
 void dc_motor::stop()
 {
-	cout << "Stopping Motor" << endl;
-	gpioPWM(pwm_pin, 0);
+	// Always straight to the pin, never staged, so a stop takes effect
+	// immediately. A duty cycle already staged would undo it at the next
+	// commit, so that is zeroed too. The stage belongs to the control
+	// thread, so the limit switch alert does not come through here.
+	if (current_pwm != 0)
+		cout << "Stopping Motor" << endl;
+	hal_pwm(pwm_pin, 0);
+	if (outputs)
+		outputs->zero_pwm(pwm_pin);
+	current_pwm = 0;
+}
+
+// Set the direction from the sign of the control law and the PWM from its
+// magnitude, clipped at 255. Returns the duty cycle.
+int dc_motor::drive(double control_law)
+{
+	// Note that for DIR Pins, 0 is up and 1 is down. 
+	if (control_law < 0) {
+        this->write_direction(1);
+    }
+    else {
+    	this->write_direction(0);
+    }
+
+    int duty_cycle = abs(round(control_law));
+
+    // Clip duty_cycle at 255 using a ternary operator. 
+	duty_cycle = ((duty_cycle > 255) ? 255 : duty_cycle);
+
+	// Change output PWM if duty_cycle is different from what it is
+	// already outputing
+	if (current_pwm != duty_cycle) {
+		this->write_pwm(duty_cycle);
+        current_pwm = duty_cycle;
+	}
+	return(duty_cycle);
+}
+
+void dc_motor::record_telemetry(uint64_t tick, double d_d, double v_d, double d, double v, double control_law, int duty_cycle,
+                                uint32_t alert_sequence, bool alert_race)
+{
+	telemetry_record rec;
+	rec.tick = tick;
+	rec.desired_position = d_d;
+	rec.desired_velocity = v_d;
+	rec.position = d;
+	rec.velocity = v;
+	rec.control_effort = control_law;
+	rec.duty_cycle = duty_cycle;
+	rec.dir = current_dir;
+	rec.flags = limit_latch ? TELEMETRY_LIMIT_LATCHED : 0;
+	if (alert_race)
+		rec.flags |= TELEMETRY_ALERT_RACE;
+	rec.alert_sequence = alert_sequence;
+	telemetry.record(rec);
+}
+
+// Set the direction pin, through the output stage if there is one.
+void dc_motor::write_direction(int level)
+{
+	if (outputs)
+	{
+		// Staged, but it is what the pin will be at the commit, and what
+		// the telemetry records.
+		outputs->set_level(dir_pin, level);
+		current_dir = level;
+		return;
+	}
+
+	if (current_dir != level)
+	{
+		hal_write(dir_pin, level);
+		current_dir = level;
+	}
+}
+
+// Set the PWM duty cycle, through the output stage if there is one.
+void dc_motor::write_pwm(int duty_cycle)
+{
+	if (outputs)
+		outputs->set_pwm(pwm_pin, duty_cycle);
+	else
+		hal_pwm(pwm_pin, duty_cycle);
+}
+
+void dc_motor::set_output_stage(output_stage* stage)
+{
+	outputs = stage;
+	// We do not know what the pin was left at by whoever wrote it last.
+	current_dir = -1;
 }
 
 void dc_motor::activate_limit_latching()
 {
 	// Set Alert functions
-	gpioSetAlertFuncEx(u_limit_switch, _static_limit_hit, this);
-	gpioSetAlertFuncEx(l_limit_switch, _static_limit_hit, this);
+	hal_set_alert(u_limit_switch, _static_limit_hit, this);
+	hal_set_alert(l_limit_switch, _static_limit_hit, this);
 }
 
 void dc_motor::_static_limit_hit(int gpio_caller, int level, uint32_t tick, void *userdata)
 {
 	dc_motor* Self = (dc_motor*) userdata;
-	Self->_limit_hit(gpio_caller, level);
+	event_recorder* recorder = Self->recorder;
+	if (!recorder)
+	{
+		Self->_limit_hit(gpio_caller, level);
+		return;
+	}
+
+	// Log what was read back too, so the replay reads the same.
+	recorder->begin_alert();
+	int pin_level = Self->_limit_hit(gpio_caller, level);
+	recorder->end_alert(EVENT_LIMIT, gpio_caller, level | (pin_level ? EVENT_PIN_HIGH : 0), Self->axis, tick);
 }
 
-void dc_motor::_limit_hit(int gpio_caller, int level)
+int dc_motor::_limit_hit(int gpio_caller, int level)
 {
-	if((level == 0) && !(gpioRead(gpio_caller)))
+	int pin_level = (level == 0) ? hal_read(gpio_caller) : 1;
+	if((level == 0) && !pin_level)
 	{
-		this->stop();
+		// Only the pin and the latch. The control loop sees the latch and
+		// stops the motor properly, output stage and all.
+		hal_pwm(pwm_pin, 0);
 		limit_latch = true;
 		cout << "Limit Switch Hit!" << endl;
 	}
-	return;
+	return(pin_level);
 }
 
 void dc_motor::deactivate_limit_latching()
 {
-	gpioSetAlertFuncEx(u_limit_switch, 0, this);
-	gpioSetAlertFuncEx(l_limit_switch, 0, this);
+	hal_set_alert(u_limit_switch, 0, this);
+	hal_set_alert(l_limit_switch, 0, this);
 }
 
 void dc_motor::reset_limit_latches()
@@ -972,7 +962,7 @@ int dc_motor::home()
 		return(2);
 	}
 
-	if(!gpioRead(l_limit_switch) && !gpioRead(u_limit_switch))
+	if(!hal_read(l_limit_switch) && !hal_read(u_limit_switch))
 	{
 		cout << "Two limit switches hit on a frame. Please manually move one." << endl;
 		cout << "Aborting now." << endl;
@@ -983,7 +973,7 @@ int dc_motor::home()
 
 	// Clear lower limit, only while upper limit is clear, and only while it is going
 	// less than 300 counts. 
-	while(!gpioRead(l_limit_switch) && gpioRead(u_limit_switch) && ((encoder->getCount()) < 300))
+	while(!hal_read(l_limit_switch) && hal_read(u_limit_switch) && ((encoder->getCount()) < 300))
 	{
 		// Lower limit switch being touched. Move up!
 		this->run_speed_no_limit(min_up_pwm, 1);
@@ -992,7 +982,7 @@ int dc_motor::home()
 
 	// At this point, if the upper limit switch is hit/encoder reads 280+, and the lower limit switch is still hit, 
 	// we know that the other motor is also hitting a switch. We back down to zero and flag a fixable problem.
-	if(!gpioRead(l_limit_switch) && (!gpioRead(u_limit_switch) || ((encoder->getCount()) > 280)))
+	if(!hal_read(l_limit_switch) && (!hal_read(u_limit_switch) || ((encoder->getCount()) > 280)))
 	{
 		//Back down to the place where we started.
 		while((encoder->getCount()) > 2)
@@ -1006,7 +996,7 @@ int dc_motor::home()
 
 	encoder->resetCount();
 	// Clear upper limit, only while lower limit is clear, and only while it is going less than 300 counts. 
-	while(!gpioRead(u_limit_switch) && gpioRead(l_limit_switch) && ((encoder->getCount()) > -300))
+	while(!hal_read(u_limit_switch) && hal_read(l_limit_switch) && ((encoder->getCount()) > -300))
 	{
 		// upper limit switch being touched. Move down!
 		this->run_speed_no_limit(min_down_pwm, -1);
@@ -1015,7 +1005,7 @@ int dc_motor::home()
 
 	//At this point, if the lower limit swich is hit/encoder reads -280+ AND the upper switch is still hit,
 	// the problem lies in the opposite axis. Return fixable fail.
-	if(!gpioRead(u_limit_switch) && (!gpioRead(l_limit_switch) || ((encoder->getCount()) < -280)))
+	if(!hal_read(u_limit_switch) && (!hal_read(l_limit_switch) || ((encoder->getCount()) < -280)))
 	{
 		//Back upto the place where we started.
 		while((encoder->getCount()) < -2)
@@ -1031,10 +1021,10 @@ int dc_motor::home()
 	// Move down until we touch lower limit switch
 	while(1)
 	{
-	    if(!gpioRead(l_limit_switch))
+	    if(!hal_read(l_limit_switch))
 		{
-		    gpioSleep(PI_TIME_RELATIVE, 0, 20);
-		if(!gpioRead(l_limit_switch))
+		    hal_sleep(0, 20);
+		if(!hal_read(l_limit_switch))
 		{
 	        this->stop();
 		    break;
@@ -1052,10 +1042,10 @@ int dc_motor::home()
 	// Slowly move up until top limit switch is hit:
 	while(1)
 	{
-		if(!gpioRead(u_limit_switch))
+		if(!hal_read(u_limit_switch))
 		{
-		    gpioSleep(PI_TIME_RELATIVE, 0, 20);
-			if(!gpioRead(u_limit_switch))
+		    hal_sleep(0, 20);
+			if(!hal_read(u_limit_switch))
 			{
 				this->stop();
 				break;
@@ -1083,7 +1073,7 @@ int dc_motor::home()
 	cout << "Target is: " << target_position << endl;
 
 	// Clear upper limit. 
-	while (!gpioRead(u_limit_switch))
+	while (!hal_read(u_limit_switch))
 	{
 	        cout << "Moving off Top limit switch" << endl;
 		// upper limit switch being touched. Move down!
@@ -1111,7 +1101,7 @@ int dc_motor::home()
 			this->run_speed_no_limit(min_up_pwm, 1);
 		}
 
-		if (((encoder->getCount()) > (target_position - move_precision)) && ((encoder->getCount()) < (target_position + move_precision)))
+		if (((encoder->getCount()) >= (target_position - move_precision)) && ((encoder->getCount()) <= (target_position + move_precision)))
 			{
 			    cout << "Just Right!" << endl;
 				position_set = 1;
@@ -1120,7 +1110,7 @@ int dc_motor::home()
 	}
 
 	//Pause for half a second
-	gpioSleep(PI_TIME_RELATIVE, 0, 500000);
+	hal_sleep(0, 500000);
 
 	//Second while loop:
 	position_set = 0;
@@ -1142,7 +1132,7 @@ int dc_motor::home()
 			this->run_speed_no_limit(min_up_pwm, 1);
 		}
 
-		if (((encoder->getCount()) > (target_position - move_precision)) && ((encoder->getCount()) < (target_position + move_precision)))
+		if (((encoder->getCount()) >= (target_position - move_precision)) && ((encoder->getCount()) <= (target_position + move_precision)))
 			{
 			    cout << "Just Right!" << endl;
 				position_set = 1;
@@ -1195,6 +1185,81 @@ void dc_motor::set_homing_parameters(double limitWidth, double workspaceWidth, i
 	return;
 }
 
+void dc_motor::set_friction_feedforward(double up, double down)
+{
+	friction_up_ff = up;
+	friction_down_ff = down;
+}
+
+// Parameter files are lines of "name value". Blank lines and lines
+// starting with # are skipped.
+int dc_motor::load_parameters(string parameterFile)
+{
+	ifstream myfile(parameterFile.c_str());
+	if (!myfile.is_open())
+	{
+		cout << "Could not open parameter file " << parameterFile << endl;
+		return(1);
+	}
+
+	string line;
+	int line_number = 0;
+	while (getline(myfile, line))
+	{
+		line_number++;
+		istringstream fields(line);
+		string name;
+		double value;
+		if (!(fields >> name) || (name[0] == '#'))
+			continue;
+		if (!(fields >> value))
+		{
+			cout << parameterFile << ":" << line_number << ": no value for " << name << endl;
+			continue;
+		}
+
+		if (name == "velocity_feedforward_constant")
+			velocity_ff_constant = value;
+		else if (name == "friction_up")
+			friction_up_ff = value;
+		else if (name == "friction_down")
+			friction_down_ff = value;
+		else if (name == "up_pwm")
+			min_up_pwm = (int) value;
+		else if (name == "down_pwm")
+			min_down_pwm = (int) value;
+		else if (name == "lookahead_us")
+			this->set_lookahead((int) value);
+		else if (name == "direction_factor")
+			this->set_direction_factor((int) value);
+		else
+			cout << parameterFile << ":" << line_number << ": unknown parameter " << name << endl;
+	}
+
+	cout << "Loaded " << parameterFile << ": Kff " << velocity_ff_constant << ", friction " << friction_up_ff
+	     << " up " << friction_down_ff << " down, homing PWM " << min_up_pwm << "/" << min_down_pwm
+	     << ", lookahead " << lookahead_us << " us" << endl;
+	return(0);
+}
+
+// The feedforward follows the path this far (us) ahead of now.
+void dc_motor::set_lookahead(int microseconds)
+{
+	if (microseconds < 0)
+		microseconds = 0;
+	lookahead_us = microseconds;
+}
+
+void dc_motor::set_control_rate(int rate_hz)
+{
+	loop_timer.set_rate(rate_hz);
+}
+
+control_loop_stats dc_motor::get_loop_stats()
+{
+	return(loop_timer.get_stats());
+}
+
 void dc_motor::set_kinect_constant(double constnt)
 {
 	kinect_constant = constnt;
@@ -1209,6 +1274,48 @@ void dc_motor::add_comm(udp_connection* comm)
 	}
 }
 
+void dc_motor::set_recorder(event_recorder* recorder)
+{
+	if (encoder)
+		encoder->set_recorder(recorder, axis);
+	this->recorder = recorder;
+}
+
+void dc_motor::record_run(event_run_mode mode, uint64_t start_tick)
+{
+	if (!recorder)
+		return;
+
+	const piecewise_path* path = segment_cursor.get_path();
+
+	event_run run;
+	memset(&run, 0, sizeof(run));
+	run.axis = (uint8_t) axis;
+	run.mode = (uint8_t) mode;
+	run.flags = (limit_latch ? EVENT_RUN_LIMIT_LATCHED : 0) | (path ? EVENT_RUN_SEGMENTS : 0);
+	run.dir_factor = (int8_t) dir_factor;
+	run.dir_pin = (uint8_t) dir_pin;
+	run.pwm_pin = (uint8_t) pwm_pin;
+	run.u_limit_switch = (uint8_t) u_limit_switch;
+	run.l_limit_switch = (uint8_t) l_limit_switch;
+	run.alert_sequence = recorder->alert_sequence();
+	run.lookahead_us = lookahead_us;
+	run.workspace_width_count = workspace_width_count;
+	run.path_length = path ? 0 : velocity_path.size();
+	run.first_record = telemetry.recorded;
+	run.start_tick = start_tick;
+	run.path_fingerprint = path ? path_fingerprint(*path) : path_fingerprint(distance_path, velocity_path);
+	run.count_per_meter = count_per_meter;
+	run.pwm_constant = pwm_constant;
+	run.velocity_ff_constant = velocity_ff_constant;
+	run.proportional_constant = proportional_constant;
+	run.derivative_constant = derivative_constant;
+	run.friction_up_ff = friction_up_ff;
+	run.friction_down_ff = friction_down_ff;
+	run.kinect_constant = kinect_constant;
+	recorder->record_run(run);
+}
+
 
 string enum2string(motor_axis axis)
 {
@@ -10,21 +10,64 @@
    This is version 1.0 so only support for start flags, done flags, one 
    velocity-time vector, and one encoder.
 
-   The variable velocity_path is a pointer to a vector of integers. Each entry
-   in this vector refers to the velocity value for each milisecond of the time
+   The variable velocity_path is a view of an array of doubles. Each entry
+   in this array refers to the velocity value for each milisecond of the time
    path. 
  */
 
 #ifndef __DC_MOTOR_HPP__
 #define __DC_MOTOR_HPP__
 
+#include <stdint.h>
+#include <cmath>
 #include <vector>
 #include <string>
 #include "rot_encoder.hpp"
 #include "udp_connection.hpp"
+#include "control_timer.hpp"
+#include "output_stage.hpp"
+#include "telemetry.hpp"
+#include "event_log.hpp"
+#include "trajectory_file.hpp"
+#include "path_planner.hpp"
+#include "path_slot.hpp"
+#include "latency_estimator.hpp"
+
+// Path tables are played one sample per millisecond, in meters.
+#define PATH_SAMPLE_RATE_HZ 1000
 
 enum motor_axis {LY, LX, RY, RX}; 
 
+// Position tracking error (m) over a run or a streaming cycle
+struct tracking_error {
+	double sum_squares;
+	double max_abs;
+	uint32_t samples;
+
+	tracking_error() { reset(); }
+
+	void reset()
+	{
+		sum_squares = 0;
+		max_abs = 0;
+		samples = 0;
+	}
+
+	void add(double error)
+	{
+		double abs_error = (error < 0) ? -error : error;
+		sum_squares += error*error;
+		if (abs_error > max_abs)
+			max_abs = abs_error;
+		samples++;
+	}
+
+	double rms() const
+	{
+		return((samples > 0) ? sqrt(sum_squares/samples) : 0);
+	}
+};
+
 std::string enum2string(motor_axis axis);
 
 class dc_motor 
@@ -66,6 +109,9 @@ public:
 	// DIR Pin
 	int dir_pin;
 
+	// Last level written to the DIR pin (-1 if unknown)
+	int current_dir;
+
 	// PWM pin;
 	int pwm_pin;
 
@@ -109,6 +155,11 @@ public:
 	// Derivative constant for velocity control
 	double derivative_constant; 
 
+	// Friction feedforward (PWM duty cycle) added while the path moves up
+	// or down. Fitted by sysid; 0 leaves it all to the feedback.
+	double friction_up_ff;
+	double friction_down_ff;
+
 	// Kinect constant
 	double kinect_constant;
 
@@ -118,15 +169,59 @@ public:
 	// Pointer to an encoder object
 	rot_encoder* encoder;
 
-	// Pointer to the velocity path vector
-	std::vector<double> velocity_path;
+	// View of the velocity path. Points into a mapped trajectory file, or
+	// into velocity_storage when loaded from text.
+	path_view velocity_path;
+
+	// View of the distance path. Same as above.
+	path_view distance_path;
 
-	// Pointer to the distance path vector
-	std::vector<double> distance_path;
+	// Paths loaded from text files
+	std::vector<double> velocity_storage;
+	std::vector<double> distance_storage;
+
+	// Polynomial path evaluated at the exact tick (see path_planner.hpp).
+	// When it has a path it is used instead of the tables above.
+	path_cursor segment_cursor;
+
+	// Second path buffer, so a new path can be staged while the cursor
+	// plays (see path_slot.hpp).
+	path_slot segment_slot;
 
 	// Pointer to a UDP connection object
 	udp_connection* udp_comm;
 
+	// Every control loop iteration is recorded here. Register it with a
+	// telemetry_writer to have it written to disk.
+	telemetry_channel telemetry;
+
+	// Output stage to batch pin writes with other axes (NULL to write
+	// pins directly)
+	output_stage* outputs;
+
+	// Event log for the limit switches, encoder and runs, or NULL
+	event_recorder* recorder;
+
+	// Actuation latency lookahead (us). The feedforward follows the path
+	// this far ahead of now so that it is current when the output takes
+	// effect. The feedback still acts on the path at now.
+	int lookahead_us;
+
+	// Measures the actual latency during path runs. It is printed at the
+	// end of every run next to the lookahead.
+	latency_estimator latency;
+
+	// Position error against the path setpoint. Reset at the start of a
+	// run and by axis_group at every streaming cycle.
+	tracking_error tracking;
+
+	// How long CV commands took to be acted on during the last CV run
+	cv_delay_stats cv_delay;
+
+	// Fixed-rate scheduler for the control loops. Also keeps the loop
+	// period, jitter and deadline miss statistics for this axis.
+	control_timer loop_timer;
+
 	// Public Functions:
 	// Default Constructor
 	dc_motor();
@@ -143,15 +238,54 @@ public:
 	// Set velocity path
 	void set_velocity_file(std::string velocityFile);
 
+	// Set both paths from one binary trajectory file (.traj). Files not
+	// sampled at PATH_SAMPLE_RATE_HZ or not in meters are refused.
+	void set_trajectory_file(std::string trajectoryFile);
+
+	// Set both paths from vectors sampled every millisecond (for example
+	// from the path planner). The motor keeps its own copy.
+	void set_paths(const std::vector<double>& distance, const std::vector<double>& velocity);
+
+	// Run a polynomial path instead of the tables (NULL to go back to the
+	// tables). The path is not copied and must outlive the run.
+	void set_segment_path(const piecewise_path* path);
+
+	// Stage a new polynomial path, copied, to take over from the running
+	// one at its next swap period (or at the start of the next run).
+	// Returns false while an earlier one is still waiting.
+	bool stage_segment_path(const piecewise_path& path);
+	bool segment_path_pending() const;
+
 	// Run Open Loop velocity path
-	void run_ol_path(uint32_t InitializationTick, int DelaySeconds);
+	void run_ol_path(uint64_t InitializationTick, int DelaySeconds);
 
 	// Run PD-Feedforward velocity path
-	void run_pdff_path(uint32_t InitializationTick, int DelaySeconds);
+	void run_pdff_path(uint64_t InitializationTick, int DelaySeconds);
+
+	// The three pieces of run_pdff_path, so a multi-axis loop can step
+	// several motors together (see axis_group).
+	// Check the path is runnable and arm the limit switches.
+	bool begin_pdff_path();
+
+	// One control period at now_tick. Returns false when the path is over.
+	bool step_pdff_path(uint64_t now_tick, uint64_t start_tick);
+
+	// Stop the motor
+	void end_pdff_path();
+
+	// The same for streaming: the polynomial path's loop repeats until
+	// finish_stream_path(), then the rampdown plays and step_stream_path()
+	// returns false. Needs a segment path with a loop. The telemetry
+	// record of the first period of each loop cycle is marked as a cycle
+	// start.
+	bool begin_stream_path();
+	bool step_stream_path(uint64_t now_tick, uint64_t start_tick);
+	void finish_stream_path();
+	void end_stream_path();
 
 	// Runs PD-Feedforward velocity path, then follows kinect.
 	// Terminates when ball is caught. 
-	void run_pdff_cv_path(uint32_t InitializationTick, int DelaySeconds);
+	void run_pdff_cv_path(uint64_t InitializationTick, int DelaySeconds);
 
 	// Point control -- Goes to user defined point
 	void point_control();
@@ -167,6 +301,10 @@ public:
 	// Unconditional motor stop
 	void stop();
 
+	// Route direction and PWM writes through a shared output stage, or
+	// straight to the pins if stage is NULL.
+	void set_output_stage(output_stage* stage);
+
 	// Start polling the pins to latch the limit switches on contact
 	void activate_limit_latching();
     
@@ -175,7 +313,8 @@ public:
 
 	static void _static_limit_hit(int gpio_caller, int level, uint32_t tick, void *userdata);
 
-	void _limit_hit(int gpio_caller, int level);
+	// Returns the level read back from the pin (1 if it was not read)
+	int _limit_hit(int gpio_caller, int level);
 
 	// reset the limit switches;
 	void reset_limit_latches();
@@ -195,6 +334,13 @@ public:
 	// set the homing parameters
 	void set_homing_parameters(double limitWidth, double workspaceWidth, int upPWM, int downPWM);
 
+	// Set the friction feedforward (duty cycle to keep moving up and down)
+	void set_friction_feedforward(double up, double down);
+
+	// Load fitted motor parameters (written by sysid) over the constants
+	// set so far. Only the parameters in the file change. 0 for success.
+	int load_parameters(std::string parameterFile);
+
 	// return flag that tells if motor is done running.
 	bool all_done();
 
@@ -204,9 +350,40 @@ public:
 	// Add a UDP connection object to let the motor talk to the kinect
 	void add_comm(udp_connection* comm);
 
+	// Log this axis's limit switch alerts, encoder and runs (event_log.hpp)
+	void set_recorder(event_recorder* recorder);
+
+	// Log that a run in mode is starting, with the constants it runs
+	// with. start_tick is when the path starts, or the CV timeout. Call
+	// after the run is marked in the telemetry and before its first period.
+	void record_run(event_run_mode mode, uint64_t start_tick);
 
+	// Set the control loop rate (Hz)
+	void set_control_rate(int rate_hz);
+
+	// Set the actuation latency lookahead (us)
+	void set_lookahead(int microseconds);
+
+	// Statistics from the most recent control loop
+	control_loop_stats get_loop_stats();
+
+
+
+	// Apply a control effort: direction from its sign, PWM from its
+	// magnitude clipped at 255. Returns the duty cycle.
+	int drive(double control_law);
+
+	// Record a control loop iteration to telemetry, with the alert
+	// sequence the state was read at and whether an alert raced the read
+	void record_telemetry(uint64_t tick, double d_d, double v_d, double d, double v, double control_law, int duty_cycle,
+	                      uint32_t alert_sequence = 0, bool alert_race = false);
 
 private:
+
+	// Pin writes that go through the output stage if one is set
+	void write_direction(int level);
+	void write_pwm(int duty_cycle);
+
 	// Disable default copy constructor and assignment operator by declaring
 	// them private
 	dc_motor(const dc_motor&);
@@ -0,0 +1,280 @@
+/* event_log.cpp
+
+   Created 10/16/2026
+
+   This is the cpp file holding the function definitions for the
+   event_recorder class. See event_log.hpp.
+*/
+
+#include <string.h>
+#include "event_log.hpp"
+#include "mono_clock.hpp"
+#include "path_planner.hpp"
+#include "trajectory_file.hpp"
+
+using namespace std;
+
+// Events copied out of a queue per write
+#define EVENT_WRITE_BATCH 512
+
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+unsigned event_record_size(uint8_t type)
+{
+	switch (type)
+	{
+		case EVENT_ENCODER:
+		case EVENT_LIMIT:
+			return(sizeof(event_alert));
+		case EVENT_GAP:
+			return(sizeof(event_gap));
+		case EVENT_DATAGRAM:
+			return(sizeof(event_datagram));
+		case EVENT_PUBLISH:
+			return(sizeof(event_publish));
+		case EVENT_LISTEN:
+			return(sizeof(event_listen));
+		case EVENT_SETUP:
+			return(sizeof(event_setup));
+		case EVENT_RESET:
+			return(sizeof(event_reset));
+		case EVENT_RUN:
+			return(sizeof(event_run));
+	}
+	return(0);
+}
+
+static uint64_t fnv_add(uint64_t hash, const void* data, size_t size)
+{
+	const uint8_t* bytes = (const uint8_t*) data;
+	for (size_t i = 0; i < size; i++)
+		hash = (hash ^ bytes[i]) * FNV_PRIME;
+	return(hash);
+}
+
+uint64_t path_fingerprint(const path_view& distance, const path_view& velocity)
+{
+	uint64_t hash = fnv_add(FNV_OFFSET, distance.data, distance.size()*sizeof(double));
+	return(fnv_add(hash, velocity.data, velocity.size()*sizeof(double)));
+}
+
+// Only what the control loop evaluates: the durations and the position
+// and velocity polynomials.
+static uint64_t fnv_periods(uint64_t hash, const vector<path_period>& periods)
+{
+	for (size_t i = 0; i < periods.size(); i++)
+	{
+		hash = fnv_add(hash, &(periods[i].duration), sizeof(double));
+		hash = fnv_add(hash, periods[i].d_poly.c, sizeof(periods[i].d_poly.c));
+		hash = fnv_add(hash, periods[i].v_poly.c, sizeof(periods[i].v_poly.c));
+	}
+	return(hash);
+}
+
+uint64_t path_fingerprint(const piecewise_path& path)
+{
+	uint64_t hash = fnv_periods(FNV_OFFSET, path.rampup);
+	hash = fnv_periods(hash, path.loop);
+	return(fnv_periods(hash, path.rampdown));
+}
+
+// Default Constructor
+event_recorder::event_recorder()
+{
+	sequence.store(0);
+	alert_gap = 0;
+	datagram_gap = 0;
+	for (int i = 0; i < EVENT_AXES; i++)
+		mark_gap[i] = 0;
+	alerts_dropped.store(0);
+	datagrams_dropped.store(0);
+	marks_dropped.store(0);
+	file = NULL;
+}
+
+// Destructor
+event_recorder::~event_recorder()
+{
+	this->close();
+}
+
+void event_recorder::push_udp(const event_udp_slot& slot)
+{
+	if (datagram_gap)
+	{
+		event_udp_slot gap;
+		gap.gap.type = EVENT_GAP;
+		gap.gap.source = EVENT_DATAGRAM;
+		gap.gap.axis = 0;
+		gap.gap.reserved = 0;
+		gap.gap.dropped = datagram_gap;
+		if (datagrams.push(gap))
+			datagram_gap = 0;
+	}
+	if (datagram_gap || !(datagrams.push(slot)))
+	{
+		datagram_gap++;
+		datagrams_dropped.fetch_add(1, memory_order_relaxed);
+	}
+}
+
+void event_recorder::push_mark(int axis, const event_mark& mark)
+{
+	if ((axis < 0) || (axis >= EVENT_AXES))
+		return;
+
+	if (mark_gap[axis])
+	{
+		event_mark gap;
+		gap.gap.type = EVENT_GAP;
+		gap.gap.source = EVENT_RUN;
+		gap.gap.axis = (uint8_t) axis;
+		gap.gap.reserved = 0;
+		gap.gap.dropped = mark_gap[axis];
+		if (marks[axis].push(gap))
+			mark_gap[axis] = 0;
+	}
+	if (mark_gap[axis] || !(marks[axis].push(mark)))
+	{
+		mark_gap[axis]++;
+		marks_dropped.fetch_add(1, memory_order_relaxed);
+	}
+}
+
+void event_recorder::record_datagram(const char* data, int length, uint64_t recv_tick)
+{
+	// Datagrams are never longer than the listener's buffer, but make sure.
+	if (length > EVENT_MAX_DATAGRAM)
+		length = EVENT_MAX_DATAGRAM;
+
+	event_udp_slot slot;
+	memset(&(slot.datagram.header), 0, sizeof(slot.datagram.header));
+	slot.datagram.header.type = EVENT_DATAGRAM;
+	slot.datagram.header.length = (uint16_t) length;
+	slot.datagram.header.recv_tick = recv_tick;
+	memcpy(slot.datagram.data, data, length);
+	this->push_udp(slot);
+}
+
+void event_recorder::record_publish(uint32_t accepted, uint64_t recv_tick, uint64_t publish_tick)
+{
+	event_udp_slot slot;
+	memset(&(slot.publish), 0, sizeof(slot.publish));
+	slot.publish.type = EVENT_PUBLISH;
+	slot.publish.accepted = accepted;
+	slot.publish.recv_tick = recv_tick;
+	slot.publish.publish_tick = publish_tick;
+	this->push_udp(slot);
+}
+
+void event_recorder::record_listen(double catch_height)
+{
+	event_udp_slot slot;
+	memset(&(slot.listen), 0, sizeof(slot.listen));
+	slot.listen.type = EVENT_LISTEN;
+	slot.listen.catch_height = catch_height;
+	this->push_udp(slot);
+}
+
+void event_recorder::record_setup(int axis, int a_pin, int b_pin, int z_pin, int velocity_points)
+{
+	event_mark mark;
+	memset(&mark, 0, sizeof(mark));
+	mark.setup.type = EVENT_SETUP;
+	mark.setup.axis = (uint8_t) axis;
+	mark.setup.a_pin = (uint8_t) a_pin;
+	mark.setup.b_pin = (uint8_t) b_pin;
+	mark.setup.z_pin = (uint8_t) z_pin;
+	mark.setup.velocity_points = (uint8_t) velocity_points;
+	this->push_mark(axis, mark);
+}
+
+void event_recorder::record_reset(int axis, uint32_t sequence_before, uint32_t sequence_after)
+{
+	event_mark mark;
+	memset(&mark, 0, sizeof(mark));
+	mark.reset.type = EVENT_RESET;
+	mark.reset.axis = (uint8_t) axis;
+	mark.reset.sequence_before = sequence_before;
+	mark.reset.sequence_after = sequence_after;
+	this->push_mark(axis, mark);
+}
+
+void event_recorder::record_run(const event_run& run)
+{
+	event_mark mark;
+	mark.run = run;
+	mark.run.type = EVENT_RUN;
+	this->push_mark(run.axis, mark);
+}
+
+int event_recorder::open(string filename)
+{
+	file = fopen(filename.c_str(), "wb");
+	if (!file)
+	{
+		printf("Event log %s failed to open.\n", filename.c_str());
+		return(1);
+	}
+
+	event_file_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, EVENT_MAGIC, 4);
+	header.version = EVENT_VERSION;
+	header.start_tick = mono_tick();
+	fwrite(&header, sizeof(header), 1, file);
+	return(0);
+}
+
+void event_recorder::drain()
+{
+	// Alerts are fixed size and go out as they are.
+	event_alert batch[EVENT_WRITE_BATCH];
+	unsigned n;
+	while ((n = alerts.pop_many(batch, EVENT_WRITE_BATCH)) > 0)
+	{
+		if (file)
+			fwrite(batch, sizeof(event_alert), n, file);
+	}
+
+	event_udp_slot slot;
+	while (datagrams.pop(slot))
+	{
+		if (!file)
+			continue;
+		fwrite(&slot, event_record_size(slot.gap.type), 1, file);
+		if (slot.gap.type == EVENT_DATAGRAM)
+			fwrite(slot.datagram.data, 1, slot.datagram.header.length, file);
+	}
+
+	event_mark mark;
+	for (int i = 0; i < EVENT_AXES; i++)
+	{
+		while (marks[i].pop(mark))
+		{
+			if (file)
+				fwrite(&mark, event_record_size(mark.gap.type), 1, file);
+		}
+	}
+
+	if (file)
+		fflush(file);
+}
+
+void event_recorder::close()
+{
+	if (!file)
+		return;
+
+	this->drain();
+	fclose(file);
+	file = NULL;
+
+	unsigned long long alerts_lost = alerts_dropped.load();
+	unsigned long long datagrams_lost = datagrams_dropped.load();
+	unsigned long long marks_lost = marks_dropped.load();
+	if (alerts_lost || datagrams_lost || marks_lost)
+		printf("Event log dropped %llu alerts, %llu datagram records and %llu axis marks.\n",
+		       alerts_lost, datagrams_lost, marks_lost);
+}
@@ -0,0 +1,328 @@
+/* event_log.hpp
+
+   Created 10/16/2026
+
+   This is the header file for the event_recorder class and the event log
+   it writes.
+
+   A control loop only decides from what comes in from outside: encoder
+   and limit switch alerts, CV datagrams, and the runs it is told to do.
+   The event_recorder keeps all of them in lock-free queues, and the
+   telemetry_writer thread writes them to events.bin next to the telemetry
+   files (telemetry_writer::set_event_log). event_replay feeds them back
+   through the same code on the simulated clock (sim_gpio.hpp) and checks
+   that every control period comes out the same as in the telemetry.
+
+   Every recorded alert callback bumps the alert sequence on the way in
+   and again on the way out, so it is odd while a callback runs and twice
+   the number of finished callbacks otherwise. Each telemetry record
+   carries the sequence its encoder and limit state was read at, which
+   tells the replay exactly which alerts that control period saw. A period
+   that read while a callback was running is flagged TELEMETRY_ALERT_RACE
+   and cannot be replayed exactly.
+
+   Recording never blocks and never allocates. An alert costs two stores
+   and an 8 byte queue push (event_replay --bench measures it). If the
+   writer falls behind, events are dropped and counted, and a gap record
+   goes in their place so the replay knows where it stops being exact.
+
+   File layout (little endian, as written by the Pi):
+     event_file_header
+     records, each starting with its type byte
+   Alerts are in the order they ran. Datagrams, publishes and listens are
+   in the order the listener saw them, and encoder setups, resets and runs
+   in order for each axis, but the three streams are written in batches
+   and not interleaved in time.
+
+   Queues and their producers:
+     alerts      the alert thread (pigpio has one; in the simulator alerts
+                 are serialised by its lock)
+     datagrams   the UDP listener thread
+     axis marks  whichever thread is running that axis, one at a time
+*/
+
+#ifndef __EVENT_LOG_HPP__
+#define __EVENT_LOG_HPP__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <string>
+#include "spsc_queue.hpp"
+
+#define EVENT_MAGIC "JREV"
+#define EVENT_VERSION 1
+
+// Alerts buffered. Four encoders flat out are well under 100k edges a
+// second, so this covers several missed drains.
+#define EVENT_ALERT_QUEUE_SIZE 16384
+
+// Datagrams and publishes buffered, and the largest datagram kept
+#define EVENT_DATAGRAM_QUEUE_SIZE 128
+#define EVENT_MAX_DATAGRAM 1024
+
+// Encoder setups, count resets and runs buffered per axis
+#define EVENT_MARK_QUEUE_SIZE 64
+#define EVENT_AXES 4
+
+enum event_type {
+	EVENT_ENCODER = 1,   // event_alert from rot_encoder
+	EVENT_LIMIT = 2,     // event_alert from dc_motor's limit switches
+	EVENT_GAP = 3,       // event_gap
+	EVENT_DATAGRAM = 4,  // event_datagram, then length bytes
+	EVENT_PUBLISH = 5,   // event_publish
+	EVENT_LISTEN = 6,    // event_listen
+	EVENT_SETUP = 7,     // event_setup
+	EVENT_RESET = 8,     // event_reset
+	EVENT_RUN = 9        // event_run
+};
+
+// How a run was controlled
+enum event_run_mode {
+	EVENT_RUN_OL = 0,     // run_ol_path
+	EVENT_RUN_PDFF = 1,   // run_pdff_path, axis_group::run_pdff, and the
+	                      // path half of run_pdff_cv_path
+	EVENT_RUN_CV = 2,     // the CV half of run_pdff_cv_path
+	EVENT_RUN_STREAM = 3, // axis_group streaming
+	EVENT_RUN_OTHER = 4   // anything else that records telemetry
+};
+
+// event_alert level bit for a limit switch: the pin read back high
+#define EVENT_PIN_HIGH 0x02
+
+// event_run flags
+#define EVENT_RUN_LIMIT_LATCHED 0x01
+#define EVENT_RUN_SEGMENTS 0x02
+
+struct event_file_header {
+	char magic[4];
+	uint16_t version;
+	uint16_t reserved;
+	uint64_t start_tick;      // mono_tick() when the log was opened
+} __attribute__((packed));
+
+// One alert callback, with the tick pigpio gave it
+struct event_alert {
+	uint8_t type;
+	uint8_t gpio;
+	uint8_t level;
+	uint8_t axis;
+	uint32_t tick;
+} __attribute__((packed));
+
+// Events of one kind were dropped here
+struct event_gap {
+	uint8_t type;
+	uint8_t source;           // what was dropped: EVENT_ENCODER for
+	                          // alerts, EVENT_DATAGRAM for the listener's
+	                          // records, EVENT_RUN for an axis's marks
+	uint8_t axis;             // for EVENT_RUN
+	uint8_t reserved;
+	uint32_t dropped;
+} __attribute__((packed));
+
+static_assert(sizeof(event_gap) == sizeof(event_alert), "Gaps go in the alert queue");
+
+// A datagram as it came off the socket, before it was applied
+struct event_datagram {
+	uint8_t type;
+	uint8_t reserved;
+	uint16_t length;
+	uint32_t reserved2;
+	uint64_t recv_tick;
+} __attribute__((packed));
+
+// The listener published the commands after a wakeup
+struct event_publish {
+	uint8_t type;
+	uint8_t reserved[3];
+	uint32_t accepted;        // datagrams that changed the commands
+	uint64_t recv_tick;       // tick the command is stamped with
+	uint64_t publish_tick;    // mono_tick() once it was visible
+} __attribute__((packed));
+
+// The listener started (udp_connection::start_listening)
+struct event_listen {
+	uint8_t type;
+	uint8_t reserved[7];
+	double catch_height;
+} __attribute__((packed));
+
+// An encoder was attached to the recorder
+struct event_setup {
+	uint8_t type;
+	uint8_t axis;
+	uint8_t a_pin;
+	uint8_t b_pin;
+	uint8_t z_pin;
+	uint8_t velocity_points;
+	uint16_t reserved;
+} __attribute__((packed));
+
+// rot_encoder::resetCount(), with the alert sequence either side of it
+struct event_reset {
+	uint8_t type;
+	uint8_t axis;
+	uint16_t reserved;
+	uint32_t sequence_before;
+	uint32_t sequence_after;
+} __attribute__((packed));
+
+// A run is about to start, with everything its control law reads
+struct event_run {
+	uint8_t type;
+	uint8_t axis;
+	uint8_t mode;             // event_run_mode
+	uint8_t flags;
+	int8_t dir_factor;
+	uint8_t dir_pin;
+	uint8_t pwm_pin;
+	uint8_t u_limit_switch;
+	uint8_t l_limit_switch;
+	uint8_t reserved[3];
+	uint32_t alert_sequence;
+	int32_t lookahead_us;
+	int32_t workspace_width_count;
+	uint32_t path_length;     // samples in the velocity table
+	uint64_t first_record;    // telemetry records queued before the run
+	uint64_t start_tick;      // path start, or the CV timeout
+	uint64_t path_fingerprint;
+	double count_per_meter;
+	double pwm_constant;
+	double velocity_ff_constant;
+	double proportional_constant;
+	double derivative_constant;
+	double friction_up_ff;
+	double friction_down_ff;
+	double kinect_constant;
+} __attribute__((packed));
+
+// Size of a record on disk from its type byte, not counting a datagram's
+// bytes. 0 for an unknown type.
+unsigned event_record_size(uint8_t type);
+
+struct path_view;
+class piecewise_path;
+
+// 64 bit FNV-1a over the paths a run follows, so the replay can tell it
+// has been given the same ones.
+uint64_t path_fingerprint(const path_view& distance, const path_view& velocity);
+uint64_t path_fingerprint(const piecewise_path& path);
+
+class event_recorder
+{
+public:
+
+	// Default Constructor
+	event_recorder();
+
+	// Destructor
+	~event_recorder();
+
+	// ALERT THREAD: Call around every recorded alert callback. The event
+	// goes in the log when the callback is done, so a limit switch can
+	// record what it read back.
+	void begin_alert()
+	{
+		uint32_t s = sequence.load(std::memory_order_relaxed);
+		sequence.store(s + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+	}
+
+	void end_alert(uint8_t type, int gpio, int level, int axis, uint32_t tick)
+	{
+		if (alert_gap)
+		{
+			event_alert gap = {EVENT_GAP, EVENT_ENCODER, 0, 0, alert_gap};
+			if (alerts.push(gap))
+				alert_gap = 0;
+		}
+		event_alert alert = {type, (uint8_t) gpio, (uint8_t) level, (uint8_t) axis, tick};
+		if (alert_gap || !(alerts.push(alert)))
+		{
+			alert_gap++;
+			alerts_dropped.fetch_add(1, std::memory_order_relaxed);
+		}
+		sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	// ANY THREAD: The alert sequence. Read it before reading state the
+	// alerts change, and alert_sequence_after() once done; if the two
+	// differ or the first is odd, an alert ran in between.
+	uint32_t alert_sequence() const
+	{
+		return(sequence.load(std::memory_order_acquire));
+	}
+
+	uint32_t alert_sequence_after() const
+	{
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return(sequence.load(std::memory_order_relaxed));
+	}
+
+	// LISTENER THREAD: A datagram before it is handled, the commands
+	// being published, and the listener starting.
+	void record_datagram(const char* data, int length, uint64_t recv_tick);
+	void record_publish(uint32_t accepted, uint64_t recv_tick, uint64_t publish_tick);
+	void record_listen(double catch_height);
+
+	// AXIS THREAD: An encoder attached, its count reset, and a run about
+	// to start.
+	void record_setup(int axis, int a_pin, int b_pin, int z_pin, int velocity_points);
+	void record_reset(int axis, uint32_t sequence_before, uint32_t sequence_after);
+	void record_run(const event_run& run);
+
+	// WRITER THREAD: Open the log and write the header, write out what is
+	// waiting, and close it.
+	int open(std::string filename);
+	void drain();
+	void close();
+
+private:
+
+	// Queue slots. The first byte of each is its record's type.
+	union event_udp_slot {
+		event_gap gap;
+		event_publish publish;
+		event_listen listen;
+		struct {
+			event_datagram header;
+			char data[EVENT_MAX_DATAGRAM];
+		} datagram;
+	};
+
+	union event_mark {
+		event_gap gap;
+		event_setup setup;
+		event_reset reset;
+		event_run run;
+	};
+
+	// Push, or count it dropped. A gap record goes in first if the last
+	// ones were dropped.
+	void push_udp(const event_udp_slot& slot);
+	void push_mark(int axis, const event_mark& mark);
+
+	std::atomic<uint32_t> sequence;
+
+	spsc_queue<event_alert, EVENT_ALERT_QUEUE_SIZE> alerts;
+	spsc_queue<event_udp_slot, EVENT_DATAGRAM_QUEUE_SIZE> datagrams;
+	spsc_queue<event_mark, EVENT_MARK_QUEUE_SIZE> marks[EVENT_AXES];
+
+	// Dropped since the last gap record, owned by each producer
+	uint32_t alert_gap;
+	uint32_t datagram_gap;
+	uint32_t mark_gap[EVENT_AXES];
+
+	std::atomic<uint64_t> alerts_dropped;
+	std::atomic<uint64_t> datagrams_dropped;
+	std::atomic<uint64_t> marks_dropped;
+
+	FILE* file;
+
+	// Disable default copy constructor, and assignment operator
+	event_recorder(const event_recorder&);
+	event_recorder& operator=(const event_recorder&);
+};
+
+#endif
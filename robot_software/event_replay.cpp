@@ -0,0 +1,752 @@
+/* event_replay.cpp
+
+   Created 10/16/2026
+
+   Replays one axis of a session off the robot. The encoder and limit
+   switch alerts, CV datagrams and runs in an event log (event_log.hpp)
+   are fed back through the robot's own rot_encoder, dc_motor,
+   udp_connection and control loops, built against the simulated GPIO
+   (make event_replay), with the clock moved to the tick of each control
+   period in the axis's telemetry file. Given the same inputs the loop
+   makes the same decisions, so every period is checked bit for bit
+   against the one the robot recorded, and a failed catch can then be
+   stepped through in a debugger.
+
+   Each period is given exactly the alerts the robot had finished when it
+   read the encoder (the alert sequence in its telemetry record), and the
+   CV commands published by its tick. Periods the robot flagged as racing
+   an alert are counted; they can differ. Streaming and follow_kinect runs
+   are not replayed, but their alerts still are, so the encoder is right
+   for the runs after them. Homing is not replayed either; the counts per
+   meter it measured come from the log.
+
+   The constants and pins come from the log, the paths do not. Give the
+   ones the robot ran, which are checked against the log's fingerprint:
+       --paths position.txt,velocity.txt   tables, as dc_motor loads them
+       --traj name.traj                    a trajectory file
+       --height H                          the level 1 plan main.cpp makes
+                                           with plan_y_paths
+   By default the axis's path files from main.cpp are used.
+
+   Usage: ./event_replay [--paths P,V | --traj T | --height H] [--run N]
+                         events.bin telemetry_XX.bin
+          ./event_replay --bench [alerts]
+
+   --run only checks run N (from 1). --bench measures what recording adds
+   to an encoder alert callback, with a writer draining the log meanwhile.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <vector>
+#include "hal.hpp"
+#include "mono_clock.hpp"
+#include "dc_motor.hpp"
+#include "control_loop.hpp"
+#include "event_log.hpp"
+#include "telemetry.hpp"
+
+#ifndef ROBOT_SIM
+#error "event_replay runs on the simulated GPIO. Build it with make event_replay."
+#endif
+
+// Nothing runs off the simulated clock here, so it can jump straight to
+// each period.
+#define REPLAY_STEP_US 1000000000
+
+// Flags the replay must reproduce
+#define REPLAY_FLAGS (TELEMETRY_LIMIT_LATCHED | TELEMETRY_RUN_START)
+
+// Alerts per timed batch, and the rate they come at (per second)
+#define BENCH_BATCH 64
+#define BENCH_RATE 100000
+#define BENCH_DEFAULT_ALERTS 200000
+
+using namespace std;
+
+// Each axis's path files in main.cpp, position then velocity
+static const char* default_paths[EVENT_AXES][2] = {
+	{"y_throw_position_higher_throw_50cm.txt", "y_throw_velocity_higher_throw_50cm.txt"},
+	{"x_throw_velocity_calculated.txt", "x_throw_velocity_calculated.txt"},
+	{"y_throw_position_higher_throw_50cm.txt", "y_throw_velocity_higher_throw_50cm.txt"},
+	{"constant_0_500ms.txt", "constant_0_500ms.txt"}
+};
+
+static const char* mode_names[] = {"open loop", "PD-feedforward", "CV", "streaming", "other"};
+
+// An event log read into memory. Records stay where they are in data and
+// are found through the offsets.
+struct event_log_file {
+	event_file_header header;
+	vector<uint8_t> data;
+	vector<event_alert> alerts;
+	vector<size_t> listener;
+	vector<size_t> marks[EVENT_AXES];
+};
+
+// Where the replay has got to
+struct replay_state {
+	const event_log_file* log;
+	int axis;
+	dc_motor* motor;
+	udp_connection* udp;
+	size_t next_alert;
+	uint32_t sequence;   // alert sequence the replay has reached
+	size_t next_listener;
+	bool gap;            // events are missing from here on
+};
+
+// One run's results
+struct run_result {
+	uint64_t periods;
+	uint64_t identical;
+	uint64_t races;
+	bool differed;
+};
+
+static void print_usage(const char* name)
+{
+	printf("Usage: %s [--paths position.txt,velocity.txt | --traj name.traj | --height H] [--run N]\n"
+	       "       events.bin telemetry_XX.bin\n"
+	       "       %s --bench [alerts]\n", name, name);
+}
+
+static double wall_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return(ts.tv_sec*1e9 + ts.tv_nsec);
+}
+
+template <typename T>
+static T record_at(const event_log_file& log, size_t offset)
+{
+	T rec;
+	memcpy(&rec, &(log.data[offset]), sizeof(rec));
+	return(rec);
+}
+
+static int load_events(string filename, event_log_file& log)
+{
+	FILE* file = fopen(filename.c_str(), "rb");
+	if (!file)
+	{
+		printf("Could not open %s\n", filename.c_str());
+		return(1);
+	}
+
+	if ((fread(&(log.header), sizeof(log.header), 1, file) != 1) || (memcmp(log.header.magic, EVENT_MAGIC, 4) != 0) ||
+	    (log.header.version != EVENT_VERSION))
+	{
+		printf("%s is not an event log from this build.\n", filename.c_str());
+		fclose(file);
+		return(1);
+	}
+
+	uint8_t buffer[65536];
+	size_t n;
+	while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		log.data.insert(log.data.end(), buffer, buffer + n);
+	fclose(file);
+
+	// A log cut short by a crash ends at its last whole record.
+	size_t pos = 0;
+	while (pos < log.data.size())
+	{
+		uint8_t type = log.data[pos];
+		size_t size = event_record_size(type);
+		if (size == 0)
+		{
+			printf("%s has an unknown record at byte %llu. Stopping there.\n", filename.c_str(),
+			       (unsigned long long) (pos + sizeof(log.header)));
+			break;
+		}
+		if (type == EVENT_DATAGRAM && (pos + size <= log.data.size()))
+			size += record_at<event_datagram>(log, pos).length;
+		if (pos + size > log.data.size())
+			break;
+
+		if ((type == EVENT_ENCODER) || (type == EVENT_LIMIT))
+			log.alerts.push_back(record_at<event_alert>(log, pos));
+		else if (type == EVENT_GAP)
+		{
+			event_gap gap = record_at<event_gap>(log, pos);
+			if (gap.source == EVENT_ENCODER)
+				log.alerts.push_back(record_at<event_alert>(log, pos));
+			else if (gap.source == EVENT_DATAGRAM)
+				log.listener.push_back(pos);
+			else if (gap.axis < EVENT_AXES)
+				log.marks[gap.axis].push_back(pos);
+		}
+		else if ((type == EVENT_DATAGRAM) || (type == EVENT_PUBLISH) || (type == EVENT_LISTEN))
+			log.listener.push_back(pos);
+		else if (log.data[pos + 1] < EVENT_AXES)
+			log.marks[log.data[pos + 1]].push_back(pos);
+		pos += size;
+	}
+	return(0);
+}
+
+static int load_telemetry(string filename, int& axis, vector<telemetry_record>& records)
+{
+	FILE* file = fopen(filename.c_str(), "rb");
+	if (!file)
+	{
+		printf("Could not open %s\n", filename.c_str());
+		return(1);
+	}
+
+	telemetry_file_header header;
+	if ((fread(&header, sizeof(header), 1, file) != 1) || (memcmp(header.magic, TELEMETRY_MAGIC, 4) != 0) ||
+	    (header.record_size != sizeof(telemetry_record)))
+	{
+		printf("%s is not a telemetry file from this build.\n", filename.c_str());
+		fclose(file);
+		return(1);
+	}
+
+	axis = -1;
+	for (int i = 0; i < EVENT_AXES; i++)
+	{
+		if (strncmp(header.axis_name, enum2string((motor_axis) i).c_str(), sizeof(header.axis_name)) == 0)
+			axis = i;
+	}
+	if (axis < 0)
+	{
+		printf("%s is for an axis this build does not have.\n", filename.c_str());
+		fclose(file);
+		return(1);
+	}
+
+	telemetry_record rec;
+	while (fread(&rec, sizeof(rec), 1, file) == 1)
+		records.push_back(rec);
+	fclose(file);
+	return(0);
+}
+
+// Give the replay every alert up to alert sequence target. Only the
+// replayed axis's alerts go to its callbacks.
+static void deliver_alerts(replay_state& state, uint32_t target)
+{
+	const vector<event_alert>& alerts = state.log->alerts;
+	while (((int32_t) (target - state.sequence) >= 2) && (state.next_alert < alerts.size()))
+	{
+		const event_alert& alert = alerts[state.next_alert++];
+		if (alert.type == EVENT_GAP)
+		{
+			const event_gap* gap = (const event_gap*) &alert;
+			if (!state.gap)
+				printf("The log dropped %u alerts at alert sequence %u. The replay is not exact from here.\n",
+				       gap->dropped, state.sequence);
+			state.gap = true;
+			state.sequence += 2*gap->dropped;
+			continue;
+		}
+
+		state.sequence += 2;
+		if (alert.axis != state.axis)
+			continue;
+		int level = alert.level & 1;
+		int pin_level = (alert.type == EVENT_LIMIT) ? ((alert.level & EVENT_PIN_HIGH) ? 1 : 0) : level;
+		sim_replay_alert(alert.gpio, level, pin_level, alert.tick);
+	}
+}
+
+// Apply the listener's records up to tick: datagrams by when they arrived
+// and publishes by when they became visible.
+static void deliver_listener(replay_state& state, uint64_t tick)
+{
+	const event_log_file& log = *(state.log);
+	udp_connection& udp = *(state.udp);
+	char buffer[EVENT_MAX_DATAGRAM + 1];
+
+	while (state.next_listener < log.listener.size())
+	{
+		size_t offset = log.listener[state.next_listener];
+		uint8_t type = log.data[offset];
+		if (type == EVENT_DATAGRAM)
+		{
+			event_datagram datagram = record_at<event_datagram>(log, offset);
+			if (datagram.recv_tick > tick)
+				return;
+			memcpy(buffer, &(log.data[offset + sizeof(datagram)]), datagram.length);
+			udp.handle_datagram(buffer, datagram.length, datagram.recv_tick);
+		}
+		else if (type == EVENT_PUBLISH)
+		{
+			event_publish publish = record_at<event_publish>(log, offset);
+			if (publish.publish_tick > tick)
+				return;
+			udp.link_stats.superseded += publish.accepted - 1;
+			udp.publish_commands(publish.recv_tick);
+		}
+		else if (type == EVENT_LISTEN)
+		{
+			// As start_listening() leaves it
+			event_listen listen = record_at<event_listen>(log, offset);
+			udp.set_catch_height(listen.catch_height);
+			memset(&(udp.link_stats), 0, sizeof(udp.link_stats));
+			udp.have_sequence = false;
+			udp.ball.reset();
+			udp.listener_flag = true;
+		}
+		else
+		{
+			event_gap gap = record_at<event_gap>(log, offset);
+			printf("The log dropped %u datagram records. CV runs after this may differ.\n", gap.dropped);
+		}
+		state.next_listener++;
+	}
+}
+
+static bool same_period(const telemetry_record& a, const telemetry_record& b)
+{
+	return((a.tick == b.tick) &&
+	       (memcmp(&(a.desired_position), &(b.desired_position), sizeof(float)) == 0) &&
+	       (memcmp(&(a.desired_velocity), &(b.desired_velocity), sizeof(float)) == 0) &&
+	       (memcmp(&(a.position), &(b.position), sizeof(float)) == 0) &&
+	       (memcmp(&(a.velocity), &(b.velocity), sizeof(float)) == 0) &&
+	       (memcmp(&(a.control_effort), &(b.control_effort), sizeof(float)) == 0) &&
+	       (a.duty_cycle == b.duty_cycle) && (((a.flags ^ b.flags) & REPLAY_FLAGS) == 0));
+}
+
+static void print_period(const char* who, const telemetry_record& rec)
+{
+	printf("  %s: desired %.9g m %.9g m/s, measured %.9g m %.9g m/s, effort %.9g, duty %d, flags 0x%02x\n",
+	       who, rec.desired_position, rec.desired_velocity, rec.position, rec.velocity,
+	       rec.control_effort, rec.duty_cycle, rec.flags);
+}
+
+// Step loop at the tick of each of the run's records, first to end, and
+// compare what it records with them.
+template <class Loop>
+static void replay_periods(replay_state& state, Loop& loop, const vector<telemetry_record>& records,
+                           uint64_t first, uint64_t end, int run, run_result& result)
+{
+	dc_motor& motor = *(state.motor);
+	for (uint64_t i = first; i < end; i++)
+	{
+		const telemetry_record& rec = records[i];
+		deliver_alerts(state, rec.alert_sequence);
+		deliver_listener(state, rec.tick);
+		if (rec.tick > sim_now())
+			sim_advance_to(rec.tick);
+
+		bool more = loop.step(rec.tick);
+
+		telemetry_record replayed;
+		if (!(motor.telemetry.queue.pop(replayed)))
+		{
+			printf("Run %d ended %llu periods early, at tick %llu.\n", run, (unsigned long long) (end - i),
+			       (unsigned long long) rec.tick);
+			result.differed = true;
+			return;
+		}
+
+		result.periods++;
+		if (rec.flags & TELEMETRY_ALERT_RACE)
+			result.races++;
+		if (same_period(rec, replayed))
+			result.identical++;
+		else if (!result.differed)
+		{
+			printf("Run %d first differs at period %llu, tick %llu%s:\n", run, (unsigned long long) (i - first + 1),
+			       (unsigned long long) rec.tick, (rec.flags & TELEMETRY_ALERT_RACE) ? " (it raced an alert)" : "");
+			print_period("robot ", rec);
+			print_period("replay", replayed);
+			result.differed = true;
+		}
+
+		if (!more && (i + 1 < end))
+		{
+			printf("Run %d ended %llu periods early, at tick %llu.\n", run, (unsigned long long) (end - i - 1),
+			       (unsigned long long) rec.tick);
+			result.differed = true;
+			return;
+		}
+	}
+}
+
+// Set the motor up as the run found it. Returns 0 if the paths given are
+// the ones it ran.
+static int apply_run(dc_motor& motor, const event_run& run)
+{
+	motor.dir_factor = run.dir_factor;
+	motor.lookahead_us = run.lookahead_us;
+	motor.workspace_width_count = run.workspace_width_count;
+	motor.count_per_meter = run.count_per_meter;
+	motor.pwm_constant = run.pwm_constant;
+	motor.velocity_ff_constant = run.velocity_ff_constant;
+	motor.proportional_constant = run.proportional_constant;
+	motor.derivative_constant = run.derivative_constant;
+	motor.friction_up_ff = run.friction_up_ff;
+	motor.friction_down_ff = run.friction_down_ff;
+	motor.kinect_constant = run.kinect_constant;
+	motor.limit_latch = ((run.flags & EVENT_RUN_LIMIT_LATCHED) != 0);
+	motor.home_flag = true;
+
+	// CV runs only follow the commands.
+	if (run.mode == EVENT_RUN_CV)
+		return(0);
+
+	const piecewise_path* path = motor.segment_cursor.get_path();
+	if (((run.flags & EVENT_RUN_SEGMENTS) != 0) != (path != NULL))
+		return(1);
+	uint64_t fingerprint = path ? path_fingerprint(*path) : path_fingerprint(motor.distance_path, motor.velocity_path);
+	return((fingerprint != run.path_fingerprint) ? 1 : 0);
+}
+
+// Replay one run. Returns 1 if it could not be.
+static int replay_run(replay_state& state, const event_run& run, const vector<telemetry_record>& records,
+                      uint64_t end, int number, run_result& result)
+{
+	dc_motor& motor = *(state.motor);
+	uint64_t first = run.first_record;
+	if (end > records.size())
+		end = records.size();
+	if (first > end)
+		first = end;
+
+	const char* mode = (run.mode <= EVENT_RUN_OTHER) ? mode_names[run.mode] : "unknown";
+	if ((run.mode != EVENT_RUN_OL) && (run.mode != EVENT_RUN_PDFF) && (run.mode != EVENT_RUN_CV))
+	{
+		printf("Run %d (%s, %llu periods) is not replayed.\n", number, mode, (unsigned long long) (end - first));
+		return(0);
+	}
+
+	// Alerts up to the run, before its constants are set
+	deliver_alerts(state, run.alert_sequence);
+	if (apply_run(motor, run))
+	{
+		printf("Run %d ran other paths than the ones given. Skipping it.\n", number);
+		return(1);
+	}
+
+	uint64_t start_tick = run.start_tick;
+	bool segments = (motor.segment_cursor.get_path() != NULL);
+	if (run.mode == EVENT_RUN_PDFF)
+	{
+		if (!(motor.begin_pdff_path()))
+			return(1);
+		if (segments)
+		{
+			pdff_segment_loop loop(motor, pdff_law(motor), segment_trajectory(&motor.segment_cursor, &motor.segment_slot, start_tick, motor.lookahead_us));
+			replay_periods(state, loop, records, first, end, number, result);
+		}
+		else
+		{
+			pdff_loop loop(motor, pdff_law(motor), table_trajectory(motor.velocity_path, motor.distance_path, start_tick, motor.lookahead_us));
+			replay_periods(state, loop, records, first, end, number, result);
+		}
+	}
+	else if (run.mode == EVENT_RUN_OL)
+	{
+		// As run_ol_path starts it
+		motor.activate_limit_latching();
+		motor.telemetry.mark_run_start();
+		motor.segment_cursor.reset();
+		motor.latency.reset();
+		motor.tracking.reset();
+		if (segments)
+		{
+			ol_segment_loop loop(motor, ol_law(motor), segment_trajectory(&motor.segment_cursor, &motor.segment_slot, start_tick, motor.lookahead_us));
+			replay_periods(state, loop, records, first, end, number, result);
+		}
+		else
+		{
+			ol_loop loop(motor, ol_law(motor), table_trajectory(motor.velocity_path, path_view(), start_tick, motor.lookahead_us));
+			replay_periods(state, loop, records, first, end, number, result);
+		}
+	}
+	else
+	{
+		// As run_pdff_cv_path follows the CV. start_tick is the timeout.
+		double margin = 50/motor.count_per_meter;
+		motor.cv_delay.reset();
+		cv_loop loop(motor, cv_law(motor), cv_target(state.udp, motor.axis, start_tick, -margin,
+		             motor.workspace_width_count/motor.count_per_meter + margin, &(motor.cv_delay)));
+		replay_periods(state, loop, records, first, end, number, result);
+	}
+
+	motor.stop();
+	motor.deactivate_limit_latching();
+	telemetry_record leftover;
+	while (motor.telemetry.queue.pop(leftover))
+		;
+
+	printf("Run %d (%s): %llu periods, %llu identical, %llu raced an alert\n", number, mode,
+	       (unsigned long long) result.periods, (unsigned long long) result.identical, (unsigned long long) result.races);
+	return(0);
+}
+
+//*****************************************
+// Recording cost
+//*****************************************
+
+static atomic<bool> bench_running(false);
+
+// Drains the log as the telemetry writer would
+static void* bench_writer(void* userdata)
+{
+	event_recorder* events = (event_recorder*) userdata;
+	while (bench_running.load())
+	{
+		events->drain();
+		usleep(TELEMETRY_DRAIN_US);
+	}
+	events->drain();
+	return(NULL);
+}
+
+// Time encoder callbacks in batches, at BENCH_RATE. Fills batch_ns with
+// the mean cost of a callback in each batch.
+static void time_callbacks(rot_encoder& encoder, uint32_t alerts, vector<double>& batch_ns)
+{
+	// A quadrature cycle going up: one count every four alerts
+	const int pins[4] = {encoder.b_pin, encoder.a_pin, encoder.b_pin, encoder.a_pin};
+	const int levels[4] = {1, 1, 0, 0};
+	double batch_period_ns = 1e9*BENCH_BATCH/BENCH_RATE;
+
+	batch_ns.clear();
+	uint32_t tick = 1000;
+	double next = wall_ns();
+	for (uint32_t done = 0; done < alerts; done += BENCH_BATCH)
+	{
+		while (wall_ns() < next)
+			; // Do Nothing
+		next += batch_period_ns;
+
+		double start = wall_ns();
+		for (int k = 0; k < BENCH_BATCH; k++)
+		{
+			rot_encoder::_static_pulse(pins[k & 3], levels[k & 3], tick, &encoder);
+			tick += 10;
+		}
+		batch_ns.push_back((wall_ns() - start)/BENCH_BATCH);
+	}
+	sort(batch_ns.begin(), batch_ns.end());
+}
+
+static double mean_of(const vector<double>& values)
+{
+	double sum = 0;
+	for (size_t i = 0; i < values.size(); i++)
+		sum += values[i];
+	return(values.empty() ? 0 : sum/values.size());
+}
+
+static int bench(uint32_t alerts)
+{
+	hal_initialise();
+	rot_encoder encoder(14, 15, 18, 5);
+	event_recorder events;
+	if (events.open("/dev/null"))
+		return(1);
+
+	bench_running.store(true);
+	pthread_t writer;
+	if (pthread_create(&writer, NULL, bench_writer, &events) != 0)
+	{
+		printf("Could not start the writer thread.\n");
+		return(1);
+	}
+
+	// Warm up, then without and with the recorder
+	vector<double> plain;
+	vector<double> recorded;
+	time_callbacks(encoder, alerts/10, plain);
+	time_callbacks(encoder, alerts, plain);
+	encoder.set_recorder(&events, LY);
+	time_callbacks(encoder, alerts, recorded);
+
+	bench_running.store(false);
+	pthread_join(writer, NULL);
+	encoder.set_recorder(NULL, LY);
+
+	size_t p99 = (plain.size()*99)/100;
+	printf("%u encoder alerts at %d per second, timed in batches of %d (ns per alert):\n", alerts, BENCH_RATE, BENCH_BATCH);
+	printf("  not recording: mean %.1f, 99th percentile %.1f, worst batch %.1f\n",
+	       mean_of(plain), plain[p99], plain.back());
+	printf("  recording:     mean %.1f, 99th percentile %.1f, worst batch %.1f\n",
+	       mean_of(recorded), recorded[p99], recorded.back());
+	printf("  added:         mean %.1f, 99th percentile %.1f\n",
+	       mean_of(recorded) - mean_of(plain), recorded[p99] - plain[p99]);
+	events.close();
+	hal_terminate();
+	return(0);
+}
+
+int main(int argc, char *argv[])
+{
+	string paths;
+	string traj;
+	double height = 0;
+	int only_run = 0;
+	vector<string> files;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool value = (i + 1 < argc);
+		if (strcmp(argv[i], "--bench") == 0)
+			return(bench(value ? (uint32_t) atoi(argv[i + 1]) : BENCH_DEFAULT_ALERTS));
+		else if ((strcmp(argv[i], "--paths") == 0) && value)
+			paths = argv[++i];
+		else if ((strcmp(argv[i], "--traj") == 0) && value)
+			traj = argv[++i];
+		else if ((strcmp(argv[i], "--height") == 0) && value)
+			height = atof(argv[++i]);
+		else if ((strcmp(argv[i], "--run") == 0) && value)
+			only_run = atoi(argv[++i]);
+		else if (argv[i][0] == '-')
+		{
+			print_usage(argv[0]);
+			return 1;
+		}
+		else
+			files.push_back(argv[i]);
+	}
+	if (files.size() != 2)
+	{
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	event_log_file log;
+	vector<telemetry_record> records;
+	int axis;
+	if (load_events(files[0], log) || load_telemetry(files[1], axis, records))
+		return 1;
+
+	// The encoder as it was attached, and the motor's pins from its first run
+	const vector<size_t>& marks = log.marks[axis];
+	int setup = -1;
+	int first_run = -1;
+	for (size_t m = 0; m < marks.size(); m++)
+	{
+		uint8_t type = log.data[marks[m]];
+		if ((type == EVENT_SETUP) && (setup < 0))
+			setup = (int) m;
+		if ((type == EVENT_RUN) && (first_run < 0))
+			first_run = (int) m;
+	}
+	string name = enum2string((motor_axis) axis);
+	if ((setup < 0) || (first_run < 0))
+	{
+		printf("%s has no %s for %s.\n", files[0].c_str(), (setup < 0) ? "encoder" : "runs", name.c_str());
+		return 1;
+	}
+	event_setup enc = record_at<event_setup>(log, marks[setup]);
+	event_run pins = record_at<event_run>(log, marks[first_run]);
+
+	// The clock and the 64 bit extension start where the log did.
+	hal_initialise();
+	sim_reset(log.header.start_tick);
+	sim_set_step(REPLAY_STEP_US);
+	mono_clock_reset(log.header.start_tick);
+
+	rot_encoder encoder(enc.a_pin, enc.b_pin, enc.z_pin, enc.velocity_points);
+	dc_motor motor((motor_axis) axis, pins.dir_pin, pins.pwm_pin, 10000, pins.u_limit_switch, pins.l_limit_switch, &encoder);
+	udp_connection udp;
+	motor.add_comm(&udp);
+
+	// The paths, as main.cpp would load them
+	level1_plan plan;
+	if (height > 0)
+	{
+		planner_params params;
+		params.ball_trajectory_height = height;
+		if (plan_level1(params, 2.0, plan))
+			return 1;
+		plan.y.rampup.insert(plan.y.rampup.begin(), constant_acceleration_period(0.1, 0, 0, 0));
+		motor.set_segment_path(&plan.y);
+	}
+	else if (!traj.empty())
+		motor.set_trajectory_file(traj);
+	else
+	{
+		string position_file = default_paths[axis][0];
+		string velocity_file = default_paths[axis][1];
+		size_t comma = paths.find(',');
+		if (comma != string::npos)
+		{
+			position_file = paths.substr(0, comma);
+			velocity_file = paths.substr(comma + 1);
+		}
+		motor.set_distance_file(position_file);
+		motor.set_velocity_file(velocity_file);
+	}
+
+	replay_state state;
+	state.log = &log;
+	state.axis = axis;
+	state.motor = &motor;
+	state.udp = &udp;
+	state.next_alert = 0;
+	state.sequence = 0;
+	state.next_listener = 0;
+	state.gap = false;
+
+	run_result total;
+	memset(&total, 0, sizeof(total));
+	int run_number = 0;
+	int failed = 0;
+	for (size_t m = 0; m < marks.size(); m++)
+	{
+		uint8_t type = log.data[marks[m]];
+		if (type == EVENT_RESET)
+		{
+			event_reset reset = record_at<event_reset>(log, marks[m]);
+			deliver_alerts(state, reset.sequence_before);
+			if ((reset.sequence_before != reset.sequence_after) || (reset.sequence_before & 1))
+				printf("A count reset raced an alert. The replay may not be exact after it.\n");
+			encoder.resetCount();
+		}
+		else if (type == EVENT_GAP)
+		{
+			printf("The log dropped %u marks for %s. Runs may be missing.\n", record_at<event_gap>(log, marks[m]).dropped, name.c_str());
+			state.gap = true;
+		}
+		else if (type == EVENT_RUN)
+		{
+			run_number++;
+			event_run run = record_at<event_run>(log, marks[m]);
+
+			// The run's records go up to the next run's first.
+			uint64_t end = records.size();
+			for (size_t k = m + 1; k < marks.size(); k++)
+			{
+				if (log.data[marks[k]] == EVENT_RUN)
+				{
+					end = record_at<event_run>(log, marks[k]).first_record;
+					break;
+				}
+			}
+			if ((only_run > 0) && (run_number != only_run))
+				continue;
+
+			run_result result;
+			memset(&result, 0, sizeof(result));
+			if (replay_run(state, run, records, end, run_number, result))
+				failed++;
+			total.periods += result.periods;
+			total.identical += result.identical;
+			total.races += result.races;
+			if (result.differed)
+				failed++;
+		}
+	}
+
+	printf("%s: %llu periods replayed, %llu identical, %llu raced an alert%s\n", name.c_str(),
+	       (unsigned long long) total.periods, (unsigned long long) total.identical, (unsigned long long) total.races,
+	       state.gap ? " (events were dropped)" : "");
+	hal_terminate();
+	return((failed || (total.identical != total.periods)) ? 1 : 0);
+}
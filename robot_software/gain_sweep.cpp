@@ -0,0 +1,416 @@
+/* gain_sweep.cpp
+
+   Created 10/16/2026
+
+   Runs the PD-feedforward control law against a simulated Y axis for a
+   grid or a random sample of gains and plant variations, spread over all
+   cores (work_pool.hpp), and reports for every configuration the position
+   tracking error and the velocity error at release.
+
+   Each configuration is a complete throw: the path from the position and
+   velocity files (the ones main.cpp uses by default), the motor_plant, a
+   decoder doing what rot_encoder does with its edges, the same
+   lsq_velocity fit, and pdff_law from control_loop.hpp, all on a clock of
+   its own. Release is where the path velocity peaks; the error there is
+   the plant's true velocity minus the path's, which is what the ball
+   leaves with.
+
+   Parameters are given as name=value, name=min:max or name=min:max:step:
+       kff kp kd      gains (velocity_ff_constant, Kp, Kd)
+       friction mass  scale on the plant's Coulomb friction and moving mass
+       jitter         control loop start jitter, uniform 0..jitter us
+   A grid runs every combination of the stepped values; --random N draws N
+   configurations uniformly from the ranges instead.
+
+   Usage: ./gain_sweep [--random N] [--threads N] [--seed S] [--step US]
+                       [--paths position velocity] [name=range ...]
+   e.g.   ./gain_sweep kff=40:90:5 kp=0:3000:250 kd=0:400:50
+
+   One CSV line per configuration goes to stdout; a summary with the best
+   configurations goes to stderr.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include "control_loop.hpp"
+#include "lsq_velocity.hpp"
+#include "motor_plant.hpp"
+#include "work_pool.hpp"
+
+#ifndef ROBOT_SIM
+#error "gain_sweep links the motor code against the simulated GPIO. Build it with make gain_sweep."
+#endif
+
+// LY geometry and loop, as in main.cpp
+#define SWEEP_LIMIT_WIDTH 0.543
+#define SWEEP_WORKSPACE_WIDTH 0.45
+#define SWEEP_CONTROL_PERIOD_US 500
+#define SWEEP_VELOCITY_POINTS 5
+#define SWEEP_PLANT_STEP_US 10
+#define SWEEP_START_TICK 1000000ULL
+
+// How many of the best configurations to list
+#define SWEEP_TOP 5
+
+using namespace std;
+
+enum sweep_parameter {P_KFF, P_KP, P_KD, P_FRICTION, P_MASS, P_JITTER, SWEEP_PARAMETERS};
+
+static const char* parameter_names[SWEEP_PARAMETERS] = {"kff", "kp", "kd", "friction", "mass", "jitter"};
+
+struct parameter_range {
+	double min;
+	double max;
+	double step;   // 0: a single value, or drawn from [min, max]
+};
+
+struct sweep_config {
+	double value[SWEEP_PARAMETERS];
+};
+
+struct sweep_result {
+	double rms;
+	double max_abs;
+	double release_error;
+	bool released;
+	bool aborted;
+};
+
+// The decoding rot_encoder::_pulse does on the pins: one count per cycle,
+// up on A rising with B high, down on B rising with A high, and a pin
+// changing twice in a row is ignored.
+struct sweep_encoder {
+	int count;
+	int level[2];
+	int last_channel;
+	lsq_velocity fit;
+	double cps;
+};
+
+static void sweep_edge(int channel, int level, uint64_t tick, void *userdata)
+{
+	sweep_encoder* encoder = (sweep_encoder*) userdata;
+	encoder->level[channel] = level;
+	if (channel == encoder->last_channel)
+		return;
+	encoder->last_channel = channel;
+	if (level != 1 || !encoder->level[1 - channel])
+		return;
+
+	encoder->count += (channel == 0) ? 1 : -1;
+	encoder->fit.add_point(tick, encoder->count);
+	encoder->cps = encoder->fit.slope() * 1000000;
+}
+
+class sweep_job
+{
+public:
+
+	sweep_job(const vector<sweep_config>& configs, vector<sweep_result>& results,
+	          const path_view& velocity, const path_view& position, uint64_t seed, uint32_t step_us)
+		: configs(configs), results(results), velocity(velocity), position(position)
+	{
+		this->seed = seed;
+		this->step_us = step_us;
+
+		// Release is where the path velocity peaks.
+		release_millis = 0;
+		for (uint32_t i = 1; i < velocity.size(); i++)
+		{
+			if (velocity[i] > velocity[release_millis])
+				release_millis = i;
+		}
+	}
+
+	void operator()(uint32_t index, int worker)
+	{
+		const sweep_config& config = configs[index];
+		sweep_result& result = results[index];
+
+		plant_params params = y_plant_params(SWEEP_LIMIT_WIDTH);
+		params.coulomb_friction *= config.value[P_FRICTION];
+		params.mass *= config.value[P_MASS];
+		motor_plant plant(params);
+		double zero = (SWEEP_LIMIT_WIDTH - SWEEP_WORKSPACE_WIDTH)/2;
+		plant.set_position(zero);
+		double count_per_meter = plant.count_per_meter();
+		int workspace_width_count = SWEEP_WORKSPACE_WIDTH * count_per_meter;
+
+		sweep_encoder encoder;
+		encoder.count = 0;
+		encoder.level[0] = plant.get_a_level();
+		encoder.level[1] = plant.get_b_level();
+		encoder.last_channel = -1;
+		encoder.fit = lsq_velocity(SWEEP_VELOCITY_POINTS);
+		encoder.cps = 0;
+		plant.set_encoder_output(sweep_edge, &encoder);
+
+		// The law only reads the gains from the motor.
+		dc_motor motor;
+		motor.set_constants(0, config.value[P_KFF], config.value[P_KP], config.value[P_KD]);
+		pdff_law law(motor);
+		table_trajectory source(velocity, position, SWEEP_START_TICK);
+
+		// Every configuration draws the same jitter whatever thread runs it.
+		mt19937_64 random(seed ^ (0x9E3779B97F4A7C15ULL * (index + 1)));
+		uniform_real_distribution<double> jitter(0, config.value[P_JITTER]);
+
+		tracking_error tracking;
+		uint64_t release_tick = SWEEP_START_TICK + release_millis*1000ULL;
+		result.released = false;
+		result.aborted = false;
+		result.release_error = 0;
+
+		uint64_t now = SWEEP_START_TICK;
+		int duty_cycle = 0;
+		int dir_level = 0;
+		for (uint32_t period = 0; ; period++)
+		{
+			uint64_t loop_tick = SWEEP_START_TICK + period*(uint64_t) SWEEP_CONTROL_PERIOD_US + (uint64_t) jitter(random);
+
+			// The plant runs on the last output until the loop wakes up.
+			while (now < loop_tick)
+			{
+				uint32_t dt = (loop_tick - now < step_us) ? (uint32_t) (loop_tick - now) : step_us;
+				now += dt;
+				plant.step(now, dt, duty_cycle, dir_level);
+				if (!result.released && (now >= release_tick))
+				{
+					result.release_error = plant.get_velocity() - velocity[release_millis];
+					result.released = true;
+				}
+			}
+
+			setpoint sp;
+			if (!(source.sample(loop_tick, sp)))
+				break;
+
+			axis_state state;
+			state.position = encoder.count/count_per_meter;
+			state.velocity = encoder.cps/count_per_meter;
+			double effort = law.effort(sp, state);
+			tracking.add(sp.position - state.position);
+
+			// dc_motor::drive
+			dir_level = (effort < 0) ? 1 : 0;
+			duty_cycle = abs((int) round(effort));
+			duty_cycle = (duty_cycle > 255) ? 255 : duty_cycle;
+
+			if ((encoder.count > (pdff_law::workspace_margin + workspace_width_count)) || (encoder.count < -50))
+			{
+				result.aborted = true;
+				break;
+			}
+		}
+
+		result.rms = tracking.rms();
+		result.max_abs = tracking.max_abs;
+	}
+
+private:
+	const vector<sweep_config>& configs;
+	vector<sweep_result>& results;
+	path_view velocity;
+	path_view position;
+	uint64_t seed;
+	uint32_t step_us;
+	uint32_t release_millis;
+};
+
+// Parse name=value, name=min:max or name=min:max:step. Returns 0 on success.
+static int parse_range(const char* arg, parameter_range* ranges)
+{
+	const char* equals = strchr(arg, '=');
+	if (!equals)
+		return(1);
+	string name(arg, equals - arg);
+	int p;
+	for (p = 0; p < SWEEP_PARAMETERS; p++)
+	{
+		if (name == parameter_names[p])
+			break;
+	}
+	if (p == SWEEP_PARAMETERS)
+		return(1);
+
+	parameter_range range;
+	int fields = sscanf(equals + 1, "%lf:%lf:%lf", &range.min, &range.max, &range.step);
+	if (fields < 1)
+		return(1);
+	if (fields == 1)
+		range.max = range.min;
+	if (fields < 3)
+		range.step = 0;
+	if ((range.max < range.min) || (range.step < 0))
+		return(1);
+	ranges[p] = range;
+	return(0);
+}
+
+// Every combination of the stepped values
+static void make_grid(const parameter_range* ranges, int p, sweep_config& config, vector<sweep_config>& configs)
+{
+	if (p == SWEEP_PARAMETERS)
+	{
+		configs.push_back(config);
+		return;
+	}
+	const parameter_range& range = ranges[p];
+	if (range.step <= 0)
+	{
+		config.value[p] = range.min;
+		make_grid(ranges, p + 1, config, configs);
+		return;
+	}
+	for (int i = 0; range.min + i*range.step <= range.max + 1e-9; i++)
+	{
+		config.value[p] = range.min + i*range.step;
+		make_grid(ranges, p + 1, config, configs);
+	}
+}
+
+static double wall_ms()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return(ts.tv_sec*1000.0 + ts.tv_nsec/1000000.0);
+}
+
+struct rank_by_rms {
+	const vector<sweep_result>* results;
+	bool operator()(uint32_t a, uint32_t b) const { return((*results)[a].rms < (*results)[b].rms); }
+};
+
+struct rank_by_release {
+	const vector<sweep_result>* results;
+	bool operator()(uint32_t a, uint32_t b) const
+	{
+		return(fabs((*results)[a].release_error) < fabs((*results)[b].release_error));
+	}
+};
+
+static void print_config(const sweep_config& config, const sweep_result& result)
+{
+	fprintf(stderr, "  kff %7.2f kp %8.2f kd %7.2f friction %.2f mass %.2f jitter %4.0f: rms %6.2f mm, max %6.2f mm, release %+.3f m/s\n",
+	        config.value[P_KFF], config.value[P_KP], config.value[P_KD], config.value[P_FRICTION],
+	        config.value[P_MASS], config.value[P_JITTER], result.rms*1000, result.max_abs*1000, result.release_error);
+}
+
+int main(int argc, char *argv[])
+{
+	// Defaults: LY in main.cpp on the nominal plant
+	parameter_range ranges[SWEEP_PARAMETERS] = {
+		{60, 60, 0}, {0, 0, 0}, {200, 200, 0}, {1, 1, 0}, {1, 1, 0}, {0, 0, 0}};
+	int random_count = 0;
+	int threads = 0;
+	uint64_t seed = 1;
+	uint32_t step_us = SWEEP_PLANT_STEP_US;
+	string position_file = "y_throw_position_higher_throw_50cm.txt";
+	string velocity_file = "y_throw_velocity_higher_throw_50cm.txt";
+
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		if ((arg == "--random") && (i + 1 < argc))
+			random_count = atoi(argv[++i]);
+		else if ((arg == "--threads") && (i + 1 < argc))
+			threads = atoi(argv[++i]);
+		else if ((arg == "--seed") && (i + 1 < argc))
+			seed = strtoull(argv[++i], NULL, 10);
+		else if ((arg == "--step") && (i + 1 < argc))
+			step_us = atoi(argv[++i]);
+		else if ((arg == "--paths") && (i + 2 < argc))
+		{
+			position_file = argv[++i];
+			velocity_file = argv[++i];
+		}
+		else if (parse_range(argv[i], ranges) != 0)
+		{
+			printf("Usage: %s [--random N] [--threads N] [--seed S] [--step US] [--paths position velocity] [name=min:max[:step] ...]\n", argv[0]);
+			printf("Parameters: kff kp kd friction mass jitter\n");
+			return 1;
+		}
+	}
+	if (step_us == 0)
+		step_us = SWEEP_PLANT_STEP_US;
+
+	// Load the paths the same way the motors do. They are shared read only
+	// by every run.
+	dc_motor paths;
+	paths.set_distance_file(position_file);
+	paths.set_velocity_file(velocity_file);
+	if (paths.velocity_path.empty() || paths.distance_path.empty())
+	{
+		printf("Could not load the paths.\n");
+		return 1;
+	}
+
+	vector<sweep_config> configs;
+	if (random_count > 0)
+	{
+		mt19937_64 random(seed);
+		for (int i = 0; i < random_count; i++)
+		{
+			sweep_config config;
+			for (int p = 0; p < SWEEP_PARAMETERS; p++)
+				config.value[p] = uniform_real_distribution<double>(ranges[p].min, ranges[p].max)(random);
+			configs.push_back(config);
+		}
+	}
+	else
+	{
+		sweep_config config;
+		make_grid(ranges, 0, config, configs);
+	}
+
+	vector<sweep_result> results(configs.size());
+	sweep_job job(configs, results, paths.velocity_path, paths.distance_path, seed, step_us);
+	work_pool pool(threads);
+
+	double start = wall_ms();
+	pool.run(configs.size(), job);
+	double elapsed = wall_ms() - start;
+
+	printf("kff,kp,kd,friction,mass,jitter_us,rms_mm,max_mm,release_error_mps,aborted\n");
+	for (unsigned i = 0; i < configs.size(); i++)
+	{
+		const double* v = configs[i].value;
+		printf("%.3f,%.3f,%.3f,%.3f,%.3f,%.1f,%.3f,%.3f,%.4f,%d\n", v[P_KFF], v[P_KP], v[P_KD], v[P_FRICTION], v[P_MASS],
+		       v[P_JITTER], results[i].rms*1000, results[i].max_abs*1000, results[i].release_error, results[i].aborted ? 1 : 0);
+	}
+
+	// Summary, over the runs that finished the path
+	vector<uint32_t> finished;
+	for (uint32_t i = 0; i < configs.size(); i++)
+	{
+		if (!results[i].aborted && results[i].released)
+			finished.push_back(i);
+	}
+	fprintf(stderr, "%u configurations in %.0f ms on %d threads (%.2f ms each, %u steals), %u left the workspace\n",
+	        (unsigned) configs.size(), elapsed, pool.size(), configs.empty() ? 0 : elapsed*pool.size()/configs.size(),
+	        pool.total_steals(), (unsigned) (configs.size() - finished.size()));
+
+	unsigned top = (finished.size() < SWEEP_TOP) ? finished.size() : SWEEP_TOP;
+	if (top == 0)
+		return 0;
+
+	rank_by_rms by_rms = {&results};
+	partial_sort(finished.begin(), finished.begin() + top, finished.end(), by_rms);
+	fprintf(stderr, "Lowest tracking error:\n");
+	for (unsigned i = 0; i < top; i++)
+		print_config(configs[finished[i]], results[finished[i]]);
+
+	rank_by_release by_release = {&results};
+	partial_sort(finished.begin(), finished.begin() + top, finished.end(), by_release);
+	fprintf(stderr, "Lowest release velocity error:\n");
+	for (unsigned i = 0; i < top; i++)
+		print_config(configs[finished[i]], results[finished[i]]);
+	return 0;
+}
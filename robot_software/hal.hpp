@@ -0,0 +1,143 @@
+/* hal.hpp
+
+   Created 10/16/2026
+
+   This is the hardware abstraction layer. Every GPIO, PWM, alert, timer,
+   thread and clock call the robot code makes goes through the hal_
+   functions here rather than straight to pigpio.
+
+   The backend is chosen at compile time. The normal build forwards each
+   call to pigpio through an inline function, so it compiles to exactly
+   the pigpio call and costs nothing. Building with -DROBOT_SIM (make sim)
+   forwards them to the simulated backend in sim_gpio.hpp instead: an
+   in-process virtual clock, PWM outputs, limit switch and encoder inputs
+   and their alerts, so the control code builds and runs off the Pi.
+
+   Ticks are 32 bit microseconds like gpioTick(); use mono_tick() for the
+   64 bit time. hal_time_ns() and hal_sleep_until_ns() are the clock the
+   control loops pace themselves on (CLOCK_MONOTONIC on the Pi).
+*/
+
+#ifndef __HAL_HPP__
+#define __HAL_HPP__
+
+#include <stdint.h>
+#include <pthread.h>
+
+#ifdef ROBOT_SIM
+#include "sim_gpio.hpp"
+#else
+#include <time.h>
+#include <errno.h>
+#include <pigpio.h>
+#endif
+
+// Pin modes and pulls, the same values as pigpio
+#define HAL_INPUT 0
+#define HAL_OUTPUT 1
+#define HAL_PUD_OFF 0
+#define HAL_PUD_DOWN 1
+#define HAL_PUD_UP 2
+
+// Called on every level change of a watched pin
+typedef void (*hal_alert_func)(int gpio, int level, uint32_t tick, void *userdata);
+
+// Called every period of a timer
+typedef void (*hal_timer_func)(void *userdata);
+
+// Body of a thread started with hal_start_thread()
+typedef void *(hal_thread_func)(void *userdata);
+
+#ifndef ROBOT_SIM
+
+// Pin sampling period in microseconds. Call before hal_initialise().
+static inline int hal_cfg_clock(unsigned sample_us) { return(gpioCfgClock(sample_us, 1, 1)); }
+
+// Returns < 0 on failure
+static inline int hal_initialise() { return(gpioInitialise()); }
+static inline void hal_terminate() { gpioTerminate(); }
+
+static inline int hal_set_mode(unsigned pin, unsigned mode) { return(gpioSetMode(pin, mode)); }
+static inline int hal_set_pull(unsigned pin, unsigned pud) { return(gpioSetPullUpDown(pin, pud)); }
+static inline int hal_read(unsigned pin) { return(gpioRead(pin)); }
+static inline int hal_write(unsigned pin, unsigned level) { return(gpioWrite(pin, level)); }
+
+// Set or clear every GPIO 0-31 whose bit is set, all at once
+static inline int hal_write_bits_set(uint32_t bits) { return(gpioWrite_Bits_0_31_Set(bits)); }
+static inline int hal_write_bits_clear(uint32_t bits) { return(gpioWrite_Bits_0_31_Clear(bits)); }
+
+// Duty cycle 0-255
+static inline int hal_pwm(unsigned pin, unsigned duty_cycle) { return(gpioPWM(pin, duty_cycle)); }
+static inline int hal_set_pwm_frequency(unsigned pin, unsigned hz) { return(gpioSetPWMfrequency(pin, hz)); }
+
+// Watch a pin for level changes. A NULL func stops watching.
+static inline int hal_set_alert(unsigned pin, hal_alert_func func, void *userdata)
+{
+	return(gpioSetAlertFuncEx(pin, func, userdata));
+}
+
+// Call func every ms milliseconds on timer slot timer (0-9). A NULL func
+// cancels it.
+static inline int hal_set_timer(unsigned timer, unsigned ms, hal_timer_func func, void *userdata)
+{
+	return(gpioSetTimerFuncEx(timer, ms, func, userdata));
+}
+
+static inline uint32_t hal_tick() { return(gpioTick()); }
+
+static inline void hal_sleep(int seconds, int micros) { gpioSleep(PI_TIME_RELATIVE, seconds, micros); }
+
+static inline pthread_t *hal_start_thread(hal_thread_func func, void *userdata) { return(gpioStartThread(func, userdata)); }
+static inline void hal_stop_thread(pthread_t *thread) { gpioStopThread(thread); }
+
+static inline int64_t hal_time_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return(((int64_t) ts.tv_sec) * 1000000000LL + ts.tv_nsec);
+}
+
+// Sleep until an absolute hal_time_ns()
+static inline void hal_sleep_until_ns(int64_t deadline)
+{
+	struct timespec ts;
+	ts.tv_sec = deadline / 1000000000LL;
+	ts.tv_nsec = deadline % 1000000000LL;
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+		;
+}
+
+#else
+
+static inline int hal_cfg_clock(unsigned sample_us) { return(0); }
+static inline int hal_initialise() { return(sim_initialise()); }
+static inline void hal_terminate() { sim_terminate(); }
+static inline int hal_set_mode(unsigned pin, unsigned mode) { return(sim_set_mode(pin, mode)); }
+static inline int hal_set_pull(unsigned pin, unsigned pud) { return(sim_set_pull(pin, pud)); }
+static inline int hal_read(unsigned pin) { return(sim_read(pin)); }
+static inline int hal_write(unsigned pin, unsigned level) { return(sim_write(pin, level)); }
+static inline int hal_write_bits_set(uint32_t bits) { return(sim_write_bits(bits, 1)); }
+static inline int hal_write_bits_clear(uint32_t bits) { return(sim_write_bits(bits, 0)); }
+static inline int hal_pwm(unsigned pin, unsigned duty_cycle) { return(sim_pwm(pin, duty_cycle)); }
+static inline int hal_set_pwm_frequency(unsigned pin, unsigned hz) { return(sim_set_pwm_frequency(pin, hz)); }
+
+static inline int hal_set_alert(unsigned pin, hal_alert_func func, void *userdata)
+{
+	return(sim_set_alert(pin, func, userdata));
+}
+
+static inline int hal_set_timer(unsigned timer, unsigned ms, hal_timer_func func, void *userdata)
+{
+	return(sim_set_timer(timer, ms, func, userdata));
+}
+
+static inline uint32_t hal_tick() { return((uint32_t) sim_now()); }
+static inline void hal_sleep(int seconds, int micros) { sim_sleep_until(sim_now() + seconds*1000000ULL + micros); }
+static inline pthread_t *hal_start_thread(hal_thread_func func, void *userdata) { return(sim_start_thread(func, userdata)); }
+static inline void hal_stop_thread(pthread_t *thread) { sim_stop_thread(thread); }
+static inline int64_t hal_time_ns() { return((int64_t) sim_now() * 1000); }
+static inline void hal_sleep_until_ns(int64_t deadline) { sim_sleep_until((deadline + 999) / 1000); }
+
+#endif
+
+#endif
@@ -0,0 +1,118 @@
+/* latency_estimator.cpp
+
+   Created 10/16/2026
+
+   This is the cpp file holding the function definitions for the
+   latency_estimator class. See latency_estimator.hpp.
+*/
+
+#include <stdio.h>
+#include <math.h>
+#include "latency_estimator.hpp"
+
+using namespace std;
+
+// Default Constructor
+latency_estimator::latency_estimator()
+{
+	this->reset();
+}
+
+void latency_estimator::reset()
+{
+	for (int i = 0; i <= LATENCY_MAX_LAG_MS; i++)
+	{
+		history[i] = 0;
+		sse[i] = 0;
+	}
+	head = 0;
+	filled = 0;
+	samples = 0;
+	commanded_sum = 0;
+	commanded_square_sum = 0;
+	measured_sum = 0;
+	measured_square_sum = 0;
+	last_ms = 0;
+}
+
+void latency_estimator::add(uint64_t tick, double commanded, double measured)
+{
+	uint64_t now_ms = tick/1000;
+	if ((filled > 0) && (now_ms == last_ms))
+		return;
+	last_ms = now_ms;
+
+	head = (head + 1) % (LATENCY_MAX_LAG_MS + 1);
+	history[head] = commanded;
+	if (filled <= LATENCY_MAX_LAG_MS)
+	{
+		filled++;
+		return;
+	}
+
+	// Compare the measurement against the command from each lag ago.
+	int slot = head;
+	for (int lag = 0; lag <= LATENCY_MAX_LAG_MS; lag++)
+	{
+		double error = measured - history[slot];
+		sse[lag] += error*error;
+		slot = (slot == 0) ? LATENCY_MAX_LAG_MS : (slot - 1);
+	}
+	samples++;
+	commanded_sum += commanded;
+	commanded_square_sum += commanded*commanded;
+	measured_sum += measured;
+	measured_square_sum += measured*measured;
+}
+
+// Standard deviation from a sum and a sum of squares over samples
+static double standard_deviation(double sum, double square_sum, int samples)
+{
+	double mean = sum/samples;
+	double variance = square_sum/samples - mean*mean;
+	return((variance > 0) ? sqrt(variance) : 0);
+}
+
+int latency_estimator::latency_us() const
+{
+	if (samples < LATENCY_MIN_SAMPLES)
+		return(-1);
+
+	// Too little motion to tell the lags apart
+	if ((standard_deviation(commanded_sum, commanded_square_sum, samples) < LATENCY_MIN_VELOCITY_SD) ||
+	    (standard_deviation(measured_sum, measured_square_sum, samples) < LATENCY_MIN_VELOCITY_SD))
+		return(-1);
+
+	int best = 0;
+	for (int lag = 1; lag <= LATENCY_MAX_LAG_MS; lag++)
+	{
+		if (sse[lag] < sse[best])
+			best = lag;
+	}
+
+	// The minimum is at the end of the range, not inside it.
+	if (best == LATENCY_MAX_LAG_MS)
+		return(-1);
+
+	// Fit a parabola through the best lag and its neighbours for the
+	// fraction of a millisecond.
+	double offset = 0;
+	if ((best > 0) && (best < LATENCY_MAX_LAG_MS))
+	{
+		double denom = sse[best - 1] - 2*sse[best] + sse[best + 1];
+		if (denom > 0)
+			offset = 0.5*(sse[best - 1] - sse[best + 1])/denom;
+	}
+	return((int) ((best + offset)*1000));
+}
+
+void latency_estimator::print(string name, int lookahead_us) const
+{
+	int latency = this->latency_us();
+	if (latency < 0)
+	{
+		printf("%s latency: not measured (too little motion, or over %d ms)\n", name.c_str(), LATENCY_MAX_LAG_MS);
+		return;
+	}
+	printf("%s latency: %d us measured, %d us lookahead\n", name.c_str(), latency, lookahead_us);
+}
@@ -0,0 +1,85 @@
+/* latency_estimator.hpp
+
+   Created 10/16/2026
+
+   This is the header file for the latency_estimator class.
+
+   A latency_estimator measures how far the motor's measured velocity lags
+   the velocity it was commanded. Once per millisecond the commanded
+   velocity goes into a short history, and the measured velocity is
+   compared against the command from 0, 1, 2 ... LATENCY_MAX_LAG_MS
+   milliseconds ago. The lag with the smallest sum of squared differences
+   is the latency, refined below a millisecond by fitting a parabola
+   through its neighbours. There is no estimate when the best lag is the
+   longest one (the latency may be longer still), or when the command or
+   the measured velocity barely changed, since then every lag fits about
+   as well.
+
+   The measured latency is everything between the control law and the
+   velocity estimate: PWM update, driver and motor response, and the lag of
+   the encoder's least squares window. It is the value to use as the
+   motor's lookahead (dc_motor::set_lookahead).
+
+   Each update is O(LATENCY_MAX_LAG_MS) and only happens once per
+   millisecond. Not thread safe; it is updated from the control loop.
+*/
+
+#ifndef __LATENCY_ESTIMATOR_HPP__
+#define __LATENCY_ESTIMATOR_HPP__
+
+#include <stdint.h>
+#include <string>
+
+// Longest latency that can be measured (ms)
+#define LATENCY_MAX_LAG_MS 64
+
+// Minimum number of compared milliseconds before there is an estimate
+#define LATENCY_MIN_SAMPLES 100
+
+// Minimum standard deviation of the commanded and the measured velocity
+// over the compared milliseconds (m/s)
+#define LATENCY_MIN_VELOCITY_SD 0.01
+
+class latency_estimator
+{
+public:
+
+	// Default Constructor
+	latency_estimator();
+
+	// Forget everything, at the start of a run
+	void reset();
+
+	// Commanded and measured velocity at tick. Call every control period;
+	// only the first call in each millisecond is used.
+	void add(uint64_t tick, double commanded, double measured);
+
+	// Estimated latency in microseconds, or -1 if there is not enough
+	// data or motion, or the latency is past LATENCY_MAX_LAG_MS
+	int latency_us() const;
+
+	// Print the estimate next to the lookahead that was in use
+	void print(std::string name, int lookahead_us) const;
+
+private:
+
+	// Commanded velocity for each of the last milliseconds, newest at head
+	double history[LATENCY_MAX_LAG_MS + 1];
+	int head;
+	int filled;
+
+	// Sum of squared differences for each lag
+	double sse[LATENCY_MAX_LAG_MS + 1];
+	int samples;
+
+	// Sums of the compared commanded and measured velocities, and of their
+	// squares
+	double commanded_sum;
+	double commanded_square_sum;
+	double measured_sum;
+	double measured_square_sum;
+
+	uint64_t last_ms;
+};
+
+#endif
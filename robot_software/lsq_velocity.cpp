@@ -0,0 +1,125 @@
+/* lsq_velocity.cpp
+
+   Created 10/16/2026
+
+   This is the cpp file holding the function definitions for the lsq_velocity
+   class.
+
+   With x measured relative to an origin, moving the origin by d changes the
+   sums as follows (and the same for y with dy):
+       xsum'  = xsum - n*d
+       xxsum' = xxsum - 2*d*xsum + n*d*d
+       xysum' = xysum - d*ysum - dy*xsum + n*d*dy
+   The newest point always sits at (0, 0), so it adds nothing to the sums.
+*/
+
+#include "lsq_velocity.hpp"
+
+// Default Constructor
+lsq_velocity::lsq_velocity()
+{
+	window = 0;
+	this->reset();
+}
+
+// Constructor
+lsq_velocity::lsq_velocity(int window_points)
+{
+	if (window_points > MAX_VELOCITY_POINTS)
+		window_points = MAX_VELOCITY_POINTS;
+	if (window_points < 2)
+		window_points = 2;
+	window = window_points;
+	this->reset();
+}
+
+void lsq_velocity::reset()
+{
+	oldest = 0;
+	n = 0;
+	since_recompute = 0;
+	xsum = 0;
+	ysum = 0;
+	xxsum = 0;
+	xysum = 0;
+}
+
+int lsq_velocity::width() const
+{
+	return(window);
+}
+
+void lsq_velocity::add_point(uint64_t tick, int count)
+{
+	if (window == 0)
+		return;
+
+	if (n > 0)
+	{
+		// Move the origin from the old newest point to the new one.
+		int newest = (oldest + n - 1) % window;
+		double d = (double) (tick - ticks[newest]);
+		double dy = (double) (count - counts[newest]);
+
+		xxsum += (n * d * d) - (2 * d * xsum);
+		xysum += (n * d * dy) - (d * ysum) - (dy * xsum);
+		xsum -= n * d;
+		ysum -= n * dy;
+	}
+
+	if (n == window)
+	{
+		// Drop the oldest point, now expressed relative to the new origin.
+		double x = -((double) (tick - ticks[oldest]));
+		double y = (double) (counts[oldest] - count);
+		xsum -= x;
+		ysum -= y;
+		xxsum -= x * x;
+		xysum -= x * y;
+		oldest = (oldest + 1) % window;
+		n--;
+	}
+
+	// The new point is the origin, so it adds zero to each sum.
+	int slot = (oldest + n) % window;
+	ticks[slot] = tick;
+	counts[slot] = count;
+	n++;
+
+	// Every full window, throw away accumulated rounding.
+	if (++since_recompute >= window)
+		this->recompute();
+}
+
+void lsq_velocity::recompute()
+{
+	since_recompute = 0;
+	xsum = 0;
+	ysum = 0;
+	xxsum = 0;
+	xysum = 0;
+
+	int newest = (oldest + n - 1) % window;
+	for (int i = 0; i < n; i++)
+	{
+		int slot = (oldest + i) % window;
+		double x = -((double) (ticks[newest] - ticks[slot]));
+		double y = (double) (counts[slot] - counts[newest]);
+		xsum += x;
+		ysum += y;
+		xxsum += x * x;
+		xysum += x * y;
+	}
+}
+
+double lsq_velocity::slope() const
+{
+	if (n < 2)
+		return(0);
+
+	double denom = ((n * xxsum) - (xsum * xsum));
+	if (denom == 0)
+		return(0);
+
+	return(((n * xysum) - (xsum * ysum)) / denom);
+}
@@ -0,0 +1,76 @@
+/* lsq_velocity.hpp
+
+   Created 10/16/2026
+
+   This is the header file for the lsq_velocity class.
+
+   lsq_velocity is a sliding-window least squares slope estimator that is
+   updated one point at a time. Instead of recomputing xsum/ysum/xxsum/xysum
+   over the whole window on every read, it keeps running sums and adjusts
+   them as points enter and leave the window, so both add_point() and slope()
+   are O(1).
+
+   The sums are kept relative to a moving origin (the newest point), so the
+   numbers involved stay as small as the window itself instead of the raw
+   tick values squared. To keep rounding from building up, the sums
+   are recomputed exactly from the window once every full window of points,
+   which is still O(1) amortized.
+
+   This class is not thread safe on its own. rot_encoder updates it from the
+   alert callback and publishes the result.
+*/
+
+#ifndef __LSQ_VELOCITY_HPP__
+#define __LSQ_VELOCITY_HPP__
+
+#include <stdint.h>
+
+// Maximum number of points the velocity can be calculated over.
+#define MAX_VELOCITY_POINTS 128
+
+class lsq_velocity
+{
+public:
+
+	// Default Constructor
+	lsq_velocity();
+
+	// Constructor
+	lsq_velocity(int window_points);
+
+	// Add a point to the window, dropping the oldest one if it is full.
+	void add_point(uint64_t tick, int count);
+
+	// Slope of the least squares line, in counts per tick (microsecond).
+	// Ticks are 64 bit extended ticks from mono_clock.
+	double slope() const;
+
+	// Empty the window
+	void reset();
+
+	// Number of points the window is configured for
+	int width() const;
+
+private:
+
+	// Rebuild the sums from scratch relative to the newest point
+	void recompute();
+
+	// Window of raw points. Ring indexed from oldest.
+	uint64_t ticks[MAX_VELOCITY_POINTS];
+	int counts[MAX_VELOCITY_POINTS];
+	int window;
+	int oldest;
+	int n;
+
+	// Points added since the last exact recompute
+	int since_recompute;
+
+	// Running sums, relative to the newest point
+	double xsum;
+	double ysum;
+	double xxsum;
+	double xysum;
+};
+
+#endif
@@ -8,15 +8,25 @@
 */
 
 #include <stdint.h>
+#include <string.h>
 #include <limits> 
 #include <iostream>
 #include <vector>
 #include <sstream>
-#include <pigpio.h>
+#include <sys/select.h>
+#include "hal.hpp"
 #include "dc_motor.hpp"
 #include "motor_sync.hpp"
+#include "axis_group.hpp"
 #include "udp_connection.hpp"
 #include "main.hpp"
+#include "mono_clock.hpp"
+#include "path_planner.hpp"
+#include "telemetry_stream.hpp"
+#ifdef ROBOT_SIM
+#include "motor_plant.hpp"
+#include "sim_plant.hpp"
+#endif
 
 // Sample at a rate of 4 microseconds, PWM of 10 kHz
 #define PIN_SAMPLE_TIME 4 
@@ -31,8 +41,40 @@ int main(int argc, char *argv[])
   //---------GENERAL SETUP----------
   //--------------------------------
   int encoder_velocity_points = 5;
+  int control_loop_rate = 2000; // Hz, control law runs once per period
   string udp_port_number = "5005";
 
+  // Send a decimated copy of the telemetry to a laptop running
+  // telemetry_live, to watch runs live.
+  bool stream_telemetry = false;
+  string telemetry_stream_host = "192.168.1.100";
+  string telemetry_stream_port = "5006";
+
+  // Plan the Y throw paths at startup instead of loading the exported
+  // tables. The planner defaults match path_planning_level1_v10.m.
+  bool plan_y_paths = false;
+  double ball_trajectory_height = 0.5; // m
+
+  // Log every encoder edge, limit switch alert, CV datagram and run to
+  // events.bin, so a run can be replayed off the robot (event_replay).
+  // Every edge is 8 bytes and the file is not capped, so it is off unless
+  // set here or asked for with ./main --record-events.
+  bool record_events = false;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--record-events") == 0)
+      record_events = true;
+    else
+    {
+      cout << "Unknown option " << argv[i] << ". Usage: " << argv[0] << " [--record-events]" << endl;
+      return 1;
+    }
+  }
+
+  // Load the motor parameters fitted by sysid from motor_XX.txt over the
+  // constants set below (feedforward, friction, homing PWM, lookahead).
+  bool load_motor_parameters = false;
+
   //--------------------------------
   //------LEFT Y MOTOR SETUP--------
   //--------------------------------
@@ -41,6 +83,7 @@ int main(int argc, char *argv[])
   double LY_velocity_feedforward_constant = 60;
   double LY_Kp = 0;
   double LY_Kd = 200;//for perfect catch from before
+  int LY_lookahead_us = 0; // Actuation latency, printed after each run
 
   // Set velocity file and distance files
   string LY_VelocityFile = "y_throw_velocity_higher_throw_50cm.txt"; // "y_circle.txt";
@@ -69,6 +112,7 @@ int main(int argc, char *argv[])
   double LX_velocity_feedforward_constant = 200; //103;
   double LX_Kp = 0;
   double LX_Kd = 200;
+  int LX_lookahead_us = 0; // Actuation latency, printed after each run
   double LX_kinect_constant = 300;
  
   // Set velocity file and distance files
@@ -97,6 +141,7 @@ int main(int argc, char *argv[])
   double RY_velocity_feedforward_constant = 70;
   double RY_Kp = 0;
   double RY_Kd = 200;
+  int RY_lookahead_us = 0; // Actuation latency, printed after each run
 
   // Set velocity file and distance files
   string RY_VelocityFile = "y_throw_velocity_higher_throw_50cm.txt"; //"level_one_desired_velocity_40cm.txt"; // "y_circle.txt";
@@ -123,6 +168,7 @@ int main(int argc, char *argv[])
   double RX_velocity_feedforward_constant = 100; //103;
   double RX_Kp = 0;
   double RX_Kd = 200;
+  int RX_lookahead_us = 0; // Actuation latency, printed after each run
   double RX_kinect_constant = 1000;
 
   // Set velocity file and distance files
@@ -149,18 +195,26 @@ int main(int argc, char *argv[])
   //--------------------------------
   // Set up pin sampling rate. 
   // A sampling rate of 4 uS allows PWM signals of up to 10 kHz.
-  // Third argument is depricated and ignored. 
-  gpioCfgClock(PIN_SAMPLE_TIME, 1, 1);
+  hal_cfg_clock(PIN_SAMPLE_TIME);
 
   // Initialize the PIGPIO library. 
-  if (gpioInitialise() < 0) {
+  if (hal_initialise() < 0) {
     cout << "pigpio library failed to initialize. Exiting Now." << endl; 
     return 1;
   }
+
+#ifdef ROBOT_SIM
+  // Homing busy waits on the limit switches, so the simulated clock has to
+  // move by itself. Run it at real time.
+  sim_run(1.0);
+#endif
+
+  // Start the 64 bit clock so tick wraps (every ~71.6 minutes) are tracked.
+  mono_clock_start();
   
   // Immediatley set all PWM outputs as low to prevent any motors running.
-  gpioSetMode(LY_pwm_pin, PI_OUTPUT);
-  gpioWrite(LY_pwm_pin, 0);
+  hal_set_mode(LY_pwm_pin, HAL_OUTPUT);
+  hal_write(LY_pwm_pin, 0);
 
 
   //--------------------------------
@@ -172,24 +226,65 @@ int main(int argc, char *argv[])
   rot_encoder RX_encoder(RX_encoder_A_pin, RX_encoder_B_pin, RX_encoder_Z_pin, encoder_velocity_points);
 
 
+  //--------------------------------
+  //-----------EVENT LOG------------
+  //--------------------------------
+  // Written out by the telemetry writer, so it has to outlive it.
+  event_recorder events;
+  event_recorder* recorder = record_events ? &events : NULL;
+
+
   //--------------------------------
   //---------UDP COMM SETUP---------
   //--------------------------------
   udp_connection udp_comm(udp_port_number);
+  udp_comm.set_recorder(recorder);
   int udpflag = udp_comm.start_listening();  
 
 
+  //--------------------------------
+  //---------PATH PLANNING----------
+  //--------------------------------
+  // The Y path is kept as polynomial segments and evaluated at the exact
+  // tick, so plan has to live as long as the motors.
+  level1_plan plan;
+  if (plan_y_paths)
+  {
+    planner_params params;
+    params.ball_trajectory_height = ball_trajectory_height;
+    if (plan_level1(params, 2.0, plan))
+    {
+      cout << "Path planning failed. Using the path files." << endl;
+      plan_y_paths = false;
+    }
+    else
+    {
+      // 100 ms at rest before the throw, like the exported tables
+      plan.y.rampup.insert(plan.y.rampup.begin(), constant_acceleration_period(0.1, 0, 0, 0));
+    }
+  }
+
   //--------------------------------
   //-------MOTOR OBJECT SETUP-------
   //--------------------------------
   // Prototype
   // dc_motor(int DirPin, int PwmPin, int PwmFreq, int ULimitSwitch, int LLimitSwitch, rot_encoder* enc)
   dc_motor LY_motor(LY_axis, LY_dir_pin, LY_pwm_pin, PWM_FREQUENCY, LY_upper_limit_switch_pin, LY_lower_limit_switch_pin, &LY_encoder);
-  LY_motor.set_distance_file(LY_DistanceFile);
-  LY_motor.set_velocity_file(LY_VelocityFile);
+  if (plan_y_paths)
+    LY_motor.set_segment_path(&plan.y);
+  else
+  {
+    LY_motor.set_distance_file(LY_DistanceFile);
+    LY_motor.set_velocity_file(LY_VelocityFile);
+  }
   LY_motor.set_direction_factor(LY_direction_factor);
   LY_motor.set_constants(LY_open_loop_pwm_constant, LY_velocity_feedforward_constant, LY_Kp, LY_Kd);
   LY_motor.set_homing_parameters(LY_limit_width, LY_workspace_width, LY_up_pwm, LY_down_pwm);
+  LY_motor.set_control_rate(control_loop_rate);
+  LY_motor.set_lookahead(LY_lookahead_us);
+  if (load_motor_parameters)
+    LY_motor.load_parameters("motor_LY.txt");
+  LY_motor.set_recorder(recorder);
   
 
   dc_motor LX_motor(LX_axis, LX_dir_pin, LX_pwm_pin, PWM_FREQUENCY, LX_upper_limit_switch_pin, LX_lower_limit_switch_pin, &LX_encoder);
@@ -198,16 +293,31 @@ int main(int argc, char *argv[])
   LX_motor.set_direction_factor(LX_direction_factor);
   LX_motor.set_constants(LX_open_loop_pwm_constant, LX_velocity_feedforward_constant, LX_Kp, LX_Kd);
   LX_motor.set_homing_parameters(LX_limit_width, LX_workspace_width, LX_up_pwm, LX_down_pwm);
+  LX_motor.set_control_rate(control_loop_rate);
+  LX_motor.set_lookahead(LX_lookahead_us);
+  if (load_motor_parameters)
+    LX_motor.load_parameters("motor_LX.txt");
+  LX_motor.set_recorder(recorder);
   LX_motor.set_kinect_constant(LX_kinect_constant);
   LX_motor.add_comm(&udp_comm);
 
 
   dc_motor RY_motor(RY_axis, RY_dir_pin, RY_pwm_pin, PWM_FREQUENCY, RY_upper_limit_switch_pin, RY_lower_limit_switch_pin, &RY_encoder);
-  RY_motor.set_distance_file(RY_DistanceFile);
-  RY_motor.set_velocity_file(RY_VelocityFile);
+  if (plan_y_paths)
+    RY_motor.set_segment_path(&plan.y);
+  else
+  {
+    RY_motor.set_distance_file(RY_DistanceFile);
+    RY_motor.set_velocity_file(RY_VelocityFile);
+  }
   RY_motor.set_direction_factor(RY_direction_factor);
   RY_motor.set_constants(RY_open_loop_pwm_constant, RY_velocity_feedforward_constant, RY_Kp, RY_Kd);
   RY_motor.set_homing_parameters(RY_limit_width, RY_workspace_width, RY_up_pwm, RY_down_pwm);
+  RY_motor.set_control_rate(control_loop_rate);
+  RY_motor.set_lookahead(RY_lookahead_us);
+  if (load_motor_parameters)
+    RY_motor.load_parameters("motor_RY.txt");
+  RY_motor.set_recorder(recorder);
   
 
   dc_motor RX_motor(RX_axis, RX_dir_pin, RX_pwm_pin, PWM_FREQUENCY, RX_upper_limit_switch_pin, RX_lower_limit_switch_pin, &RX_encoder);
@@ -216,9 +326,55 @@ int main(int argc, char *argv[])
   RX_motor.set_direction_factor(RX_direction_factor);
   RX_motor.set_constants(RX_open_loop_pwm_constant, RX_velocity_feedforward_constant, RX_Kp, RX_Kd);
   RX_motor.set_homing_parameters(RX_limit_width, RX_workspace_width, RX_up_pwm, RX_down_pwm);
+  RX_motor.set_control_rate(control_loop_rate);
+  RX_motor.set_lookahead(RX_lookahead_us);
+  if (load_motor_parameters)
+    RX_motor.load_parameters("motor_RX.txt");
+  RX_motor.set_recorder(recorder);
   RX_motor.set_kinect_constant(RX_kinect_constant);
   RX_motor.add_comm(&udp_comm);
   
+  //--------------------------------
+  //-----------TELEMETRY------------
+  //--------------------------------
+  // Every control loop iteration of every motor is written to
+  // telemetry_XX.bin in the background while the robot runs.
+  telemetry_writer telemetry_log;
+  telemetry_log.add_channel(&LY_motor.telemetry, "LY");
+  telemetry_log.add_channel(&LX_motor.telemetry, "LX");
+  telemetry_log.add_channel(&RY_motor.telemetry, "RY");
+  telemetry_log.add_channel(&RX_motor.telemetry, "RX");
+  telemetry_stream telemetry_live;
+  if (record_events)
+    telemetry_log.set_event_log(&events);
+  if (stream_telemetry && (telemetry_live.open(telemetry_stream_host, telemetry_stream_port, TELEMETRY_STREAM_DECIMATION) == 0))
+    telemetry_log.set_stream(&telemetry_live);
+  telemetry_log.start();
+
+#ifdef ROBOT_SIM
+  //--------------------------------
+  //--------SIMULATED AXES----------
+  //--------------------------------
+  // A plant model on each motor's pins in place of the hardware, starting
+  // halfway between the limit switches.
+  motor_plant LY_plant(y_plant_params(LY_limit_width));
+  motor_plant LX_plant(x_plant_params(LX_limit_width));
+  motor_plant RY_plant(y_plant_params(RY_limit_width));
+  motor_plant RX_plant(x_plant_params(RX_limit_width));
+  LY_plant.set_position(LY_limit_width/2);
+  LX_plant.set_position(LX_limit_width/2);
+  RY_plant.set_position(RY_limit_width/2);
+  RX_plant.set_position(RX_limit_width/2);
+  sim_plant LY_sim(&LY_plant, LY_pwm_pin, LY_dir_pin, LY_encoder_A_pin, LY_encoder_B_pin, LY_upper_limit_switch_pin, LY_lower_limit_switch_pin);
+  sim_plant LX_sim(&LX_plant, LX_pwm_pin, LX_dir_pin, LX_encoder_A_pin, LX_encoder_B_pin, LX_upper_limit_switch_pin, LX_lower_limit_switch_pin);
+  sim_plant RY_sim(&RY_plant, RY_pwm_pin, RY_dir_pin, RY_encoder_A_pin, RY_encoder_B_pin, RY_upper_limit_switch_pin, RY_lower_limit_switch_pin);
+  sim_plant RX_sim(&RX_plant, RX_pwm_pin, RX_dir_pin, RX_encoder_A_pin, RX_encoder_B_pin, RX_upper_limit_switch_pin, RX_lower_limit_switch_pin);
+  LY_sim.attach();
+  LX_sim.attach();
+  RY_sim.attach();
+  RX_sim.attach();
+#endif
+
   //--------------------------------
   //----------MOTOR HOMING----------
   //--------------------------------
@@ -230,7 +386,7 @@ int main(int argc, char *argv[])
 
   vector<dc_motor*> fail_list;
   // Home LY_motor
-  cout << "Homing LY Motor." << cout;
+  cout << "Homing LY Motor." << endl;
   switch (LY_motor.home()) 
   {
     case 0: break;
@@ -240,12 +396,12 @@ int main(int argc, char *argv[])
     case 2: cout << "Motor failed to home." << endl;
             LY_encoder.deactivate();
             LX_encoder.deactivate();
-            gpioTerminate();
+            hal_terminate();
             return 0;
   }
 
   // Home LX_motor. 
-  cout << "Homing LX Motor." << cout;
+  cout << "Homing LX Motor." << endl;
   switch (LX_motor.home()) 
   {
     case 0: break;
@@ -255,12 +411,12 @@ int main(int argc, char *argv[])
     case 2: cout << "Motor failed to home." << endl;
             LY_encoder.deactivate();
             LX_encoder.deactivate();
-            gpioTerminate();
+            hal_terminate();
             return 0;
   }
 
   // Home RX_motor. 
-  cout << "Homing RX Motor." << cout;
+  cout << "Homing RX Motor." << endl;
   switch (RX_motor.home()) 
   {
     case 0: break;
@@ -270,13 +426,13 @@ int main(int argc, char *argv[])
     case 2: cout << "Motor failed to home." << endl;
             RY_encoder.deactivate();
             RX_encoder.deactivate();
-            gpioTerminate();
+            hal_terminate();
             return 0;
   }
 
   // Home RY_motor
 
-  cout << "Homing RY Motor." << cout;
+  cout << "Homing RY Motor." << endl;
   switch (RY_motor.home()) 
   {
     case 0: break;
@@ -286,7 +442,7 @@ int main(int argc, char *argv[])
     case 2: cout << "Motor failed to home." << endl;
             RY_encoder.deactivate();
             RX_encoder.deactivate();
-            gpioTerminate();
+            hal_terminate();
             return 0;
   }
   
@@ -302,7 +458,7 @@ int main(int argc, char *argv[])
       LX_encoder.deactivate();
       RY_encoder.deactivate();
       RX_encoder.deactivate();
-      gpioTerminate();
+      hal_terminate();
       return 0;
     }
   }
@@ -326,12 +482,13 @@ int main(int argc, char *argv[])
     cout << "5. Open Loop Throw-Catch (Left to Right)" << endl;
     cout << "6. Closed-Loop (CV aided) Throw-Catch (Left to Right)" << endl;
     cout << "7. Kinect following the ball" << endl;
-    cout << "8. EXIT" << endl;
+    cout << "8. Continuous Double One Hand Throw-Catch (planned paths)" << endl;
+    cout << "9. EXIT" << endl;
     cout << ">> ";
 
     getline(cin,instring);
     stringstream(instring) >> invalue;
-    if (invalue == 8)
+    if (invalue == 9)
       break;
 
     switch (invalue)
@@ -350,6 +507,8 @@ int main(int argc, char *argv[])
               break;
       case 7: main_kinect(&LY_motor, &LX_motor, &RY_motor, &RX_motor);
               break;
+      case 8: main_stream_1htc(&LY_motor, &LX_motor, &RY_motor, &RX_motor);
+              break;
     }
   }
 
@@ -357,11 +516,13 @@ int main(int argc, char *argv[])
   //--------Program Termination-----
   //--------------------------------
   udp_comm.kill_connection();
+  telemetry_log.stop();
   LY_encoder.deactivate();
   LX_encoder.deactivate();
   RY_encoder.deactivate();
   RX_encoder.deactivate();
-  gpioTerminate();
+  mono_clock_stop();
+  hal_terminate();
   return 0;
 }
 
@@ -381,7 +542,7 @@ void main_l1htc(dc_motor* LY_motor, dc_motor* LX_motor, dc_motor* RY_motor, dc_m
   //--------------------------------
   //------ONE HAND THROW CATCH------
   //--------------------------------
-  uint32_t tick = gpioTick();
+  uint64_t tick = mono_tick();
   int delay_seconds = 1;
   cout << "Motors will activate in: " << delay_seconds << " seconds." << endl;
   LY_motor->run_pdff_path(tick, delay_seconds);
@@ -391,7 +552,7 @@ void main_r1htc(dc_motor* LY_motor, dc_motor* LX_motor, dc_motor* RY_motor, dc_m
   //--------------------------------
   //------ONE HAND THROW CATCH------
   //--------------------------------
-  uint32_t tick = gpioTick();
+  uint64_t tick = mono_tick();
   int delay_seconds = 1;
   cout << "Motors will activate in: " << delay_seconds << " seconds." << endl;
   RY_motor->run_pdff_path(tick, delay_seconds);
@@ -399,43 +560,22 @@ void main_r1htc(dc_motor* LY_motor, dc_motor* LX_motor, dc_motor* RY_motor, dc_m
 
 void main_double_1htc(dc_motor* LY_motor, dc_motor* LX_motor, dc_motor* RY_motor, dc_motor* RX_motor)
 {
-  uint32_t tick = gpioTick();
+  uint64_t tick = mono_tick();
   int delay_seconds = 5;
-  int timeout = 12;
   cout << "Motors will activate in: " << delay_seconds << " seconds." << endl;
 
-
-  // Create motor sync_struct objects. Since we can only pass one agument into
-  // the thread creation function, we package all of our necessary data into a 
-  // sync_struct so that the thread has everything it needs to run!
-  motor_sync_struct LY_sync_struct = make_sync_struct(LY_motor, tick, delay_seconds);
-  motor_sync_struct RY_sync_struct = make_sync_struct(RY_motor, tick, delay_seconds);
-
-  pthread_t *pt_LX, *pt_LY, *pt_RX, *pt_RY;
-
-  // Create a thread for each motor. 
-  // Each thread calls the sync_pdff function, which runs the closed loop
-  // PD-FeedForward loop on the motor named in the sync_struct. 
-  pt_LY = gpioStartThread(sync_pdff, &LY_sync_struct);
-  pt_RY = gpioStartThread(sync_pdff, &RY_sync_struct);
-
-  // Poll the active motors to ensure the motors are done running.
-  // When all of them report that they are done, kill the threads to be safe.
-  // Poll every second.
-
-  while(!(LY_motor->all_done()) || !(RY_motor->all_done()))
-  {
-    gpioSleep(PI_TIME_RELATIVE, 3, 0);
-  }
-
+  // Both Y axes are stepped from this one thread, against the same
+  // timestamp every control period.
+  axis_group group;
+  group.set_control_rate(LY_motor->loop_timer.get_rate());
+  group.add_axis(LY_motor, delay_seconds);
+  group.add_axis(RY_motor, delay_seconds);
+  group.run_pdff(tick);
 
   LX_motor->all_done_flag = false;
   LY_motor->all_done_flag = false;
   RX_motor->all_done_flag = false;
   RY_motor->all_done_flag = false;
-
-  gpioStopThread(pt_LY);
-  gpioStopThread(pt_RY);
 }
 
 void main_ol_tc(dc_motor* LY_motor, dc_motor* LX_motor, dc_motor* RY_motor, dc_motor* RX_motor)
@@ -445,47 +585,24 @@ void main_ol_tc(dc_motor* LY_motor, dc_motor* LX_motor, dc_motor* RY_motor, dc_m
   //----------THROW-CATCH-----------
   //--------------------------------
   
-  uint32_t tick = gpioTick();
+  uint64_t tick = mono_tick();
   int delay_seconds = 5;
   cout << "Motors will activate in: " << delay_seconds << " seconds." << endl;
 
-
-  // Create motor sync_struct objects. Since we can only pass one agument into
-  // the thread creation function, we package all of our necessary data into a 
-  // sync_struct so that the thread has everything it needs to run!
-  motor_sync_struct LY_sync_struct = make_sync_struct(LY_motor, tick, delay_seconds);
-  motor_sync_struct LX_sync_struct = make_sync_struct(LX_motor, tick, delay_seconds);
-  motor_sync_struct RY_sync_struct = make_sync_struct(RY_motor, tick, delay_seconds);
-  motor_sync_struct RX_sync_struct = make_sync_struct(RX_motor, tick, delay_seconds);
-
-  pthread_t *pt_LX, *pt_LY, *pt_RX, *pt_RY;
-
-  // Create a thread for each motor. 
-  // Each thread calls the sync_pdff function, which runs the closed loop
-  // PD-FeedForward loop on the motor named in the sync_struct. 
-  pt_LY = gpioStartThread(sync_pdff, &LY_sync_struct);
-  pt_LX = gpioStartThread(sync_pdff, &LX_sync_struct);
-  pt_RY = gpioStartThread(sync_pdff, &RY_sync_struct);
-  pt_RX = gpioStartThread(sync_pdff, &RX_sync_struct);
-
-  // Poll the active motors to ensure the motors are done running.
-  // When all of them report that they are done, kill the threads to be safe.
-  // Poll every second.
-
-  while(!(LX_motor->all_done()) || !(LY_motor->all_done()) || !(RX_motor->all_done()) || !(RY_motor->all_done()))
-  {
-    gpioSleep(PI_TIME_RELATIVE, 3, 0);
-  }
+  // All four axes run in lockstep from this one thread. Each control
+  // period reads the clock once and steps LY, LX, RY and RX against it.
+  axis_group group;
+  group.set_control_rate(LY_motor->loop_timer.get_rate());
+  group.add_axis(LY_motor, delay_seconds);
+  group.add_axis(LX_motor, delay_seconds);
+  group.add_axis(RY_motor, delay_seconds);
+  group.add_axis(RX_motor, delay_seconds);
+  group.run_pdff(tick);
 
   LX_motor->all_done_flag = false;
   LY_motor->all_done_flag = false;
   RX_motor->all_done_flag = false;
   RY_motor->all_done_flag = false;
-
-  gpioStopThread(pt_LX);
-  gpioStopThread(pt_LY);
-  gpioStopThread(pt_RX);
-  gpioStopThread(pt_RY);
 }
                    
 void main_cl_tc(dc_motor* LY_motor, dc_motor* LX_motor, dc_motor* RY_motor, dc_motor* RX_motor)
@@ -495,48 +612,24 @@ void main_cl_tc(dc_motor* LY_motor, dc_motor* LX_motor, dc_motor* RY_motor, dc_m
   //----------THROW-CATCH-----------
   //--------------------------------
   
-  uint32_t tick = gpioTick();
+  uint64_t tick = mono_tick();
   int delay_seconds = 5;
   int timeout = 12;
   cout << "Motors will activate in: " << delay_seconds << " seconds." << endl;
 
-
-  // Create motor sync_struct objects. Since we can only pass one agument into
-  // the thread creation function, we package all of our necessary data into a 
-  // sync_struct so that the thread has everything it needs to run!
-  motor_sync_struct LY_sync_struct = make_sync_struct(LY_motor, tick, delay_seconds);
-  motor_sync_struct LX_sync_struct = make_sync_struct(LX_motor, tick, delay_seconds);
-  motor_sync_struct RY_sync_struct = make_sync_struct(RY_motor, tick, delay_seconds);
-  motor_sync_struct RX_sync_struct = make_sync_struct(RX_motor, tick, timeout);
-
-  pthread_t *pt_LX, *pt_LY, *pt_RX, *pt_RY;
-
-  // Create a thread for each motor. 
-  // Each thread calls the sync_pdff function, which runs the closed loop
-  // PD-FeedForward loop on the motor named in the sync_struct. 
-  pt_LY = gpioStartThread(sync_pdff, &LY_sync_struct);
-  pt_LX = gpioStartThread(sync_pdff, &LX_sync_struct);
-  pt_RY = gpioStartThread(sync_pdff, &RY_sync_struct);
-  pt_RX = gpioStartThread(sync_pdff, &RX_sync_struct);
-
-  // Poll the active motors to ensure the motors are done running.
-  // When all of them report that they are done, kill the threads to be safe.
-  // Poll every second.
-
-  while(!(LX_motor->all_done()) || !(LY_motor->all_done()) || !(RX_motor->all_done()) || !(RY_motor->all_done()))
-  {
-    gpioSleep(PI_TIME_RELATIVE, 3, 0);
-  }
+  // All four axes run in lockstep from this one thread. RX starts later.
+  axis_group group;
+  group.set_control_rate(LY_motor->loop_timer.get_rate());
+  group.add_axis(LY_motor, delay_seconds);
+  group.add_axis(LX_motor, delay_seconds);
+  group.add_axis(RY_motor, delay_seconds);
+  group.add_axis(RX_motor, timeout);
+  group.run_pdff(tick);
 
   LX_motor->all_done_flag = false;
   LY_motor->all_done_flag = false;
   RX_motor->all_done_flag = false;
   RY_motor->all_done_flag = false;
-
-  gpioStopThread(pt_LX);
-  gpioStopThread(pt_LY);
-  gpioStopThread(pt_RX);
-  gpioStopThread(pt_RY);
 }
 
 void main_kinect(dc_motor* LY_motor, dc_motor* LX_motor, dc_motor* RY_motor, dc_motor* RX_motor)
@@ -550,6 +643,79 @@ void main_kinect(dc_motor* LY_motor, dc_motor* LX_motor, dc_motor* RY_motor, dc_
   return;
 }
 
+void main_stream_1htc(dc_motor* LY_motor, dc_motor* LX_motor, dc_motor* RY_motor, dc_motor* RX_motor)
+{
+  //--------------------------------
+  //----CONTINUOUS THROW CATCH------
+  //--------------------------------
+  // Both Y axes repeat the loop of their planned path until Enter is
+  // pressed, then finish the cycle they are in and ramp down. Typing a
+  // ball height first plans a new path and swaps it in at the next rest
+  // at the bottom, without stopping.
+  if (!(LY_motor->segment_cursor.get_path()) || !(RY_motor->segment_cursor.get_path()))
+  {
+    cout << "Continuous mode needs planned paths. Set plan_y_paths in main.cpp." << endl;
+    return;
+  }
+
+  uint64_t tick = mono_tick();
+  int delay_seconds = 5;
+  cout << "Motors will activate in: " << delay_seconds << " seconds." << endl;
+  cout << "Press Enter to stop, or type a new ball height (m) and Enter to change it." << endl;
+
+  axis_group group;
+  group.set_control_rate(LY_motor->loop_timer.get_rate());
+  group.add_axis(LY_motor, delay_seconds);
+  group.add_axis(RY_motor, delay_seconds);
+  if (group.start_stream(tick))
+    return;
+
+  // Print each cycle as it finishes, and watch for Enter.
+  string instring;
+  stream_cycle_stats stats;
+  while (group.streaming())
+  {
+    fd_set input;
+    FD_ZERO(&input);
+    FD_SET(0, &input);
+    struct timeval timeout = {0, 100000};
+    if ((select(1, &input, NULL, NULL, &timeout) > 0) && FD_ISSET(0, &input))
+    {
+      getline(cin, instring);
+      double height = 0;
+      if (!(stringstream(instring) >> height))
+      {
+        cout << "Stopping after this cycle..." << endl;
+        group.request_stop();
+      }
+      else if (LY_motor->segment_path_pending() || RY_motor->segment_path_pending())
+        cout << "The last height has not taken over yet. Try again next cycle." << endl;
+      else
+      {
+        // Planned here, copied into the motors' spare buffers. The control
+        // thread never waits on it.
+        planner_params params;
+        params.ball_trajectory_height = height;
+        level1_plan next_plan;
+        if (plan_level1(params, 2.0, next_plan))
+          cout << "Path planning failed. Keeping the current path." << endl;
+        else if (LY_motor->stage_segment_path(next_plan.y) && RY_motor->stage_segment_path(next_plan.y))
+          cout << "Ball height " << height << " m from the next cycle." << endl;
+      }
+    }
+
+    while (group.poll_cycle(stats))
+      axis_group::print_cycle(stats);
+  }
+  group.stop_stream();
+  while (group.poll_cycle(stats))
+    axis_group::print_cycle(stats);
+
+  LX_motor->all_done_flag = false;
+  LY_motor->all_done_flag = false;
+  RX_motor->all_done_flag = false;
+  RY_motor->all_done_flag = false;
+}
 
 
 
@@ -557,7 +723,7 @@ void main_kinect(dc_motor* LY_motor, dc_motor* LX_motor, dc_motor* RY_motor, dc_
   //--------------------------------
   //--------OPEN LOOP CONTROL-------
   //--------------------------------
-  //uint32_t tick = gpioTick();
+  //uint64_t tick = mono_tick();
   //int delay_seconds = 1;
   //cout << "Motors will activate in: " << delay_seconds << " seconds." << endl;
   //LY_motor.run_ol_path(tick, delay_seconds);
@@ -566,12 +732,12 @@ void main_kinect(dc_motor* LY_motor, dc_motor* LX_motor, dc_motor* RY_motor, dc_
   //--------------------------------
   //--------CLOSED LOOP CONTROL-----
   //--------------------------------
-  //uint32_t tick = gpioTick();
+  //uint64_t tick = mono_tick();
   //int delay_seconds = 1;
   //cout << "Motors will activate in: " << delay_seconds << " seconds." << endl;
   //LY_motor.run_pdff_path(tick, delay_seconds);
 
-  //uint32_t tick = gpioTick();
+  //uint64_t tick = mono_tick();
   //int delay_seconds =1; 
   //cout << "Motors will activate in: " << delay_seconds << " seconds." << endl;
   //RX_motor.run_pdff_path(tick, delay_seconds);
@@ -586,7 +752,7 @@ void main_kinect(dc_motor* LY_motor, dc_motor* LX_motor, dc_motor* RY_motor, dc_
   //-------------------------------
   // Left frame will throw, right frame will catch.
 /*
-  uint32_t tick = gpioTick();
+  uint64_t tick = mono_tick();
   int delay_seconds = 5;
   int udp_timeout = 15; //Seconds
   cout << "Motors will activate in: " << delay_seconds << " seconds." << endl;
@@ -606,10 +772,10 @@ void main_kinect(dc_motor* LY_motor, dc_motor* LX_motor, dc_motor* RY_motor, dc_
   // Each thread calls either the the sync_pdff function, which runs the closed loop
   // PD-FeedForward loop on the motor named in the sync_struct, or the sync_kinect,
   // which makes it immediatley wait for orders from the kinect. 
-  pt_LY = gpioStartThread(sync_pdff, &LY_sync_struct);
-  pt_LX = gpioStartThread(sync_pdff, &LX_sync_struct);
-  pt_RY = gpioStartThread(sync_pdff, &RY_sync_struct);
-  pt_RX = gpioStartThread(sync_kinect, &RX_sync_struct);
+  pt_LY = hal_start_thread(sync_pdff, &LY_sync_struct);
+  pt_LX = hal_start_thread(sync_pdff, &LX_sync_struct);
+  pt_RY = hal_start_thread(sync_pdff, &RY_sync_struct);
+  pt_RX = hal_start_thread(sync_kinect, &RX_sync_struct);
 
   // Poll the active motors to ensure the motors are done running.
   // When all of them report that they are done, kill the threads to be safe.
@@ -617,11 +783,11 @@ void main_kinect(dc_motor* LY_motor, dc_motor* LX_motor, dc_motor* RY_motor, dc_
 
   while(!(LX_motor.all_done()) || !(LY_motor.all_done()) || !(RX_motor.all_done()) || !(RY_motor.all_done()))
   {
-    gpioSleep(PI_TIME_RELATIVE, 3, 0);
+    hal_sleep(3, 0);
   }
 
-  gpioStopThread(pt_LX);
-  gpioStopThread(pt_LY);
-  gpioStopThread(pt_RX);
-  gpioStopThread(pt_RY);
+  hal_stop_thread(pt_LX);
+  hal_stop_thread(pt_LY);
+  hal_stop_thread(pt_RX);
+  hal_stop_thread(pt_RY);
   */
@@ -24,4 +24,6 @@ void main_cl_tc(dc_motor* LY_motor, dc_motor* LX_motor, dc_motor* RY_motor, dc_m
 
 void main_kinect(dc_motor* LY_motor, dc_motor* LX_motor, dc_motor* RY_motor, dc_motor* RX_motor);
 
+void main_stream_1htc(dc_motor* LY_motor, dc_motor* LX_motor, dc_motor* RY_motor, dc_motor* RX_motor); // Continuous double one hand throw catch
+
 #endif
@@ -0,0 +1,62 @@
+/* mono_clock.cpp
+
+   Created 10/16/2026
+
+   This is the cpp file for the 64 bit monotonic clock. See mono_clock.hpp.
+*/
+
+#include <atomic>
+#include "hal.hpp"
+#include "mono_clock.hpp"
+
+// Latest extended tick seen by anyone.
+static std::atomic<uint64_t> last_mono_tick(0);
+
+uint64_t extend_tick(uint64_t reference, uint32_t tick)
+{
+	// Signed distance from the low half of the reference. This is correct
+	// on either side of a wrap as long as the two are within 2^31 us.
+	int32_t delta = (int32_t) (tick - (uint32_t) reference);
+	return(reference + (int64_t) delta);
+}
+
+uint64_t mono_extend(uint32_t tick)
+{
+	uint64_t last = last_mono_tick.load(std::memory_order_acquire);
+
+	// The very first tick starts the timeline as is.
+	uint64_t extended = (last == 0) ? (uint64_t) tick : extend_tick(last, tick);
+
+	// Only ever move the reference forward. Callback ticks can be a little
+	// older than a tick another thread already read.
+	while ((extended > last) &&
+	       !last_mono_tick.compare_exchange_weak(last, extended, std::memory_order_acq_rel))
+		;
+	return(extended);
+}
+
+uint64_t mono_tick()
+{
+	return(mono_extend(hal_tick()));
+}
+
+void mono_clock_reset(uint64_t tick)
+{
+	last_mono_tick.store(tick, std::memory_order_release);
+}
+
+static void _mono_clock_refresh(void *userdata)
+{
+	mono_tick();
+}
+
+void mono_clock_start()
+{
+	mono_tick();
+	hal_set_timer(MONO_CLOCK_TIMER, MONO_CLOCK_REFRESH_MS, _mono_clock_refresh, NULL);
+}
+
+void mono_clock_stop()
+{
+	hal_set_timer(MONO_CLOCK_TIMER, MONO_CLOCK_REFRESH_MS, NULL, NULL);
+}
@@ -0,0 +1,45 @@
+/* mono_clock.hpp
+
+   Created 10/16/2026
+
+   This is the header file for the 64 bit monotonic clock.
+
+   gpioTick() is a 32 bit microsecond counter, so it wraps back to zero
+   about every 71.6 minutes. Comparing raw ticks (gpioTick() < start_tick)
+   breaks across a wrap, so every loop and the encoder history use the
+   extended tick from here instead.
+
+   The extension works off the last extended tick anyone saw. Any 32 bit
+   tick within +/- 35 minutes of it can be placed unambiguously, and a
+   pigpio timer refreshes it every minute so a wrap is never missed even
+   when nothing else is reading the clock.
+*/
+
+#ifndef __MONO_CLOCK_HPP__
+#define __MONO_CLOCK_HPP__
+
+#include <stdint.h>
+
+// Pigpio timer slot used to keep the clock fresh, and how often (ms)
+#define MONO_CLOCK_TIMER 9
+#define MONO_CLOCK_REFRESH_MS 60000
+
+// Place a 32 bit tick on the 64 bit timeline next to reference.
+uint64_t extend_tick(uint64_t reference, uint32_t tick);
+
+// Current time in microseconds, never wraps.
+uint64_t mono_tick();
+
+// Extend a tick handed to us by pigpio (e.g. in an alert callback).
+uint64_t mono_extend(uint32_t tick);
+
+// Put the extension at tick, as if it had just been read. For replaying a
+// log on the simulated clock (event_replay), whose ticks may be past a wrap.
+void mono_clock_reset(uint64_t tick);
+
+// Start/stop the timer that keeps the extension fresh. Call after
+// hal_initialise().
+void mono_clock_start();
+void mono_clock_stop();
+
+#endif
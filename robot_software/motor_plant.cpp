@@ -0,0 +1,224 @@
+/* motor_plant.cpp
+
+   Created 10/16/2026
+
+   This is the cpp file holding the function definitions for the
+   motor_plant class. See motor_plant.hpp.
+*/
+
+#include <cmath>
+#include "motor_plant.hpp"
+
+using namespace std;
+
+plant_params y_plant_params(double limit_width)
+{
+	plant_params params;
+	params.supply_voltage = 12;
+	params.resistance = 0.59;
+	params.inductance = 0.001;
+	params.back_emf_constant = 0.01;
+	params.torque_constant = 0.01;
+	params.gear_ratio = 10;
+	params.rotor_inertia = 1e-6;
+	params.pulley_inertia = 2e-5;
+	params.d_pulley = 0.0652015;
+	params.mass = 0.25;
+	// About 0.245 N per duty cycle at stall, so 55 to start up and 35 to
+	// start down, then about 67 more per m/s.
+	params.coulomb_friction = 11.0;
+	params.viscous_friction = 0.5;
+	params.gravity = 9.81;
+	params.limit_width = limit_width;
+	params.overtravel = 0.01;
+	params.counts_per_rev = 1024;
+	return(params);
+}
+
+plant_params x_plant_params(double limit_width)
+{
+	plant_params params = y_plant_params(limit_width);
+	params.mass = 0.15;
+	params.coulomb_friction = 12.2;
+	params.gravity = 0;
+	return(params);
+}
+
+// Default Constructor
+motor_plant::motor_plant()
+{
+	this->set_params(y_plant_params(0.5));
+	edge_func = NULL;
+	edge_data = NULL;
+	this->set_position(0);
+}
+
+// Constructor
+motor_plant::motor_plant(const plant_params& params)
+{
+	this->set_params(params);
+	edge_func = NULL;
+	edge_data = NULL;
+	this->set_position(0);
+}
+
+void motor_plant::set_params(const plant_params& params)
+{
+	this->params = params;
+	radius = params.d_pulley / 2;
+	effective_mass = params.mass +
+	                 (params.rotor_inertia*params.gear_ratio*params.gear_ratio + params.pulley_inertia)/(radius*radius);
+	edges_per_meter = 4 * this->count_per_meter();
+	decay_dt_us = 0;
+}
+
+const plant_params& motor_plant::get_params() const
+{
+	return(params);
+}
+
+void motor_plant::set_position(double position)
+{
+	this->position = position;
+	velocity = 0;
+	current = 0;
+	quadrature = (int64_t) floor(position * edges_per_meter);
+}
+
+void motor_plant::set_encoder_output(plant_edge_func func, void *userdata)
+{
+	edge_func = func;
+	edge_data = userdata;
+}
+
+void motor_plant::step(uint64_t now, uint32_t dt_us, int duty_cycle, int dir_level)
+{
+	double dt = dt_us * 1e-6;
+	double voltage = params.supply_voltage * duty_cycle / 255.0;
+	if (dir_level)
+		voltage = -voltage;
+
+	// The current settles towards its steady value with time constant L/R.
+	double omega = params.gear_ratio * velocity / radius;
+	double steady = (voltage - params.back_emf_constant*omega) / params.resistance;
+	if (params.inductance > 0)
+	{
+		if (dt_us != decay_dt_us)
+		{
+			decay = exp(-dt*params.resistance/params.inductance);
+			decay_dt_us = dt_us;
+		}
+		current = steady + (current - steady)*decay;
+	}
+	else
+		current = steady;
+
+	double force = params.gear_ratio*params.torque_constant*current/radius
+	               - params.mass*params.gravity - params.viscous_friction*velocity;
+
+	if ((fabs(velocity) < PLANT_STICK_VELOCITY) && (fabs(force) <= params.coulomb_friction))
+	{
+		// Stuck
+		velocity = 0;
+	}
+	else
+	{
+		double moving = (fabs(velocity) >= PLANT_STICK_VELOCITY) ? velocity : force;
+		double friction = (moving > 0) ? params.coulomb_friction : -params.coulomb_friction;
+		double new_velocity = velocity + dt*(force - friction)/effective_mass;
+
+		// Friction can stop the axis, but never turn it around.
+		if ((velocity != 0) && ((new_velocity > 0) != (velocity > 0)))
+			new_velocity = 0;
+		velocity = new_velocity;
+	}
+
+	double old_position = position;
+	position += velocity*dt;
+
+	double lowest = -params.overtravel;
+	double highest = params.limit_width + params.overtravel;
+	if (position < lowest)
+	{
+		position = lowest;
+		velocity = 0;
+	}
+	else if (position > highest)
+	{
+		position = highest;
+		velocity = 0;
+	}
+
+	this->emit_edges((int64_t) floor(position * edges_per_meter), old_position, position, now - dt_us, dt_us);
+}
+
+void motor_plant::emit_edges(int64_t target, double x0, double x1, uint64_t t0, uint32_t dt_us)
+{
+	while (quadrature != target)
+	{
+		bool up = (target > quadrature);
+		int64_t next = up ? (quadrature + 1) : (quadrature - 1);
+
+		// Place the edge where the position crossed the boundary between
+		// the two states.
+		int64_t boundary_state = up ? next : quadrature;
+		double fraction = 1;
+		if (x1 != x0)
+			fraction = (boundary_state/edges_per_meter - x0)/(x1 - x0);
+		fraction = (fraction < 0) ? 0 : ((fraction > 1) ? 1 : fraction);
+		uint64_t tick = t0 + (uint64_t) (fraction*dt_us + 0.5);
+
+		// States 0-3 are (A,B) = 00, 01, 11, 10. From an even state B
+		// changes, from an odd one A.
+		int64_t lower_state = up ? quadrature : next;
+		quadrature = next;
+		if (!edge_func)
+			continue;
+		if (lower_state & 1)
+			edge_func(0, this->get_a_level(), tick, edge_data);
+		else
+			edge_func(1, this->get_b_level(), tick, edge_data);
+	}
+}
+
+double motor_plant::get_position() const
+{
+	return(position);
+}
+
+double motor_plant::get_velocity() const
+{
+	return(velocity);
+}
+
+double motor_plant::get_current() const
+{
+	return(current);
+}
+
+double motor_plant::count_per_meter() const
+{
+	return(params.counts_per_rev / (M_PI * params.d_pulley));
+}
+
+int motor_plant::get_a_level() const
+{
+	int state = (int) (quadrature & 3);
+	return((state == 2) || (state == 3));
+}
+
+int motor_plant::get_b_level() const
+{
+	int state = (int) (quadrature & 3);
+	return((state == 1) || (state == 2));
+}
+
+bool motor_plant::lower_pressed() const
+{
+	return(position <= 0);
+}
+
+bool motor_plant::upper_pressed() const
+{
+	return(position >= params.limit_width);
+}
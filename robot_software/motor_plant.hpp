@@ -0,0 +1,132 @@
+/* motor_plant.hpp
+
+   Created 10/16/2026
+
+   This is the header file for the motor_plant class.
+
+   A motor_plant is a physics model of one gantry axis: a DC motor driven
+   by the PWM duty cycle and direction pin, through a gearbox to a pulley
+   and belt carrying the hand. It integrates
+
+       L di/dt = V - R i - Ke w            V = supply * duty/255, sign from dir
+       m_eff dv/dt = gear Kt i / r - m g - b v - Fc sign(v)
+
+   with w the motor shaft speed, r the pulley radius and m_eff the belt
+   mass plus the rotor and pulley inertia seen at the belt. The current
+   is integrated exactly over each step, so any step size is stable.
+   Coulomb friction holds the axis still until the drive force beats it.
+   Gravity only acts on Y axes.
+
+   Position is measured up (or out) from the lower limit switch. The
+   switches sit at 0 and limit_width, and hard stops overtravel past each.
+   A quadrature encoder on the pulley shaft turns position into A/B edges,
+   each given the tick at which the position crossed it, so an encoder
+   sees edges between steps just as it would from the real pins. Up is
+   the direction rot_encoder counts positive.
+
+   The plant knows nothing about pins; sim_plant.hpp connects it to the
+   simulated GPIO. The default parameters are nominal values chosen so the
+   velocity feedforward (60-70 duty per m/s on Y) and the homing duty
+   cycles in main.cpp come out about as they do on the robot.
+*/
+
+#ifndef __MOTOR_PLANT_HPP__
+#define __MOTOR_PLANT_HPP__
+
+#include <stdint.h>
+
+// Below this speed (m/s) Coulomb friction can hold the axis still
+#define PLANT_STICK_VELOCITY 1e-4
+
+struct plant_params {
+	double supply_voltage;     // V at duty cycle 255
+	double resistance;         // ohm
+	double inductance;         // H (0 for none)
+	double back_emf_constant;  // V s/rad at the motor shaft
+	double torque_constant;    // N m/A at the motor shaft
+	double gear_ratio;         // motor turns per pulley turn
+	double rotor_inertia;      // kg m^2
+	double pulley_inertia;     // kg m^2
+	double d_pulley;           // m
+	double mass;               // kg carried by the belt
+	double coulomb_friction;   // N
+	double viscous_friction;   // N s/m
+	double gravity;            // m/s^2 pulling down the axis (0 on X)
+	double limit_width;        // m between the limit switches
+	double overtravel;         // m from a switch to its hard stop
+	int counts_per_rev;        // encoder counts per pulley turn
+};
+
+// Nominal parameters for the Y (vertical) and X (horizontal) axes
+plant_params y_plant_params(double limit_width);
+plant_params x_plant_params(double limit_width);
+
+// Called for every encoder edge: channel 0 is A, 1 is B
+typedef void (*plant_edge_func)(int channel, int level, uint64_t tick, void *userdata);
+
+class motor_plant
+{
+public:
+
+	// Default Constructor
+	motor_plant();
+
+	// Constructor
+	motor_plant(const plant_params& params);
+
+	// Change the model, keeping the present state
+	void set_params(const plant_params& params);
+	const plant_params& get_params() const;
+
+	// Put the axis at rest at position (m), without any edges
+	void set_position(double position);
+
+	// Where encoder edges go (NULL for nowhere)
+	void set_encoder_output(plant_edge_func func, void *userdata);
+
+	// Advance dt_us microseconds ending at now with the given duty cycle
+	// (0-255) and direction pin level (0 is up).
+	void step(uint64_t now, uint32_t dt_us, int duty_cycle, int dir_level);
+
+	double get_position() const;
+	double get_velocity() const;
+	double get_current() const;
+
+	// Encoder counts per meter of belt
+	double count_per_meter() const;
+
+	// Present A and B levels
+	int get_a_level() const;
+	int get_b_level() const;
+
+	bool lower_pressed() const;
+	bool upper_pressed() const;
+
+private:
+
+	plant_params params;
+
+	// Emit the edges from the present quadrature state to target
+	void emit_edges(int64_t target, double x0, double x1, uint64_t t0, uint32_t dt_us);
+
+	double position;
+	double velocity;
+	double current;
+
+	// Quadrature state: four per count
+	int64_t quadrature;
+
+	// Precomputed from params
+	double radius;
+	double effective_mass;
+	double edges_per_meter;
+
+	// Current decay over a step of decay_dt_us
+	double decay;
+	uint32_t decay_dt_us;
+
+	plant_edge_func edge_func;
+	void *edge_data;
+};
+
+#endif
@@ -17,12 +17,12 @@
    Struct is as follows:
    struct motor_sync_struct {
       dc_motor *motor;
-      uint32_t tick;
+      uint64_t tick;
       int delay;
    }
 */
 
-motor_sync_struct make_sync_struct(dc_motor *motor, uint32_t tick, int timing)
+motor_sync_struct make_sync_struct(dc_motor *motor, uint64_t tick, int timing)
 {
    motor_sync_struct output_struct;
    output_struct.motor = motor;
@@ -38,7 +38,7 @@ void *sync_pdff(void *s_struct)
 
    // Unpack struct members
    dc_motor* motor = struct_ptr->motor;
-   uint32_t tick = struct_ptr->tick;
+   uint64_t tick = struct_ptr->tick;
    int delay = struct_ptr->timing;
 
    // Run the motor on a pdff path. 
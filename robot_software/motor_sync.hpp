@@ -10,16 +10,16 @@
 #ifndef __MOTOR_SYNC_HPP__
 #define __MOTOR_SYNC_HPP__
 
-#include <pigpio.h>
+#include "hal.hpp"
 #include "dc_motor.hpp"
 
 struct motor_sync_struct {
    dc_motor *motor;
-   uint32_t tick;
+   uint64_t tick;
    int timing;
 };
 
-motor_sync_struct make_sync_struct(dc_motor *motor, uint32_t tick, int timing);
+motor_sync_struct make_sync_struct(dc_motor *motor, uint64_t tick, int timing);
 
 void *sync_pdff(void *s_struct);
 
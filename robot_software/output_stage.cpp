@@ -0,0 +1,95 @@
+/* output_stage.cpp
+
+   Created 10/16/2026
+
+   This is the cpp file holding the function definitions for the
+   output_stage class. See output_stage.hpp.
+*/
+
+#include <stdio.h>
+#include "hal.hpp"
+#include "output_stage.hpp"
+
+// Default Constructor
+output_stage::output_stage()
+{
+	used_mask = 0;
+	desired_levels = 0;
+	current_levels = 0;
+	known_mask = 0;
+	pwm_count = 0;
+}
+
+void output_stage::set_level(int pin, int level)
+{
+	if ((pin < 0) || (pin >= OUTPUT_STAGE_PINS))
+	{
+		printf("Pin %d can not be staged. Writing it directly.\n", pin);
+		hal_write(pin, level);
+		return;
+	}
+
+	uint32_t bit = ((uint32_t) 1) << pin;
+	used_mask |= bit;
+	if (level)
+		desired_levels |= bit;
+	else
+		desired_levels &= ~bit;
+}
+
+void output_stage::set_pwm(int pin, int duty_cycle)
+{
+	// Replace a write to the same pin from earlier in this period
+	for (int i = 0; i < pwm_count; i++)
+	{
+		if (pwm_pins[i] == pin)
+		{
+			pwm_duty[i] = duty_cycle;
+			return;
+		}
+	}
+
+	if (pwm_count >= OUTPUT_STAGE_PINS)
+	{
+		hal_pwm(pin, duty_cycle);
+		return;
+	}
+	pwm_pins[pwm_count] = pin;
+	pwm_duty[pwm_count] = duty_cycle;
+	pwm_count++;
+}
+
+void output_stage::zero_pwm(int pin)
+{
+	for (int i = 0; i < pwm_count; i++)
+	{
+		if (pwm_pins[i] == pin)
+			pwm_duty[i] = 0;
+	}
+}
+
+void output_stage::commit()
+{
+	// Only pins that changed, or that we have never written
+	uint32_t changed = ((desired_levels ^ current_levels) | ~known_mask) & used_mask;
+	uint32_t set_bits = changed & desired_levels;
+	uint32_t clear_bits = changed & ~desired_levels;
+
+	if (set_bits)
+		hal_write_bits_set(set_bits);
+	if (clear_bits)
+		hal_write_bits_clear(clear_bits);
+
+	current_levels = desired_levels;
+	known_mask |= used_mask;
+
+	// Directions are in place, now the duty cycles.
+	for (int i = 0; i < pwm_count; i++)
+		hal_pwm(pwm_pins[i], pwm_duty[i]);
+	pwm_count = 0;
+}
+
+void output_stage::sync()
+{
+	known_mask = 0;
+}
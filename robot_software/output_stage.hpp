@@ -0,0 +1,70 @@
+/* output_stage.hpp
+
+   Created 10/16/2026
+
+   This is the header file for the output_stage class.
+
+   An output_stage collects the direction pin levels and PWM duty cycles
+   that several dc_motors want during one control period, then applies them
+   all at once in commit(). All direction pins go out together with one
+   gpioWrite_Bits_0_31_Set and one gpioWrite_Bits_0_31_Clear, touching only
+   the pins whose level actually changed, so the four direction changes land
+   at the same instant. Direction bits are written before any PWM changes so
+   a motor never briefly drives the wrong way.
+
+   Only GPIO 0-31 (bank 1) can be staged, which covers every pin the robot
+   uses. The stage is meant to be used from one control thread.
+*/
+
+#ifndef __OUTPUT_STAGE_HPP__
+#define __OUTPUT_STAGE_HPP__
+
+#include <stdint.h>
+
+#define OUTPUT_STAGE_PINS 32
+
+class output_stage
+{
+public:
+
+	// Default Constructor
+	output_stage();
+
+	// Stage a level for a direction pin
+	void set_level(int pin, int level);
+
+	// Stage a new duty cycle for a PWM pin
+	void set_pwm(int pin, int duty_cycle);
+
+	// Zero a duty cycle waiting for the next commit, so a motor stopped
+	// straight at the pin is not started again. Control thread only, like
+	// the rest of the stage.
+	void zero_pwm(int pin);
+
+	// Write everything staged since the last commit
+	void commit();
+
+	// Forget what we think the pins are at, so the next commit writes every
+	// staged direction pin. Use this when pins may have been written
+	// elsewhere (e.g. homing).
+	void sync();
+
+private:
+
+	// Direction pins we have been asked to drive
+	uint32_t used_mask;
+
+	// Levels we want, and levels we last wrote
+	uint32_t desired_levels;
+	uint32_t current_levels;
+
+	// Pins whose current level is known
+	uint32_t known_mask;
+
+	// PWM writes waiting for the next commit
+	int pwm_pins[OUTPUT_STAGE_PINS];
+	int pwm_duty[OUTPUT_STAGE_PINS];
+	int pwm_count;
+};
+
+#endif
@@ -0,0 +1,127 @@
+/* path_plan.cpp
+
+   Created 10/16/2026
+
+   Plans a level 1 Y path (see path_planner.hpp) and writes it to a binary
+   trajectory file, or checks the planner against tables exported from
+   MATLAB.
+
+   Usage: ./path_plan <ball height (m)> <output.traj> [cycles]
+          ./path_plan --check <position.txt> <velocity.txt> [ball height (m)]
+
+   Like the exported tables, the path starts after 100 ms at rest and is
+   sampled every millisecond. With no cycles given, the path is the rampup
+   straight into the rampdown (one throw and catch), which is what the
+   y_throw_*_50cm.txt tables hold.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cmath>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "path_planner.hpp"
+#include "trajectory_file.hpp"
+
+#define PLAN_SAMPLE_RATE_HZ 1000
+#define PLAN_LEAD_IN 0.1
+
+// Simulation time csv_path_export.m plans with
+#define PLAN_SIMULATION_TIME 2.0
+
+using namespace std;
+
+// Read one value per line
+static int read_column(string filename, vector<double>& values)
+{
+	ifstream myfile(filename.c_str());
+	if (!myfile.is_open())
+	{
+		cout << filename << " failed to open." << endl;
+		return(1);
+	}
+
+	string line;
+	while (getline(myfile, line))
+	{
+		if (line.empty())
+			continue;
+		values.push_back(atof(line.c_str()));
+	}
+	myfile.close();
+	return(0);
+}
+
+// Largest and RMS difference over the common length
+static void compare(const char* name, const vector<double>& table, const vector<double>& planned)
+{
+	size_t length = (table.size() < planned.size()) ? table.size() : planned.size();
+	double max_error = 0;
+	double sum_squares = 0;
+	size_t max_index = 0;
+	for (size_t i = 0; i < length; i++)
+	{
+		double error = fabs(table[i] - planned[i]);
+		sum_squares += error*error;
+		if (error > max_error)
+		{
+			max_error = error;
+			max_index = i;
+		}
+	}
+	printf("%s: %zu samples, max error %g at %zu ms (table %g, planned %g), rms error %g\n",
+	       name, length, max_error, max_index, table[max_index], planned[max_index],
+	       (length > 0) ? sqrt(sum_squares/length) : 0.0);
+}
+
+int main(int argc, char *argv[])
+{
+	bool check = (argc > 1) && (strcmp(argv[1], "--check") == 0);
+	if ((check && (argc < 4)) || (!check && (argc < 3)))
+	{
+		cout << "Usage: " << argv[0] << " <ball height (m)> <output.traj> [cycles]" << endl;
+		cout << "       " << argv[0] << " --check <position.txt> <velocity.txt> [ball height (m)]" << endl;
+		return 1;
+	}
+
+	planner_params params;
+	if (check && (argc > 4))
+		params.ball_trajectory_height = atof(argv[4]);
+	if (!check)
+		params.ball_trajectory_height = atof(argv[1]);
+
+	level1_plan plan;
+	if (plan_level1(params, PLAN_SIMULATION_TIME, plan))
+		return 1;
+	if (!check && (argc > 3))
+		plan.y.set_cycles(atoi(argv[3]));
+
+	printf("Throw velocity %f m/s, %f s in the air, %d cycles, %f s long\n",
+	       plan.v_throw_y, plan.t_air, plan.y.get_cycles(), plan.y.total_duration());
+
+	vector<double> position;
+	vector<double> velocity;
+	vector<double> acceleration;
+	sample_path(plan.y, PLAN_SAMPLE_RATE_HZ, PLAN_LEAD_IN, plan.y.total_duration(), position, velocity, acceleration);
+
+	if (check)
+	{
+		vector<double> table_position;
+		vector<double> table_velocity;
+		if (read_column(argv[2], table_position) || read_column(argv[3], table_velocity))
+			return 1;
+		compare("Position (m)", table_position, position);
+		compare("Velocity (m/s)", table_velocity, velocity);
+		return 0;
+	}
+
+	if (write_trajectory(argv[2], position.data(), velocity.data(), acceleration.data(),
+	                     position.size(), PLAN_SAMPLE_RATE_HZ, TRAJ_METERS))
+		return 1;
+
+	cout << "Wrote " << position.size() << " samples to " << argv[2] << endl;
+	return 0;
+}
@@ -0,0 +1,482 @@
+/* path_planner.cpp
+
+   Created 10/16/2026
+
+   This is the cpp file holding the function definitions for the level 1
+   path planner. See path_planner.hpp, and path_planning_level1_v10.m for
+   the original.
+*/
+
+#include <stdio.h>
+#include <cmath>
+#include "path_planner.hpp"
+
+using namespace std;
+
+//*****************************************
+// Polynomials
+//*****************************************
+
+poly make_poly(double constant)
+{
+	poly p;
+	for (int i = 0; i < MAX_POLY_COEFFS; i++)
+		p.c[i] = 0;
+	p.c[0] = constant;
+	p.order = 0;
+	return(p);
+}
+
+double poly_eval(const poly& p, double t)
+{
+	// Horner's method
+	double value = p.c[p.order];
+	for (int i = p.order - 1; i >= 0; i--)
+		value = value*t + p.c[i];
+	return(value);
+}
+
+poly poly_integrate(const poly& p, double constant)
+{
+	poly q = make_poly(constant);
+	int order = p.order + 1;
+	if (order >= MAX_POLY_COEFFS)
+	{
+		printf("Polynomial order too high. Truncating.\n");
+		order = MAX_POLY_COEFFS - 1;
+	}
+	for (int i = 1; i <= order; i++)
+		q.c[i] = p.c[i - 1] / i;
+	q.order = order;
+	return(q);
+}
+
+// A constant acceleration period, integrated as the MATLAB does
+path_period constant_acceleration_period(double duration, double d0, double v0, double a)
+{
+	path_period period;
+	period.duration = duration;
+	period.a_poly = make_poly(a);
+	period.v_poly = poly_integrate(period.a_poly, v0);
+	period.d_poly = poly_integrate(period.v_poly, d0);
+	period.j_poly = make_poly(0);
+	return(period);
+}
+
+// Time and acceleration of a constant acceleration move between two
+// positions and velocities. Returns false if the move goes backwards in time.
+static bool solve_period(double d0, double v0, double d1, double v1, double& duration, double& a)
+{
+	if ((v0 + v1) == 0)
+		return(false);
+	duration = 2*(d1 - d0)/(v0 + v1);
+	if (duration <= 0)
+		return(false);
+	a = (v1 - v0)/duration;
+	return(true);
+}
+
+//*****************************************
+// piecewise_path
+//*****************************************
+
+// Default Constructor
+piecewise_path::piecewise_path()
+{
+	cycles = 0;
+	swap_period = 0;
+}
+
+void piecewise_path::add_rampup(const path_period& period)
+{
+	rampup.push_back(period);
+}
+
+void piecewise_path::add_loop(const path_period& period)
+{
+	loop.push_back(period);
+}
+
+void piecewise_path::add_rampdown(const path_period& period)
+{
+	rampdown.push_back(period);
+}
+
+void piecewise_path::set_cycles(int cycles)
+{
+	this->cycles = cycles;
+}
+
+int piecewise_path::get_cycles() const
+{
+	return(cycles);
+}
+
+static double sum_durations(const vector<path_period>& periods)
+{
+	double sum = 0;
+	for (size_t i = 0; i < periods.size(); i++)
+		sum += periods[i].duration;
+	return(sum);
+}
+
+double piecewise_path::rampup_duration() const
+{
+	return(sum_durations(rampup));
+}
+
+double piecewise_path::loop_duration() const
+{
+	return(sum_durations(loop));
+}
+
+double piecewise_path::rampdown_duration() const
+{
+	return(sum_durations(rampdown));
+}
+
+double piecewise_path::total_duration() const
+{
+	return(this->rampup_duration() + cycles*this->loop_duration() + this->rampdown_duration());
+}
+
+path_point piecewise_path::evaluate_periods(const vector<path_period>& periods, double t)
+{
+	path_point point = {0, 0, 0, 0};
+	if (periods.empty())
+		return(point);
+
+	// The first period whose end is at or after t. Rounding can leave t a
+	// hair past the last end, in which case the last period is used.
+	size_t i = 0;
+	double period_start = 0;
+	while ((i + 1 < periods.size()) && (t > period_start + periods[i].duration))
+	{
+		period_start += periods[i].duration;
+		i++;
+	}
+
+	double local_time = t - period_start;
+	point.d = poly_eval(periods[i].d_poly, local_time);
+	point.v = poly_eval(periods[i].v_poly, local_time);
+	point.a = poly_eval(periods[i].a_poly, local_time);
+	point.j = poly_eval(periods[i].j_poly, local_time);
+	return(point);
+}
+
+path_point piecewise_path::evaluate(double t) const
+{
+	double t_rampup = this->rampup_duration();
+	double t_loop = this->loop_duration();
+	double t_rampdown_start = t_rampup + cycles*t_loop;
+
+	if (t <= t_rampup)
+		return(evaluate_periods(rampup, t));
+
+	if (t > t_rampdown_start)
+	{
+		if (t > t_rampdown_start + this->rampdown_duration())
+		{
+			// Simulation is over
+			path_point point = {0, 0, 0, 0};
+			return(point);
+		}
+		return(evaluate_periods(rampdown, t - t_rampdown_start));
+	}
+
+	// Somewhere in the periodic part. t_in_loop = 0 is the start of a loop.
+	return(evaluate_periods(loop, fmod(t - t_rampup, t_loop)));
+}
+
+//*****************************************
+// path_cursor
+//*****************************************
+
+#define CURSOR_RAMPUP 0
+#define CURSOR_LOOP 1
+#define CURSOR_RAMPDOWN 2
+#define CURSOR_DONE 3
+
+// Default Constructor
+path_cursor::path_cursor()
+{
+	repeat = false;
+	this->set_path(NULL);
+}
+
+// Constructor
+path_cursor::path_cursor(const piecewise_path* path)
+{
+	repeat = false;
+	this->set_path(path);
+}
+
+void path_cursor::set_path(const piecewise_path* path)
+{
+	this->path = path;
+	next = NULL;
+	this->reset();
+}
+
+const piecewise_path* path_cursor::get_path() const
+{
+	return(path);
+}
+
+void path_cursor::reset()
+{
+	piece = CURSOR_RAMPUP;
+	cycle = 0;
+	index = 0;
+	period_start = 0;
+	finishing = false;
+
+	// Skip over empty pieces
+	if (path && periods()->empty())
+		this->advance();
+}
+
+void path_cursor::set_repeat(bool forever)
+{
+	repeat = forever;
+}
+
+void path_cursor::stage(const piecewise_path* next)
+{
+	this->next = next;
+}
+
+const piecewise_path* path_cursor::get_staged() const
+{
+	return(next);
+}
+
+void path_cursor::finish()
+{
+	finishing = true;
+}
+
+uint32_t path_cursor::cycles_started() const
+{
+	if (piece == CURSOR_RAMPUP)
+		return(0);
+	if (piece == CURSOR_LOOP)
+		return(cycle + 1);
+	return(cycle);
+}
+
+// Whether to play (another) loop cycle
+static bool play_loop(const piecewise_path* path, int cycle, bool repeat, bool finishing)
+{
+	if (finishing || path->loop.empty())
+		return(false);
+	return(repeat || (cycle < path->get_cycles()));
+}
+
+const vector<path_period>* path_cursor::periods()
+{
+	switch (piece)
+	{
+		case CURSOR_RAMPUP: return(&path->rampup);
+		case CURSOR_LOOP: return(&path->loop);
+		default: return(&path->rampdown);
+	}
+}
+
+bool path_cursor::advance()
+{
+	if (piece == CURSOR_DONE)
+		return(false);
+
+	// Step past the current period, if there is one.
+	if (index < periods()->size())
+	{
+		period_start += (*periods())[index].duration;
+		index++;
+	}
+
+	// Roll over into the next cycle or piece until we land on a period.
+	while (index >= periods()->size())
+	{
+		index = 0;
+		if ((piece == CURSOR_LOOP) && play_loop(path, ++cycle, repeat, finishing))
+			continue;
+
+		piece++;
+		if ((piece == CURSOR_LOOP) && !play_loop(path, 0, repeat, finishing))
+			piece++;
+		if (piece == CURSOR_DONE)
+			return(false);
+	}
+
+	// Swap in a staged path where both are in the same state.
+	if (next && (piece == CURSOR_LOOP) && ((int) index == path->swap_period))
+	{
+		path = next;
+		next = NULL;
+		index = path->swap_period;
+	}
+	return(true);
+}
+
+bool path_cursor::evaluate(double t, path_point& point)
+{
+	if (!path)
+		return(false);
+
+	if (t < period_start)
+		this->reset();
+
+	while ((piece != CURSOR_DONE) && (t > period_start + (*periods())[index].duration))
+	{
+		if (!(this->advance()))
+			break;
+	}
+
+	if (piece == CURSOR_DONE)
+		return(false);
+
+	const path_period& period = (*periods())[index];
+	double local_time = t - period_start;
+	point.d = poly_eval(period.d_poly, local_time);
+	point.v = poly_eval(period.v_poly, local_time);
+	point.a = poly_eval(period.a_poly, local_time);
+	point.j = poly_eval(period.j_poly, local_time);
+	return(true);
+}
+
+//*****************************************
+// Level 1 planner
+//*****************************************
+
+// Defaults from path_planning_level1_v10.m
+planner_params::planner_params()
+{
+	workspace_width = 0.4;
+	workspace_height = 0.4;
+	workspace_gap = 0.1;
+	ball_trajectory_height = 0.5;
+	throw_height = (3*workspace_height)/4;
+	catch_throw_time = 1;
+}
+
+int plan_level1(const planner_params& params, double simulation_time, level1_plan& plan)
+{
+	plan = level1_plan();
+
+	// Calculate trajectory of ball based on inputs. X stays put at the
+	// center of the workspace, a third of the width from the throw edge.
+	double tc_edge_offset = (1.0/3)*params.workspace_width;
+	double v_throw_y = sqrt(2 * GRAVITY * params.ball_trajectory_height);
+	double t_air = (2 * v_throw_y)/GRAVITY;
+	plan.v_throw_y = v_throw_y;
+	plan.t_air = t_air;
+	plan.v_throw_x = (tc_edge_offset + params.workspace_gap + (params.workspace_width - tc_edge_offset))/t_air;
+
+	// Compute workspace data
+	plan.workspace1[0] = params.workspace_gap/2;
+	plan.workspace1[1] = params.workspace_gap/2 + params.workspace_width;
+	plan.workspace1[2] = 0;
+	plan.workspace1[3] = params.workspace_height;
+	plan.workspace2[0] = -params.workspace_gap/2 - params.workspace_width;
+	plan.workspace2[1] = -params.workspace_gap/2;
+	plan.workspace2[2] = 0;
+	plan.workspace2[3] = params.workspace_height;
+
+	double d_throw = params.throw_height;
+	double d_top = params.workspace_height;
+	double d_bottom = 0;
+
+	if ((d_throw <= d_bottom) || (d_throw >= d_top))
+	{
+		printf("Throw height must be inside the workspace. Aborting.\n");
+		return(1);
+	}
+
+	// X Path Planning: X does not move, so it is one long rampup period.
+	double hand1_home_x = plan.workspace1[1] - 0.5*params.workspace_width;
+	plan.x.add_rampup(constant_acceleration_period(simulation_time, hand1_home_x, 0, 0));
+
+	// Ramp-up: one phase of constant acceleration from rest at the bottom
+	// to the throw. v_f^2 = v_0^2 + 2*a*d
+	double a_ramp = (v_throw_y*v_throw_y)/(2*d_throw);
+	double t_ramp = v_throw_y/a_ramp;
+	plan.y.add_rampup(constant_acceleration_period(t_ramp, d_bottom, 0, a_ramp));
+
+	// Throw-Catch (Periods I, II, III): up to rest at the top, wait, and
+	// come back down to meet the ball at the throw height.
+	double t0, t1, t2, a0, a2;
+	if (!solve_period(d_throw, v_throw_y, d_top, 0, t0, a0) ||
+	    !solve_period(d_top, 0, d_throw, -v_throw_y, t2, a2))
+	{
+		printf("Throw-catch periods have no solution. Aborting.\n");
+		return(1);
+	}
+	t1 = t_air - t0 - t2;
+	if (t1 < 0)
+	{
+		printf("Ball is not in the air long enough to reach the top. Aborting.\n");
+		return(1);
+	}
+	plan.y.add_loop(constant_acceleration_period(t0, d_throw, v_throw_y, a0));
+	plan.y.add_loop(constant_acceleration_period(t1, d_top, 0, 0));
+	plan.y.add_loop(constant_acceleration_period(t2, d_top, 0, a2));
+
+	// Catch-Throw (Periods IV, V, VI): down to rest at the bottom, wait,
+	// and come back up to the throw.
+	double ctt0, ctt1, ctt2, cta0, cta2;
+	if (!solve_period(d_throw, -v_throw_y, d_bottom, 0, ctt0, cta0) ||
+	    !solve_period(d_bottom, 0, d_throw, v_throw_y, ctt2, cta2))
+	{
+		printf("Catch-throw periods have no solution. Aborting.\n");
+		return(1);
+	}
+	ctt1 = params.catch_throw_time - ctt0 - ctt2;
+	if (ctt1 < 0)
+	{
+		printf("Catch-throw time is too short. Aborting.\n");
+		return(1);
+	}
+	plan.y.add_loop(constant_acceleration_period(ctt0, d_throw, -v_throw_y, cta0));
+	plan.y.add_loop(constant_acceleration_period(ctt1, d_bottom, 0, 0));
+	plan.y.add_loop(constant_acceleration_period(ctt2, d_bottom, 0, cta2));
+
+	// Ramp-down (I, II, III, IV): the same as the first four loop periods,
+	// ending at rest at the bottom.
+	for (int i = 0; i < 4; i++)
+		plan.y.add_rampdown(plan.y.loop[i]);
+
+	// Every Y path is at rest at the bottom at the start of period V, so
+	// that is where one path can take over from another.
+	plan.y.swap_period = 4;
+
+	// Calculate the number of cycles to run. The MATLAB counts the whole
+	// loop as the rampdown time here; kept so the cycle counts match.
+	double t_loop = plan.y.loop_duration();
+	double t_overhead = plan.y.rampup_duration() + t_loop;
+	int cycles = (int) floor((simulation_time - t_overhead)/t_loop);
+	if (cycles < 0)
+		cycles = 1;
+	plan.y.set_cycles(cycles);
+	return(0);
+}
+
+void sample_path(const piecewise_path& path, double sample_rate_hz, double lead_in, double duration,
+                 vector<double>& position, vector<double>& velocity, vector<double>& acceleration)
+{
+	// Same as t_initial:resolution:t_final, so both ends are included.
+	int lead_samples = (int) round(lead_in*sample_rate_hz);
+	int samples = (int) round((lead_in + duration)*sample_rate_hz) + 1;
+
+	position.assign(samples, 0);
+	velocity.assign(samples, 0);
+	acceleration.assign(samples, 0);
+
+	for (int i = lead_samples; i < samples; i++)
+	{
+		path_point point = path.evaluate((i - lead_samples)/sample_rate_hz);
+		position[i] = point.d;
+		velocity[i] = point.v;
+		acceleration[i] = point.a;
+	}
+}
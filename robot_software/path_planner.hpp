@@ -0,0 +1,226 @@
+/* path_planner.hpp
+
+   Created 10/16/2026
+
+   This is the header file for the level 1 path planner. It is a port of
+   path_planning_level1_v10.m, arm1path_level1_v10.m and pp_data_class.m
+   from path_planning/, so paths can be planned on the robot at startup
+   instead of exported from MATLAB.
+
+   A path is piecewise: a rampup, a loop that repeats a number of cycles,
+   and a rampdown. Each piece is a list of periods, and each period has a
+   duration and polynomials for distance, velocity, acceleration and jerk
+   in local time (every period starts at t = 0), exactly as in
+   pp_data_class.
+
+   The level 1 planner is a bang-bang acceleration profile:
+       Rampup:     accelerate from rest at the bottom to the throw
+       Loop I:     throw point to rest at the top
+       Loop II:    rest at the top while the ball is in the air
+       Loop III:   top down to the catch at -v_throw
+       Loop IV:    catch to rest at the bottom
+       Loop V:     rest at the bottom
+       Loop VI:    bottom up to the throw
+       Rampdown:   loop I to IV
+   MATLAB solves the throw-catch and catch-throw systems with fsolve. Each
+   constant acceleration period is fixed by its end positions and
+   velocities (t = 2*(d1 - d0)/(v0 + v1), a = (v1 - v0)/t), so here they
+   are solved in closed form. The result is the same solution fsolve
+   converges to.
+*/
+
+#ifndef __PATH_PLANNER_HPP__
+#define __PATH_PLANNER_HPP__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+// Highest polynomial order kept for a period
+#define MAX_POLY_COEFFS 6
+
+#define GRAVITY 9.81
+
+// A polynomial, lowest order first: c[0] + c[1]*t + c[2]*t^2 ...
+struct poly {
+	double c[MAX_POLY_COEFFS];
+	int order;
+};
+
+// Constant polynomial
+poly make_poly(double constant);
+
+// polyval
+double poly_eval(const poly& p, double t);
+
+// polyint with a constant of integration
+poly poly_integrate(const poly& p, double constant);
+
+// One period of a piecewise path
+struct path_period {
+	double duration;
+	poly d_poly;
+	poly v_poly;
+	poly a_poly;
+	poly j_poly;
+};
+
+// A period of constant acceleration a starting at d0, v0. Use a = 0 and
+// v0 = 0 for a rest.
+path_period constant_acceleration_period(double duration, double d0, double v0, double a);
+
+// Distance, velocity, acceleration and jerk at one time
+struct path_point {
+	double d;
+	double v;
+	double a;
+	double j;
+};
+
+// Rampup, loop and rampdown for one hand and direction (pp_data_class)
+class piecewise_path
+{
+public:
+
+	// Default Constructor
+	piecewise_path();
+
+	void add_rampup(const path_period& period);
+	void add_loop(const path_period& period);
+	void add_rampdown(const path_period& period);
+	void set_cycles(int cycles);
+
+	int get_cycles() const;
+	double rampup_duration() const;
+	double loop_duration() const;
+	double rampdown_duration() const;
+
+	// Rampup, cycles of the loop and rampdown
+	double total_duration() const;
+
+	// Evaluate at time t like arm1path_level1_v10.m. Past the end of the
+	// rampdown everything is zero.
+	path_point evaluate(double t) const;
+
+	std::vector<path_period> rampup;
+	std::vector<path_period> loop;
+	std::vector<path_period> rampdown;
+
+	// Loop period a path_cursor may switch to a new path at (see
+	// path_cursor::stage). Every path swapped in and out at it must be in
+	// the same state at its start. 0, the start of the loop, by default.
+	int swap_period;
+
+private:
+
+	// Find the period holding local time t and evaluate it
+	static path_point evaluate_periods(const std::vector<path_period>& periods, double t);
+
+	int cycles;
+};
+
+// Evaluates a piecewise_path at any time, for use in a control loop.
+// Remembers which period it was in last time, so evaluating at increasing
+// times (every control period) only ever steps forward to the next period
+// and costs a few multiply-adds regardless of how long the path is. Going
+// back in time starts the search over from the beginning.
+//
+// For streaming, the cursor can repeat the loop forever instead of the
+// path's cycle count, until finish() sends it on to the rampdown at the
+// end of the current cycle. A new path can be staged to take over at the
+// next swap period of the loop, keeping the time line and cycle count.
+class path_cursor
+{
+public:
+
+	// Default Constructor
+	path_cursor();
+
+	// Constructor
+	path_cursor(const piecewise_path* path);
+
+	// Point at a new path (NULL for none) and go back to the start.
+	void set_path(const piecewise_path* path);
+	const piecewise_path* get_path() const;
+
+	// Go back to the start of the path
+	void reset();
+
+	// Repeat the loop until finish() instead of the path's cycle count
+	void set_repeat(bool forever);
+
+	// Go to the rampdown at the end of the current loop cycle (or straight
+	// from the rampup if the loop has not started yet).
+	void finish();
+
+	// Switch to next when the loop reaches the current path's swap period
+	// and carry on from next's swap period. next needs a loop longer than
+	// its swap period. Cleared by set_path().
+	void stage(const piecewise_path* next);
+	const piecewise_path* get_staged() const;
+
+	// Number of loop cycles started since reset()
+	uint32_t cycles_started() const;
+
+	// Evaluate at t seconds from the start of the path. Returns false once
+	// t is past the end of the rampdown.
+	bool evaluate(double t, path_point& point);
+
+private:
+
+	// Move to the next period. Returns false at the end of the path.
+	bool advance();
+
+	// Periods of the current piece
+	const std::vector<path_period>* periods();
+
+	const piecewise_path* path;
+	const piecewise_path* next;
+
+	// 0 rampup, 1 loop, 2 rampdown, 3 done
+	int piece;
+	int cycle;
+	size_t index;
+
+	bool repeat;
+	bool finishing;
+
+	// Start time of the current period
+	double period_start;
+};
+
+// Inputs to the level 1 planner. Defaults match path_planning_level1_v10.m.
+struct planner_params {
+	double workspace_width;        // m
+	double workspace_height;       // m
+	double workspace_gap;          // m
+	double ball_trajectory_height; // m, above the throw point
+	double throw_height;           // m, d_throw_y
+	double catch_throw_time;       // s, t_ct
+
+	planner_params();
+};
+
+// Output of the level 1 planner for hand 1
+struct level1_plan {
+	piecewise_path x;
+	piecewise_path y;
+	double workspace1[4]; // min x, max x, min y, max y
+	double workspace2[4];
+	double v_throw_x;
+	double v_throw_y;
+	double t_air;
+};
+
+// Plan level 1 (path_planning_level1_v10.m). cycles is calculated from
+// simulation_time as the MATLAB does. Returns 0 on success, 1 if the
+// throw does not fit in the workspace.
+int plan_level1(const planner_params& params, double simulation_time, level1_plan& plan);
+
+// Sample a path into fixed rate tables, as csv_path_export.m does. The
+// tables start with lead_in seconds of zeros and cover duration seconds
+// of the path after that.
+void sample_path(const piecewise_path& path, double sample_rate_hz, double lead_in, double duration,
+                 std::vector<double>& position, std::vector<double>& velocity, std::vector<double>& acceleration);
+
+#endif
@@ -0,0 +1,72 @@
+/* path_slot.cpp
+
+   Created 10/16/2026
+
+   This is the cpp file holding the function definitions for the path_slot
+   class. See path_slot.hpp.
+*/
+
+#include <stdio.h>
+#include "path_slot.hpp"
+
+using namespace std;
+
+// Default Constructor
+path_slot::path_slot()
+{
+	active.store(-1);
+	staged.store(-1);
+}
+
+bool path_slot::stage(const piecewise_path& path)
+{
+	if (staged.load(memory_order_acquire) >= 0)
+		return(false);
+
+	if ((int) path.loop.size() <= path.swap_period)
+	{
+		printf("Path has no loop period to swap in at. Not staged.\n");
+		return(false);
+	}
+
+	// With nothing staged, active only changes when we stage, so the
+	// other buffer is free.
+	int free_buffer = (active.load(memory_order_acquire) == 0) ? 1 : 0;
+	buffers[free_buffer] = path;
+	staged.store(free_buffer, memory_order_release);
+	return(true);
+}
+
+bool path_slot::pending() const
+{
+	return(staged.load(memory_order_acquire) >= 0);
+}
+
+void path_slot::service(path_cursor& cursor)
+{
+	int next = staged.load(memory_order_acquire);
+	if (next < 0)
+		return;
+
+	// The cursor switched at its swap point. The old buffer is free now.
+	if (cursor.get_path() == &buffers[next])
+	{
+		active.store(next, memory_order_release);
+		staged.store(-1, memory_order_release);
+		return;
+	}
+
+	if (cursor.get_staged() != &buffers[next])
+		cursor.stage(&buffers[next]);
+}
+
+void path_slot::apply_now(path_cursor& cursor)
+{
+	int next = staged.load(memory_order_acquire);
+	if (next < 0)
+		return;
+
+	cursor.set_path(&buffers[next]);
+	active.store(next, memory_order_release);
+	staged.store(-1, memory_order_release);
+}
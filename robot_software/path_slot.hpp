@@ -0,0 +1,67 @@
+/* path_slot.hpp
+
+   Created 10/16/2026
+
+   This is the header file for the path_slot class.
+
+   A path_slot lets a new planned path be handed to a motor while it is
+   running. It holds two path buffers. The motor plays from one while
+   another thread stages the next path into the other with stage(). The
+   control thread picks the staged path up with service(), and the motor's
+   path_cursor switches to it at the loop's next swap point (see
+   piecewise_path::swap_period), so the change lands where the old and the
+   new path are in the same state.
+
+   The control thread never waits: service() is one atomic load when
+   nothing is staged. The staging side copies the path into the free
+   buffer and publishes it. It cannot stage again until the motor has
+   switched over, because until then the free buffer is the one that was
+   just staged. stage() returns false in that case; try again after the
+   swap point. Only one thread may stage at a time.
+*/
+
+#ifndef __PATH_SLOT_HPP__
+#define __PATH_SLOT_HPP__
+
+#include <atomic>
+#include "path_planner.hpp"
+
+class path_slot
+{
+public:
+
+	// Default Constructor
+	path_slot();
+
+	// STAGING THREAD: Copy path into the free buffer and hand it to the
+	// motor. Returns false if the previous path has not been picked up,
+	// or if the path cannot be swapped in (no loop past the swap point).
+	bool stage(const piecewise_path& path);
+
+	// STAGING THREAD: True while a staged path is waiting for its swap point
+	bool pending() const;
+
+	// CONTROL THREAD: Pass a staged path on to the cursor, and notice when
+	// the cursor has switched to it. Call every control period.
+	void service(path_cursor& cursor);
+
+	// CONTROL THREAD: Between runs, switch the cursor to a staged path
+	// right away.
+	void apply_now(path_cursor& cursor);
+
+private:
+
+	piecewise_path buffers[2];
+
+	// Buffer the cursor plays from, -1 if it plays a path from elsewhere
+	std::atomic<int> active;
+
+	// Buffer staged for the cursor, -1 if none
+	std::atomic<int> staged;
+
+	// Disable default copy constructor and assignment operator
+	path_slot(const path_slot&);
+	path_slot& operator=(const path_slot&);
+};
+
+#endif
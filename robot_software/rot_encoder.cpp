@@ -12,8 +12,10 @@
 */
 
 #include <iostream>
-#include <pigpio.h>
+#include "hal.hpp"
 #include "rot_encoder.hpp"
+#include "mono_clock.hpp"
+#include "event_log.hpp"
 
 using namespace std;
 
@@ -28,6 +30,9 @@ rot_encoder::rot_encoder()
 	a_level = 0;
 	b_level = 0;
 	last_pin_change = -1;
+	recorder = NULL;
+	recorder_axis = 0;
+	cps.store(0);
 }
 
 // Constructor
@@ -40,37 +45,38 @@ rot_encoder::rot_encoder(int aPin, int bPin, int zPin, int velocity_points)
 	a_level = 0;
 	b_level = 0;
 	last_pin_change = -1;
+	recorder = NULL;
+	recorder_axis = 0;
 	deque_width = velocity_points;
 
-	// Initialize the deque mutex
-	pthread_mutex_init(&deque_lock, NULL);
-
-	// Initialize deques for time and position
-	deque<int> count_init (deque_width, 0);
-	count_deque = count_init;
-	deque<uint32_t> time_init (deque_width, 0);
-	time_deque = time_init;
+	// The velocity fit only holds so many points.
+	if (deque_width > MAX_VELOCITY_POINTS)
+	{
+		cout << "Too many velocity points. Using " << MAX_VELOCITY_POINTS << " instead." << endl;
+		deque_width = MAX_VELOCITY_POINTS;
+	}
+	velocity_fit = lsq_velocity(deque_width);
+	cps.store(0);
 
 	// Set encoder pins as inputs
-	gpioSetMode(a_pin, PI_INPUT);
-	gpioSetMode(b_pin, PI_INPUT);
-	gpioSetMode(z_pin, PI_INPUT);
+	hal_set_mode(a_pin, HAL_INPUT);
+	hal_set_mode(b_pin, HAL_INPUT);
+	hal_set_mode(z_pin, HAL_INPUT);
 
 	// Set pull-up resistors
-    gpioSetPullUpDown(a_pin, PI_PUD_UP);
-    gpioSetPullUpDown(b_pin, PI_PUD_UP);
-    gpioSetPullUpDown(z_pin, PI_PUD_UP);
+    hal_set_pull(a_pin, HAL_PUD_UP);
+    hal_set_pull(b_pin, HAL_PUD_UP);
+    hal_set_pull(z_pin, HAL_PUD_UP);
 
     // Monitor pin level changes and launch _static_pulse
     // with arguments GPIO pin, new level, tick, and pointer to user data
-    gpioSetAlertFuncEx(a_pin, _static_pulse, this);
-    gpioSetAlertFuncEx(b_pin, _static_pulse, this);
+    hal_set_alert(a_pin, _static_pulse, this);
+    hal_set_alert(b_pin, _static_pulse, this);
 }
 
 // Destructor
 rot_encoder::~rot_encoder()
 {
-	pthread_mutex_destroy(&deque_lock);
 	this->deactivate();
 }
 
@@ -78,8 +84,17 @@ rot_encoder::~rot_encoder()
 void rot_encoder::_static_pulse(int gpio_caller, int level, uint32_t tick, void *userdata)
 {
 	rot_encoder *Self = (rot_encoder *) userdata;
-	// Send to non-static pulse function
+	event_recorder* recorder = Self->recorder;
+	if (!recorder)
+	{
+		// Send to non-static pulse function
+		Self->_pulse(gpio_caller, level, tick);
+		return;
+	}
+
+	recorder->begin_alert();
 	Self->_pulse(gpio_caller, level, tick);
+	recorder->end_alert(EVENT_ENCODER, gpio_caller, level, Self->recorder_axis, tick);
 }
 
 // Pulse Function
@@ -102,17 +117,9 @@ void rot_encoder::_pulse(int gpio_caller, int level, uint32_t tick)
 			++pulse_count;
 			//cout << "Encoder Count: " << pulse_count << endl;
 
-			// Get Mutex, Add in new point at back, remove front point.
-			{
-			        pthread_mutex_lock(&deque_lock);
-				count_deque.push_back((int) pulse_count);
-				time_deque.push_back(tick);
-				count_deque.pop_front();
-				time_deque.pop_front();
-			        pthread_mutex_unlock(&deque_lock);
-				return;
-			}
-			
+			// Add in new point and update the velocity. Never blocks.
+			this->_add_edge(mono_extend(tick));
+			return;
 		}
 
 		// Arm is going down
@@ -122,21 +129,21 @@ void rot_encoder::_pulse(int gpio_caller, int level, uint32_t tick)
 			--pulse_count;
 			//cout << "Encoder Count: " << pulse_count << endl;
 
-			// Get Mutex, Add in new point at back, remove front point.
-			{
-			    
-			        pthread_mutex_lock(&deque_lock);
-				count_deque.push_back((int) pulse_count);
-				time_deque.push_back(tick);
-				count_deque.pop_front();
-				time_deque.pop_front();
-			        pthread_mutex_unlock(&deque_lock);
-				return;
-			}
+			// Add in new point and update the velocity. Never blocks.
+			this->_add_edge(mono_extend(tick));
+			return;
 		}
 	}
 }
 
+// Update the velocity fit with a counted edge.
+void rot_encoder::_add_edge(uint64_t tick)
+{
+	velocity_fit.add_point(tick, pulse_count);
+	// Multiply slope by conversion factor to get counts per second.
+	cps.store(velocity_fit.slope() * 1000000, std::memory_order_release);
+}
+
 // Index Static pulse function
 void rot_encoder::z_static_pulse(int gpio_caller, int level, uint32_t tick, void *userdata)
 {
@@ -156,94 +163,12 @@ void rot_encoder::z_pulse(int gpio_caller, int level, uint32_t tick)
 	}
 }
 
-// Return current speed
+// Return current speed. The least squares fit is kept up to date by the
+// alert callback, so this is constant time no matter how many points are
+// in the window.
 double rot_encoder::getCPS()
 {
-	// Get Mutex, make local copies of deque. 
-	// Make local copies of the deques, so that it doesnt
-	// get overwritten while the function is processing. 
-	deque<int> local_count;
-	deque<uint32_t> local_time;
-
-	{
-	    pthread_mutex_lock(&deque_lock);
-		local_count = count_deque;
-		local_time = time_deque;
-	    pthread_mutex_unlock(&deque_lock);
-	}
-
-	if ((((int) local_time.size()) != deque_width) || (((int) local_count.size()) != deque_width))
-	{
-		cout << "Corrupted Deque. Returning zero velocity." << endl;
-		return(0);
-	} 
-
-    // Update with most recent time point...
-//	local_count.push_back((int) pulse_count);
-//	local_time.push_back(gpioTick());
-//	local_count.pop_front();
-//	local_time.pop_front();
-
-	//cout << "Current Time Deque: ";
-	//for(int i = 0; i < deque_width; i++)
-	//{
-//		cout << local_time[i] << " ";
-//	}
-
-//	cout << "Current Count Deque: ";
-//	for(int i = 0; i < deque_width; i++)
-//	{
-//		cout << local_count[i] << " ";
-//	}
-
-	// Least Squares:
-	double xsum = 0;
-	double ysum = 0;
-	double xxsum = 0;
-	double xysum = 0;
-	for(int i = 0; i < deque_width; i++)
-	{
-		xsum += ( (double) local_time[i]);
-		ysum += ((double) local_count[i]);
-		xxsum += (( (double) (local_time[i]))  * ( (double) local_time[i]));
-		xysum += (((double) local_time[i]) * ((double) local_count[i]));
-	}
-
-	double denom = ((deque_width * xxsum) - (xsum * xsum));
-
-	if (denom == 0)
-	{
-		cout << "Singular Matrix. Returning Zero velocity" << endl;
-		return(0);
-	}
-	
-//	cout << "xsum: " << xsum << endl;
-//	cout << "ysum: " << ysum << endl;
-//	cout << "xxsum: " << xxsum << endl;
-//	cout << "xysum: " << xysum << endl;
-
-	double slope = ((deque_width * xysum) - (xsum * ysum)) / denom;
-
-    // Multiply slope by conversion factor to get counts per second. Return counts per second. 
-	return(slope * 1000000);
-
-	
-	// DO LEAST SQUARES HERE....
-	// For now I will subtract fifth from first item in the deque
-	//double delta_count = local_count.back() - local_count.front();
-
-	// Convert delta_count to revolutions
-	//delta_count /= 1024;
-
-	//double delta_time = local_time.back() - local_time.front();
-	
-	//if (delta_time == 0)
-	//	return 0;
-
-	// Convert delta_time to minutes...
-	//delta_time /= 60000000;
-
-	//return (delta_count / delta_time);
+	return(cps.load(std::memory_order_acquire));
 }
 
 // Release resources taken up by enocder
@@ -251,8 +176,8 @@ double rot_encoder::getCPS()
 void rot_encoder::deactivate()
 {
 	// Remove alert functions from 
-	gpioSetAlertFuncEx(a_pin, NULL, this);
-    gpioSetAlertFuncEx(b_pin, NULL, this);
+	hal_set_alert(a_pin, NULL, this);
+    hal_set_alert(b_pin, NULL, this);
 }
 
 int rot_encoder::getCount()
@@ -263,15 +188,32 @@ int rot_encoder::getCount()
 void rot_encoder::testEncoder()
 {
 	cout << "Activating encoder test..." << endl;
-	gpioSetAlertFuncEx(a_pin, z_static_pulse, this);
-	gpioSleep(PI_TIME_RELATIVE, 20, 0);
+	hal_set_alert(a_pin, z_static_pulse, this);
+	hal_sleep(20, 0);
 	cout << "Encoder test concluded." << endl;
-	gpioSetAlertFuncEx(a_pin, 0, this);
+	hal_set_alert(a_pin, 0, this);
 }
 
 void rot_encoder::resetCount()
 {
+	if (!recorder)
+	{
+		pulse_count = 0;
+		return;
+	}
+
+	// The replay resets after the alerts that came before this.
+	uint32_t before = recorder->alert_sequence();
 	pulse_count = 0;
+	recorder->record_reset(recorder_axis, before, recorder->alert_sequence_after());
+}
+
+void rot_encoder::set_recorder(event_recorder* recorder, int axis)
+{
+	recorder_axis = axis;
+	if (recorder)
+		recorder->record_setup(axis, a_pin, b_pin, z_pin, deque_width);
+	this->recorder = recorder;
 }
 
 
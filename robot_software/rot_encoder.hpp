@@ -14,8 +14,11 @@
 #ifndef __ROT_ENCODER_HPP__
 #define __ROT_ENCDOER_HPP__
 
-#include <pthread.h>
-#include <deque>
+#include <stdint.h>
+#include <atomic>
+#include "lsq_velocity.hpp"
+
+class event_recorder;
 
 
 class rot_encoder
@@ -31,12 +34,12 @@ public:
 	// How many samples to save in memory
 	int deque_width;
 
-	// Mutex to ensure exclusive acess to the deques
-	pthread_mutex_t deque_lock;
+	// Incremental least squares fit over the newest deque_width edges.
+	// Only touched by the alert callback.
+	lsq_velocity velocity_fit;
 
-    // queue to hold count and timestamp history for velocity calculation
-	std::deque<int> count_deque;
-	std::deque<uint32_t> time_deque;
+	// Latest velocity from velocity_fit, in counts per second.
+	std::atomic<double> cps;
 
 	// Encoder input pin numbers
 	int a_pin;
@@ -50,6 +53,11 @@ public:
 	// Variable to hold last GPIO which changed (to debounce)
 	volatile int last_pin_change;
 
+	// Event log for the alerts and count resets (event_log.hpp), or NULL,
+	// and the axis they are logged under
+	event_recorder* recorder;
+	int recorder_axis;
+
 	// PUBLIC FUNCTIONS
 	
 	// Default Constructor
@@ -86,9 +94,16 @@ public:
     // Sets the count to be zero
     void resetCount();
 
+    // Log every alert and count reset to recorder as axis. Call before
+    // the encoder moves.
+    void set_recorder(event_recorder* recorder, int axis);
+
 private:
 
 	// PRIVATE FUNCTIONS
+	// Add a counted edge to the velocity fit
+	void _add_edge(uint64_t tick);
+
 	// Disable default copy constructor, and move constructor
 	rot_encoder(const rot_encoder&);
 	rot_encoder& operator=(const rot_encoder&);
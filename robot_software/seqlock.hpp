@@ -0,0 +1,92 @@
+/* seqlock.hpp
+
+   Created 10/16/2026
+
+   This is the header file for the seqlock class template.
+
+   A seqlock holds the latest value of something written by exactly one
+   thread and read by any number of others. The writer never waits: it
+   bumps the sequence to odd, stores the value and bumps it back to even.
+   A reader copies the value between two reads of the sequence and tries
+   again if the writer was in the middle of a store. Readers never stop
+   the writer, and a reader only retries if the writer stored during its
+   copy, which for small values and a writer that stores a few hundred
+   times a second is almost never.
+
+   The value is kept as 64 bit atomic words so a reader copying during a
+   store is well defined (it just throws the copy away). T must be
+   trivially copyable.
+*/
+
+#ifndef __SEQLOCK_HPP__
+#define __SEQLOCK_HPP__
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include "cache_line.hpp"
+
+template <typename T>
+class seqlock
+{
+public:
+
+	// Default Constructor
+	seqlock()
+	{
+		sequence.store(0, std::memory_order_relaxed);
+		for (unsigned i = 0; i < WORDS; i++)
+			words[i].store(0, std::memory_order_relaxed);
+	}
+
+	// WRITER ONLY: Replace the value.
+	void write(const T& value)
+	{
+		uint64_t staging[WORDS] = {0};
+		memcpy(staging, &value, sizeof(T));
+
+		uint32_t s = sequence.load(std::memory_order_relaxed);
+		sequence.store(s + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		for (unsigned i = 0; i < WORDS; i++)
+			words[i].store(staging[i], std::memory_order_relaxed);
+		sequence.store(s + 2, std::memory_order_release);
+	}
+
+	// Copy out the value. Returns the number of writes so far, 0 if it
+	// has never been written.
+	uint32_t read(T& value) const
+	{
+		uint64_t staging[WORDS];
+		uint32_t before, after;
+		do
+		{
+			before = sequence.load(std::memory_order_acquire);
+			while (before & 1)
+				before = sequence.load(std::memory_order_acquire);
+
+			for (unsigned i = 0; i < WORDS; i++)
+				staging[i] = words[i].load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			after = sequence.load(std::memory_order_relaxed);
+		} while (before != after);
+
+		memcpy(&value, staging, sizeof(T));
+		return(before/2);
+	}
+
+	// Number of writes so far, without copying the value
+	uint32_t writes() const
+	{
+		return(sequence.load(std::memory_order_acquire)/2);
+	}
+
+private:
+
+	static const unsigned WORDS = (sizeof(T) + 7)/8;
+
+	alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> sequence;
+	std::atomic<uint64_t> words[WORDS];
+};
+
+#endif
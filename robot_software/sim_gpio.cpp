@@ -0,0 +1,397 @@
+/* sim_gpio.cpp
+
+   Created 10/16/2026
+
+   This is the cpp file for the simulated GPIO backend. See sim_gpio.hpp.
+*/
+
+#include <stdio.h>
+#include <time.h>
+#include <errno.h>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
+#include "sim_gpio.hpp"
+
+using namespace std;
+
+struct sim_pin {
+	atomic<int> level;
+	atomic<int> mode;
+	atomic<int> duty_cycle;
+	atomic<int> frequency;
+	sim_alert_func alert;
+	void *alert_data;
+};
+
+struct sim_timer {
+	sim_timer_func func;
+	void *userdata;
+	uint64_t period;
+	uint64_t next;
+};
+
+struct sim_hook {
+	sim_step_func func;
+	void *userdata;
+};
+
+static sim_pin pins[SIM_GPIO_PINS];
+static sim_timer timers[SIM_TIMERS];
+static sim_hook hooks[SIM_STEP_HOOKS];
+
+static atomic<uint64_t> clock_now(SIM_START_TICK);
+static uint32_t step_us = SIM_STEP_US;
+
+// Serialises stepping, alerts, hooks and timers. Recursive, since an
+// alert or hook may well write a pin itself.
+static recursive_mutex sim_lock;
+
+// Sleepers wait here while the clock is running
+static mutex wait_lock;
+static condition_variable clock_moved;
+
+static atomic<bool> running(false);
+static atomic<bool> stop_running(false);
+static pthread_t runner;
+static double run_speed = 1.0;
+
+static int64_t real_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return(((int64_t) ts.tv_sec) * 1000000000LL + ts.tv_nsec);
+}
+
+// Change a pin level, calling its alert on a change
+static void set_level(unsigned pin, int level, uint64_t tick)
+{
+	lock_guard<recursive_mutex> guard(sim_lock);
+	level = level ? 1 : 0;
+	if (pins[pin].level.load(memory_order_relaxed) == level)
+		return;
+	pins[pin].level.store(level, memory_order_release);
+	if (pins[pin].alert)
+		pins[pin].alert(pin, level, (uint32_t) tick, pins[pin].alert_data);
+}
+
+void sim_replay_alert(unsigned pin, int level, int pin_level, uint32_t tick)
+{
+	if (pin >= SIM_GPIO_PINS)
+		return;
+	lock_guard<recursive_mutex> guard(sim_lock);
+	pins[pin].level.store(pin_level ? 1 : 0, memory_order_release);
+	if (pins[pin].alert)
+		pins[pin].alert(pin, level, tick, pins[pin].alert_data);
+}
+
+// One clock step. Called with sim_lock held.
+static void step(uint32_t dt)
+{
+	uint64_t now = clock_now.load(memory_order_relaxed) + dt;
+	clock_now.store(now, memory_order_release);
+
+	for (int i = 0; i < SIM_STEP_HOOKS; i++)
+	{
+		if (hooks[i].func)
+			hooks[i].func(now, dt, hooks[i].userdata);
+	}
+
+	for (int i = 0; i < SIM_TIMERS; i++)
+	{
+		while (timers[i].func && (timers[i].next <= now))
+		{
+			timers[i].next += timers[i].period;
+			timers[i].func(timers[i].userdata);
+		}
+	}
+}
+
+int sim_initialise()
+{
+	return(0);
+}
+
+void sim_terminate()
+{
+	sim_stop();
+}
+
+int sim_set_mode(unsigned pin, unsigned mode)
+{
+	if (pin >= SIM_GPIO_PINS)
+		return(-1);
+	pins[pin].mode.store(mode);
+	return(0);
+}
+
+int sim_set_pull(unsigned pin, unsigned pud)
+{
+	if (pin >= SIM_GPIO_PINS)
+		return(-1);
+	// An unconnected input reads its pull.
+	if (pud == 2)         // up
+		set_level(pin, 1, clock_now.load());
+	else if (pud == 1)    // down
+		set_level(pin, 0, clock_now.load());
+	return(0);
+}
+
+int sim_read(unsigned pin)
+{
+	if (pin >= SIM_GPIO_PINS)
+		return(-1);
+	return(pins[pin].level.load(memory_order_acquire));
+}
+
+int sim_write(unsigned pin, unsigned level)
+{
+	if (pin >= SIM_GPIO_PINS)
+		return(-1);
+	pins[pin].mode.store(1);
+	set_level(pin, level, clock_now.load());
+	return(0);
+}
+
+int sim_write_bits(uint32_t bits, int level)
+{
+	for (unsigned pin = 0; pin < 32; pin++)
+	{
+		if (bits & (((uint32_t) 1) << pin))
+			set_level(pin, level, clock_now.load());
+	}
+	return(0);
+}
+
+int sim_pwm(unsigned pin, unsigned duty_cycle)
+{
+	if ((pin >= SIM_GPIO_PINS) || (duty_cycle > 255))
+		return(-1);
+	pins[pin].mode.store(1);
+	pins[pin].duty_cycle.store(duty_cycle, memory_order_release);
+	return(0);
+}
+
+int sim_set_pwm_frequency(unsigned pin, unsigned hz)
+{
+	if (pin >= SIM_GPIO_PINS)
+		return(-1);
+	pins[pin].frequency.store(hz);
+	return(hz);
+}
+
+int sim_set_alert(unsigned pin, sim_alert_func func, void *userdata)
+{
+	if (pin >= SIM_GPIO_PINS)
+		return(-1);
+	lock_guard<recursive_mutex> guard(sim_lock);
+	pins[pin].alert = func;
+	pins[pin].alert_data = userdata;
+	return(0);
+}
+
+int sim_set_timer(unsigned timer, unsigned ms, sim_timer_func func, void *userdata)
+{
+	if ((timer >= SIM_TIMERS) || (ms == 0))
+		return(-1);
+	lock_guard<recursive_mutex> guard(sim_lock);
+	timers[timer].func = func;
+	timers[timer].userdata = userdata;
+	timers[timer].period = ms * 1000ULL;
+	timers[timer].next = clock_now.load() + timers[timer].period;
+	return(0);
+}
+
+pthread_t *sim_start_thread(sim_thread_func func, void *userdata)
+{
+	pthread_t *thread = new pthread_t;
+	if (pthread_create(thread, NULL, func, userdata) != 0)
+	{
+		printf("Simulation could not start a thread.\n");
+		delete thread;
+		return(NULL);
+	}
+	return(thread);
+}
+
+void sim_stop_thread(pthread_t *thread)
+{
+	if (!thread)
+		return;
+	pthread_cancel(*thread);
+	pthread_join(*thread, NULL);
+	delete thread;
+}
+
+void sim_sleep_until(uint64_t tick)
+{
+	if (running.load())
+	{
+		unique_lock<mutex> lock(wait_lock);
+		while ((clock_now.load(memory_order_acquire) < tick) && running.load())
+			clock_moved.wait_for(lock, chrono::milliseconds(1));
+	}
+	// Stepped, or the clock was stopped while we waited.
+	sim_advance_to(tick);
+}
+
+uint64_t sim_now()
+{
+	return(clock_now.load(memory_order_acquire));
+}
+
+void sim_advance(uint64_t us)
+{
+	sim_advance_to(clock_now.load() + us);
+}
+
+void sim_advance_to(uint64_t tick)
+{
+	{
+		lock_guard<recursive_mutex> guard(sim_lock);
+		uint64_t now;
+		while ((now = clock_now.load(memory_order_relaxed)) < tick)
+		{
+			uint64_t left = tick - now;
+			step((left < step_us) ? (uint32_t) left : step_us);
+		}
+	}
+	clock_moved.notify_all();
+}
+
+void sim_set_step(uint32_t us)
+{
+	lock_guard<recursive_mutex> guard(sim_lock);
+	step_us = (us > 0) ? us : 1;
+}
+
+int sim_add_step_hook(sim_step_func func, void *userdata)
+{
+	lock_guard<recursive_mutex> guard(sim_lock);
+	for (int i = 0; i < SIM_STEP_HOOKS; i++)
+	{
+		if (!hooks[i].func)
+		{
+			hooks[i].func = func;
+			hooks[i].userdata = userdata;
+			return(0);
+		}
+	}
+	printf("No free simulation hook slots.\n");
+	return(1);
+}
+
+void sim_remove_step_hook(sim_step_func func, void *userdata)
+{
+	lock_guard<recursive_mutex> guard(sim_lock);
+	for (int i = 0; i < SIM_STEP_HOOKS; i++)
+	{
+		if ((hooks[i].func == func) && (hooks[i].userdata == userdata))
+		{
+			hooks[i].func = NULL;
+			hooks[i].userdata = NULL;
+		}
+	}
+}
+
+void sim_set_input(unsigned pin, int level)
+{
+	sim_set_input_at(pin, level, clock_now.load());
+}
+
+void sim_set_input_at(unsigned pin, int level, uint64_t tick)
+{
+	if (pin >= SIM_GPIO_PINS)
+		return;
+	set_level(pin, level, tick);
+}
+
+int sim_get_level(unsigned pin)
+{
+	return((pin < SIM_GPIO_PINS) ? pins[pin].level.load(memory_order_acquire) : 0);
+}
+
+int sim_get_pwm(unsigned pin)
+{
+	return((pin < SIM_GPIO_PINS) ? pins[pin].duty_cycle.load(memory_order_acquire) : 0);
+}
+
+int sim_get_pwm_frequency(unsigned pin)
+{
+	return((pin < SIM_GPIO_PINS) ? pins[pin].frequency.load() : 0);
+}
+
+static void *_sim_runner(void *userdata)
+{
+	int64_t real_start = real_ns();
+	uint64_t sim_start = clock_now.load();
+
+	while (!stop_running.load())
+	{
+		sim_advance(step_us);
+		if (run_speed <= 0)
+			continue;
+
+		// Hold the clock to speed times real time, sleeping once it is
+		// more than a millisecond ahead.
+		int64_t due = real_start + (int64_t) ((clock_now.load() - sim_start) * 1000 / run_speed);
+		if (due - real_ns() > 1000000)
+		{
+			struct timespec ts;
+			ts.tv_sec = due / 1000000000LL;
+			ts.tv_nsec = due % 1000000000LL;
+			while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+				;
+		}
+	}
+	return(NULL);
+}
+
+int sim_run(double speed)
+{
+	if (running.load())
+		return(1);
+	run_speed = speed;
+	stop_running.store(false);
+	running.store(true);
+	if (pthread_create(&runner, NULL, _sim_runner, NULL) != 0)
+	{
+		printf("Simulation could not start its clock.\n");
+		running.store(false);
+		return(2);
+	}
+	return(0);
+}
+
+void sim_stop()
+{
+	if (!running.load())
+		return;
+	stop_running.store(true);
+	pthread_join(runner, NULL);
+	running.store(false);
+	clock_moved.notify_all();
+}
+
+void sim_reset(uint64_t start_tick)
+{
+	lock_guard<recursive_mutex> guard(sim_lock);
+	clock_now.store(start_tick);
+	for (int i = 0; i < SIM_GPIO_PINS; i++)
+	{
+		pins[i].level.store(0);
+		pins[i].mode.store(0);
+		pins[i].duty_cycle.store(0);
+		pins[i].frequency.store(0);
+		pins[i].alert = NULL;
+		pins[i].alert_data = NULL;
+	}
+	for (int i = 0; i < SIM_TIMERS; i++)
+		timers[i].func = NULL;
+	for (int i = 0; i < SIM_STEP_HOOKS; i++)
+	{
+		hooks[i].func = NULL;
+		hooks[i].userdata = NULL;
+	}
+}
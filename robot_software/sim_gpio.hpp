@@ -0,0 +1,113 @@
+/* sim_gpio.hpp
+
+   Created 10/16/2026
+
+   This is the header file for the simulated GPIO backend of hal.hpp,
+   used when the robot code is built with -DROBOT_SIM.
+
+   Everything runs on a virtual microsecond clock that starts at
+   SIM_START_TICK and only moves when something advances it. It moves in
+   steps of at most the step size; after each step the model step hooks
+   run (plants, sim_plant.hpp) and then any timers that came due. Models
+   drive the inputs with sim_set_input() the way the outside world drives
+   the pins, which calls the pin's alert just as pigpio would, and read
+   back the direction levels and duty cycles the robot code wrote.
+
+   There are two ways to move the clock:
+     - stepped (the default): a hal_sleep() or control loop wait advances
+       the clock itself up to its deadline, so a single threaded run goes
+       as fast as the models can be computed.
+     - running (sim_run()): a background thread advances the clock, at a
+       multiple of real time or flat out, and sleeps wait for it. This is
+       for code that busy waits on an input, such as homing, or several
+       threads sharing the clock.
+
+   The backend is meant for tests and tools, not for the realtime path:
+   alerts, hooks and timers are serialised by a lock.
+*/
+
+#ifndef __SIM_GPIO_HPP__
+#define __SIM_GPIO_HPP__
+
+#include <stdint.h>
+#include <pthread.h>
+
+// GPIO count on the Pi header
+#define SIM_GPIO_PINS 54
+
+// Timer slots, as in pigpio
+#define SIM_TIMERS 10
+
+// Most model step hooks at once
+#define SIM_STEP_HOOKS 8
+
+// Default clock step (us), and where the clock starts
+#define SIM_STEP_US 10
+#define SIM_START_TICK 1000000ULL
+
+typedef void (*sim_alert_func)(int gpio, int level, uint32_t tick, void *userdata);
+typedef void (*sim_timer_func)(void *userdata);
+typedef void *(sim_thread_func)(void *userdata);
+
+// Called after every clock step of dt_us ending at now
+typedef void (*sim_step_func)(uint64_t now, uint32_t dt_us, void *userdata);
+
+// BACKEND: see the matching hal_ functions in hal.hpp
+int sim_initialise();
+void sim_terminate();
+int sim_set_mode(unsigned pin, unsigned mode);
+int sim_set_pull(unsigned pin, unsigned pud);
+int sim_read(unsigned pin);
+int sim_write(unsigned pin, unsigned level);
+int sim_write_bits(uint32_t bits, int level);
+int sim_pwm(unsigned pin, unsigned duty_cycle);
+int sim_set_pwm_frequency(unsigned pin, unsigned hz);
+int sim_set_alert(unsigned pin, sim_alert_func func, void *userdata);
+int sim_set_timer(unsigned timer, unsigned ms, sim_timer_func func, void *userdata);
+pthread_t *sim_start_thread(sim_thread_func func, void *userdata);
+void sim_stop_thread(pthread_t *thread);
+
+// Wait for the virtual clock to reach tick. Advances it when stepped.
+void sim_sleep_until(uint64_t tick);
+
+// MODELS
+
+// Current virtual time in microseconds
+uint64_t sim_now();
+
+// Move the clock forward, stepping hooks and timers on the way
+void sim_advance(uint64_t us);
+void sim_advance_to(uint64_t tick);
+
+// Largest clock step, in microseconds
+void sim_set_step(uint32_t us);
+
+// Register a model. Returns 0, or 1 if all hook slots are taken.
+int sim_add_step_hook(sim_step_func func, void *userdata);
+void sim_remove_step_hook(sim_step_func func, void *userdata);
+
+// Drive an input pin. A change of level calls the pin's alert with tick,
+// which may lie anywhere inside the step being taken (the default is now)
+// so models can place edges between steps.
+void sim_set_input(unsigned pin, int level);
+void sim_set_input_at(unsigned pin, int level, uint64_t tick);
+
+// Call the pin's alert with a recorded level and tick whether or not the
+// level changed, with the pin reading pin_level meanwhile (event_replay).
+void sim_replay_alert(unsigned pin, int level, int pin_level, uint32_t tick);
+
+// What the robot is driving: pin level, PWM duty cycle and frequency
+int sim_get_level(unsigned pin);
+int sim_get_pwm(unsigned pin);
+int sim_get_pwm_frequency(unsigned pin);
+
+// Run the clock from a background thread at speed times real time
+// (0 = as fast as possible) until sim_stop(). Returns 0 on success.
+int sim_run(double speed);
+void sim_stop();
+
+// Clock back to start_tick, every pin low and unwatched, no hooks or
+// timers. Not while running.
+void sim_reset(uint64_t start_tick);
+
+#endif
@@ -0,0 +1,102 @@
+/* sim_plant.cpp
+
+   Created 10/16/2026
+
+   This is the cpp file holding the function definitions for the
+   sim_plant class. See sim_plant.hpp.
+*/
+
+#include <stdio.h>
+#include "sim_plant.hpp"
+#include "sim_gpio.hpp"
+
+// How many attached plants press each pin. Only touched from the clock
+// step, under the simulation lock.
+static int presses[SIM_GPIO_PINS];
+
+// Constructor
+sim_plant::sim_plant(motor_plant* plant, int pwm_pin, int dir_pin, int a_pin, int b_pin, int upper_pin, int lower_pin)
+{
+	this->plant = plant;
+	this->pwm_pin = pwm_pin;
+	this->dir_pin = dir_pin;
+	this->a_pin = a_pin;
+	this->b_pin = b_pin;
+	this->upper_pin = upper_pin;
+	this->lower_pin = lower_pin;
+	upper_pressed = false;
+	lower_pressed = false;
+	attached = false;
+}
+
+// Destructor
+sim_plant::~sim_plant()
+{
+	this->detach();
+}
+
+int sim_plant::attach()
+{
+	if (attached)
+		return(0);
+	if (sim_add_step_hook(_static_step, this) != 0)
+		return(1);
+	attached = true;
+
+	plant->set_encoder_output(_static_edge, this);
+	sim_set_input(a_pin, plant->get_a_level());
+	sim_set_input(b_pin, plant->get_b_level());
+
+	// Released switches read high.
+	if ((upper_pin >= 0) && (upper_pin < SIM_GPIO_PINS) && (presses[upper_pin] == 0))
+		sim_set_input(upper_pin, 1);
+	if ((lower_pin >= 0) && (lower_pin < SIM_GPIO_PINS) && (presses[lower_pin] == 0))
+		sim_set_input(lower_pin, 1);
+	this->press(upper_pin, plant->upper_pressed(), upper_pressed);
+	this->press(lower_pin, plant->lower_pressed(), lower_pressed);
+	return(0);
+}
+
+void sim_plant::detach()
+{
+	if (!attached)
+		return;
+	sim_remove_step_hook(_static_step, this);
+	plant->set_encoder_output(NULL, NULL);
+	this->press(upper_pin, false, upper_pressed);
+	this->press(lower_pin, false, lower_pressed);
+	attached = false;
+}
+
+motor_plant* sim_plant::get_plant()
+{
+	return(plant);
+}
+
+void sim_plant::_static_step(uint64_t now, uint32_t dt_us, void *userdata)
+{
+	sim_plant* Self = (sim_plant*) userdata;
+	Self->_step(now, dt_us);
+}
+
+void sim_plant::_static_edge(int channel, int level, uint64_t tick, void *userdata)
+{
+	sim_plant* Self = (sim_plant*) userdata;
+	sim_set_input_at((channel == 0) ? Self->a_pin : Self->b_pin, level, tick);
+}
+
+void sim_plant::_step(uint64_t now, uint32_t dt_us)
+{
+	plant->step(now, dt_us, sim_get_pwm(pwm_pin), sim_get_level(dir_pin));
+	this->press(upper_pin, plant->upper_pressed(), upper_pressed);
+	this->press(lower_pin, plant->lower_pressed(), lower_pressed);
+}
+
+void sim_plant::press(int pin, bool pressed, bool& state)
+{
+	if ((pin < 0) || (pin >= SIM_GPIO_PINS) || (pressed == state))
+		return;
+	state = pressed;
+	presses[pin] += pressed ? 1 : -1;
+	sim_set_input(pin, (presses[pin] > 0) ? 0 : 1);
+}
@@ -0,0 +1,66 @@
+/* sim_plant.hpp
+
+   Created 10/16/2026
+
+   This is the header file for the sim_plant class.
+
+   A sim_plant connects a motor_plant to the simulated GPIO (sim_gpio.hpp)
+   on the same pins the dc_motor and rot_encoder use. Every clock step it
+   reads the motor's PWM and direction pins, steps the plant, and drives
+   the encoder and limit switch inputs from it.
+
+   Limit switches pull their pin low while pressed. Both axes of a hand
+   share one pair of switch pins on the robot, so a switch pin reads low
+   while any attached plant presses it.
+*/
+
+#ifndef __SIM_PLANT_HPP__
+#define __SIM_PLANT_HPP__
+
+#include <stdint.h>
+#include "motor_plant.hpp"
+
+class sim_plant
+{
+public:
+
+	// Constructor
+	sim_plant(motor_plant* plant, int pwm_pin, int dir_pin, int a_pin, int b_pin, int upper_pin, int lower_pin);
+
+	// Destructor
+	~sim_plant();
+
+	// Start and stop stepping with the simulated clock. Returns 0 on
+	// success.
+	int attach();
+	void detach();
+
+	motor_plant* get_plant();
+
+	static void _static_step(uint64_t now, uint32_t dt_us, void *userdata);
+	static void _static_edge(int channel, int level, uint64_t tick, void *userdata);
+
+private:
+
+	void _step(uint64_t now, uint32_t dt_us);
+
+	// Press or release a switch pin
+	void press(int pin, bool pressed, bool& state);
+
+	motor_plant* plant;
+	int pwm_pin;
+	int dir_pin;
+	int a_pin;
+	int b_pin;
+	int upper_pin;
+	int lower_pin;
+	bool upper_pressed;
+	bool lower_pressed;
+	bool attached;
+
+	// Disable default copy constructor and assignment operator
+	sim_plant(const sim_plant&);
+	sim_plant& operator=(const sim_plant&);
+};
+
+#endif
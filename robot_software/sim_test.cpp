@@ -0,0 +1,734 @@
+/* sim_test.cpp
+
+   Created 10/16/2026
+
+   Checks of the robot code on the simulated GPIO (make check). Each test
+   sets up what it needs on a fresh simulated clock, prints PASS or FAIL
+   with the reason, and the program exits non-zero if any failed.
+
+   Usage: ./sim_test
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include <unistd.h>
+#include <vector>
+#include "hal.hpp"
+#include "mono_clock.hpp"
+#include "control_timer.hpp"
+#include "dc_motor.hpp"
+#include "axis_group.hpp"
+#include "control_loop.hpp"
+#include "latency_estimator.hpp"
+#include "motor_plant.hpp"
+#include "sim_plant.hpp"
+#include "path_planner.hpp"
+#include "ball_sim.hpp"
+#include "trajectory_file.hpp"
+
+#ifndef ROBOT_SIM
+#error "sim_test runs on the simulated GPIO. Build it with make sim_test."
+#endif
+
+// LY wiring and setup, as in main.cpp
+#define SIM_PWM_PIN 25
+#define SIM_DIR_PIN 8
+#define SIM_UPPER_LIMIT_PIN 6
+#define SIM_LOWER_LIMIT_PIN 13
+#define SIM_ENCODER_A_PIN 14
+#define SIM_ENCODER_B_PIN 15
+#define SIM_ENCODER_Z_PIN 18
+#define SIM_LIMIT_WIDTH 0.543
+#define SIM_WORKSPACE_WIDTH 0.45
+
+// RY wiring, as in main.cpp
+#define SIM_RY_PWM_PIN 26
+#define SIM_RY_DIR_PIN 19
+#define SIM_RY_UPPER_LIMIT_PIN 4
+#define SIM_RY_LOWER_LIMIT_PIN 5
+#define SIM_RY_ENCODER_A_PIN 27
+#define SIM_RY_ENCODER_B_PIN 17
+#define SIM_RY_ENCODER_Z_PIN 22
+
+// Where gpioTick() wraps, and how long before it the wrap test starts
+#define TICK_WRAP (1ULL << 32)
+#define WRAP_LEAD_US 300000
+
+using namespace std;
+
+static int failures = 0;
+
+static void check(bool ok, const char* test, const char* what)
+{
+	if (!ok)
+	{
+		printf("FAIL %s: %s\n", test, what);
+		failures++;
+	}
+}
+
+// A move up and back, one sample per millisecond, at up to peak m/s
+static void ramp_paths(int samples, double peak, vector<double>& distance, vector<double>& velocity)
+{
+	double d = 0;
+	double slope = 2*peak/samples;
+	for (int i = 0; i < samples; i++)
+	{
+		double v = (i < samples/2) ? slope*i : slope*(samples - i);
+		velocity.push_back(v);
+		distance.push_back(d);
+		d += v*0.001;
+	}
+}
+
+// The 32 bit tick wraps in the middle of a PD-feedforward run. The 64 bit
+// clock must keep counting, and the run must keep its deadlines and path
+// samples as if nothing happened.
+static void test_tick_wrap()
+{
+	const char* name = "tick wrap";
+	int before = failures;
+
+	uint64_t start = TICK_WRAP - WRAP_LEAD_US;
+	sim_reset(start);
+	mono_clock_reset(start);
+
+	// The clock on its own, in odd steps across the wrap
+	uint64_t last = mono_tick();
+	bool monotonic = true;
+	bool exact = true;
+	while (sim_now() < TICK_WRAP + 1000)
+	{
+		sim_advance(37);
+		uint64_t now = mono_tick();
+		monotonic = monotonic && (now > last);
+		exact = exact && (now == sim_now());
+		last = now;
+	}
+	check(monotonic, name, "mono_tick() went backwards");
+	check(exact, name, "mono_tick() is not the simulated clock");
+
+	// A run that starts 300 ms before the wrap and ends 300 ms after it
+	sim_reset(start);
+	mono_clock_reset(start);
+	rot_encoder encoder(SIM_ENCODER_A_PIN, SIM_ENCODER_B_PIN, SIM_ENCODER_Z_PIN, 5);
+	dc_motor motor(LY, SIM_DIR_PIN, SIM_PWM_PIN, 10000, SIM_UPPER_LIMIT_PIN, SIM_LOWER_LIMIT_PIN, &encoder);
+	motor.set_constants(103.59, 60, 0, 200);
+	vector<double> distance;
+	vector<double> velocity;
+	ramp_paths(2*WRAP_LEAD_US/1000 + 1, 0.06, distance, velocity);
+	motor.set_paths(distance, velocity);
+
+	motor_plant plant(y_plant_params(SIM_LIMIT_WIDTH));
+	plant.set_position((SIM_LIMIT_WIDTH - SIM_WORKSPACE_WIDTH)/2);
+	sim_plant axis(&plant, SIM_PWM_PIN, SIM_DIR_PIN, SIM_ENCODER_A_PIN, SIM_ENCODER_B_PIN,
+	               SIM_UPPER_LIMIT_PIN, SIM_LOWER_LIMIT_PIN);
+	if (axis.attach() != 0)
+	{
+		check(false, name, "could not attach the plant");
+		return;
+	}
+	encoder.resetCount();
+	motor.count_per_meter = plant.count_per_meter();
+	motor.workspace_width_count = SIM_WORKSPACE_WIDTH * motor.count_per_meter;
+	motor.home_flag = true;
+
+	uint64_t start_tick = mono_tick();
+	motor.run_pdff_path(start_tick, 0);
+	axis.detach();
+
+	// Every period's record, in order, against the table at its tick
+	table_trajectory expected(motor.velocity_path, motor.distance_path, start_tick);
+	int64_t period = (int64_t) motor.loop_timer.period_us();
+	uint64_t expected_tick = start_tick;
+	uint32_t records = 0;
+	bool continuous = true;
+	bool on_path = true;
+	bool sane_velocity = true;
+	telemetry_record rec;
+	while (motor.telemetry.queue.pop(rec))
+	{
+		setpoint sp;
+		continuous = continuous && (rec.tick == expected_tick);
+		on_path = on_path && expected.sample(rec.tick, sp) && (rec.desired_velocity == (float) sp.velocity) &&
+		          (rec.desired_position == (float) sp.position);
+		sane_velocity = sane_velocity && (rec.velocity < 1) && (rec.velocity > -1);
+		expected_tick += period;
+		records++;
+	}
+
+	// The run ends at the first tick past the last whole sample.
+	setpoint sp;
+	uint32_t periods = 0;
+	for (uint64_t tick = start_tick; expected.sample(tick, sp); tick += period)
+		periods++;
+
+	check(continuous, name, "a control period was skipped or repeated");
+	check(on_path, name, "a setpoint is not the path at its tick");
+	check(sane_velocity, name, "the measured velocity jumped");
+	check(records == periods, name, "the run did not cover the whole path");
+	check(expected_tick > TICK_WRAP + WRAP_LEAD_US/2, name, "the run did not cross the wrap");
+	check(motor.loop_timer.get_stats().deadline_misses == 0, name, "the loop missed deadlines");
+	printf("%s %s: %u periods from tick %llu to %llu\n", (failures == before) ? "PASS" : "FAIL", name,
+	       records, (unsigned long long) start_tick, (unsigned long long) (expected_tick - period));
+}
+
+// An iteration that runs into the next period is a miss, even when it
+// ends before that period is over. Only whole periods are skipped.
+static void test_deadline_misses()
+{
+	const char* name = "deadline misses";
+	int before = failures;
+
+	sim_reset(SIM_START_TICK);
+	mono_clock_reset(SIM_START_TICK);
+	control_timer timer(DEFAULT_CONTROL_RATE_HZ);
+	uint64_t period = (uint64_t) timer.period_us();
+
+	timer.start_at(mono_tick());
+	timer.wait_next();
+	sim_advance(period/2);
+	timer.wait_next();
+	check(timer.get_stats().deadline_misses == 0, name, "an iteration on time counted as a miss");
+
+	// Half a period over
+	sim_advance(period*3/2);
+	timer.wait_next();
+	control_loop_stats stats = timer.get_stats();
+	check(stats.deadline_misses == 1, name, "overrunning by half a period was not a miss");
+	check(stats.skipped_periods == 0, name, "overrunning by half a period skipped a period");
+
+	// The next deadline is still on the schedule, and two and a half
+	// periods over skips two.
+	timer.wait_next();
+	sim_advance(period*7/2);
+	timer.wait_next();
+	stats = timer.get_stats();
+	check(stats.deadline_misses == 2, name, "overrunning by two and a half periods was not a miss");
+	check(stats.skipped_periods == 2, name, "overrunning by two and a half periods did not skip two");
+	printf("%s %s: %llu misses, %llu skipped periods\n", (failures == before) ? "PASS" : "FAIL", name,
+	       (unsigned long long) stats.deadline_misses, (unsigned long long) stats.skipped_periods);
+}
+
+// On the robot start_at() wakes a little after the first deadline, and
+// the loop's first wait_next() finds the clock already past it. That is
+// the start of the run, not a miss, unless a whole period went by.
+static void test_late_start()
+{
+	const char* name = "late start";
+	int before = failures;
+
+	sim_reset(SIM_START_TICK);
+	mono_clock_reset(SIM_START_TICK);
+	control_timer timer(DEFAULT_CONTROL_RATE_HZ);
+	uint64_t period = (uint64_t) timer.period_us();
+
+	// Woken a quarter of a period late, then on time from there
+	timer.start_at(mono_tick() + 1000);
+	sim_advance(period/4);
+	timer.wait_next();
+	timer.wait_next();
+	timer.wait_next();
+	check(timer.get_stats().deadline_misses == 0, name, "waking late from start_at() counted as a miss");
+
+	// Woken a period and a half late
+	timer.start_at(mono_tick() + 1000);
+	sim_advance(period*3/2);
+	timer.wait_next();
+	control_loop_stats stats = timer.get_stats();
+	check(stats.deadline_misses == 1, name, "waking a whole period late from start_at() was not a miss");
+	check(stats.skipped_periods == 1, name, "waking a whole period late from start_at() did not skip it");
+	printf("%s %s\n", (failures == before) ? "PASS" : "FAIL", name);
+}
+
+// With a lookahead, only the feedforward looks ahead. An axis right on
+// the path at the tick gets no feedback, and the setpoint it is compared
+// and logged against is the path at the tick.
+static void test_lookahead()
+{
+	const char* name = "lookahead";
+	int before = failures;
+	const int lookahead = 20000;
+
+	dc_motor motor;
+	motor.set_constants(103.59, 60, 3000, 200);
+	vector<double> distance;
+	vector<double> velocity;
+	ramp_paths(200, 1.0, distance, velocity);
+	motor.set_paths(distance, velocity);
+	pdff_law law(motor);
+
+	// Tables
+	table_trajectory now_table(motor.velocity_path, motor.distance_path, SIM_START_TICK);
+	table_trajectory ahead_table(motor.velocity_path, motor.distance_path, SIM_START_TICK, lookahead);
+	bool same_setpoint = true;
+	bool feedforward_ahead = true;
+	bool no_feedback = true;
+	uint64_t tick = SIM_START_TICK;
+	setpoint now_sp;
+	setpoint sp;
+	while (now_table.sample(tick, now_sp))
+	{
+		same_setpoint = same_setpoint && ahead_table.sample(tick, sp) && (sp.position == now_sp.position) &&
+		                (sp.velocity == now_sp.velocity);
+		setpoint later;
+		double expected = velocity.back();
+		if (now_table.sample(tick + lookahead, later))
+			expected = later.velocity;
+		feedforward_ahead = feedforward_ahead && (fabs(sp.ff_velocity - expected) < 1e-9);
+
+		axis_state state;
+		state.position = sp.position;
+		state.velocity = sp.velocity;
+		double effort = law.effort(sp, state);
+		double feedforward = motor.velocity_ff_constant*sp.ff_velocity + ((sp.ff_velocity > 0) ? motor.friction_up_ff : 0);
+		no_feedback = no_feedback && (fabs(effort - feedforward) < 1e-9);
+		tick += 500;
+	}
+	check(same_setpoint && !ahead_table.sample(tick, sp), name, "the table setpoint moved with the lookahead");
+	check(feedforward_ahead, name, "the table feedforward is not the path a lookahead on");
+	check(no_feedback, name, "an axis on the table path got feedback");
+
+	// Segments
+	planner_params params;
+	level1_plan plan;
+	if (plan_level1(params, 2.0, plan))
+	{
+		check(false, name, "could not plan a path");
+		return;
+	}
+	path_cursor now_cursor(&plan.y);
+	path_cursor cursor(&plan.y);
+	path_cursor later_cursor(&plan.y);
+	path_slot now_slot;
+	path_slot slot;
+	segment_trajectory now_segments(&now_cursor, &now_slot, SIM_START_TICK);
+	segment_trajectory ahead_segments(&cursor, &slot, SIM_START_TICK, lookahead);
+	same_setpoint = true;
+	feedforward_ahead = true;
+	tick = SIM_START_TICK;
+	while (now_segments.sample(tick, now_sp))
+	{
+		same_setpoint = same_setpoint && ahead_segments.sample(tick, sp) && (sp.position == now_sp.position) &&
+		                (sp.velocity == now_sp.velocity);
+		path_point later;
+		double expected = later_cursor.evaluate((tick - SIM_START_TICK + lookahead)*1e-6, later) ? later.v : 0;
+		feedforward_ahead = feedforward_ahead && (fabs(sp.ff_velocity - expected) < 1e-9);
+		tick += 500;
+	}
+	check(same_setpoint && !ahead_segments.sample(tick, sp), name, "the segment setpoint moved with the lookahead");
+	check(feedforward_ahead, name, "the segment feedforward is not the path a lookahead on");
+	printf("%s %s: %d us\n", (failures == before) ? "PASS" : "FAIL", name, lookahead);
+}
+
+// Streaming marks the record of the period each loop cycle starts in, not
+// the one after it.
+static void test_cycle_marks()
+{
+	const char* name = "cycle marks";
+	int before = failures;
+
+	sim_reset(SIM_START_TICK);
+	mono_clock_reset(SIM_START_TICK);
+	planner_params params;
+	level1_plan plan;
+	if (plan_level1(params, 2.0, plan))
+	{
+		check(false, name, "could not plan a path");
+		return;
+	}
+
+	rot_encoder encoder(SIM_ENCODER_A_PIN, SIM_ENCODER_B_PIN, SIM_ENCODER_Z_PIN, 5);
+	dc_motor motor(LY, SIM_DIR_PIN, SIM_PWM_PIN, 10000, SIM_UPPER_LIMIT_PIN, SIM_LOWER_LIMIT_PIN, &encoder);
+	motor.set_constants(103.59, 60, 0, 200);
+	motor.set_segment_path(&plan.y);
+	motor.count_per_meter = 10000;
+	motor.workspace_width_count = SIM_WORKSPACE_WIDTH * motor.count_per_meter;
+	motor.home_flag = true;
+	if (!(motor.begin_stream_path()))
+	{
+		check(false, name, "could not start streaming");
+		return;
+	}
+
+	// The cycle each record's tick is in, from a cursor of our own
+	path_cursor expected(&plan.y);
+	expected.set_repeat(true);
+	uint64_t start_tick = mono_tick();
+	uint64_t period = (uint64_t) motor.loop_timer.period_us();
+	uint32_t cycles = 0;
+	uint32_t marks = 0;
+	bool on_boundary = true;
+	telemetry_record rec;
+	for (uint64_t tick = start_tick; motor.step_stream_path(tick, start_tick); tick += period)
+	{
+		while (motor.telemetry.queue.pop(rec))
+		{
+			path_point point;
+			expected.evaluate((rec.tick - start_tick)*1e-6, point);
+			bool new_cycle = (expected.cycles_started() != cycles);
+			cycles = expected.cycles_started();
+			on_boundary = on_boundary && (new_cycle == ((rec.flags & TELEMETRY_CYCLE_START) != 0));
+			if (rec.flags & TELEMETRY_CYCLE_START)
+				marks++;
+		}
+		if (cycles >= 3)
+		{
+			motor.finish_stream_path();
+			expected.finish();
+		}
+	}
+	motor.end_stream_path();
+
+	check(marks == 3, name, "three cycles were not marked three times");
+	check(on_boundary, name, "a cycle start is not on the period the cycle starts in");
+	printf("%s %s: %u cycles marked\n", (failures == before) ? "PASS" : "FAIL", name, marks);
+}
+
+// Trajectory files are played at 1 kHz in meters. A file at another rate
+// or in other units must be refused rather than played wrong.
+static void test_trajectory_rate()
+{
+	const char* name = "trajectory rate";
+	int before = failures;
+
+	vector<double> distance;
+	vector<double> velocity;
+	ramp_paths(100, 1.0, distance, velocity);
+	vector<double> acceleration(distance.size(), 0);
+	const char* files[] = {"/tmp/sim_test_1000.traj", "/tmp/sim_test_500.traj", "/tmp/sim_test_radians.traj"};
+	uint32_t rates[] = {1000, 500, 1000};
+	trajectory_units units[] = {TRAJ_METERS, TRAJ_METERS, TRAJ_RADIANS};
+	bool loaded[3];
+	for (int i = 0; i < 3; i++)
+	{
+		if (write_trajectory(files[i], distance.data(), velocity.data(), acceleration.data(), distance.size(), rates[i],
+		                     units[i]))
+		{
+			check(false, name, "could not write a trajectory file");
+			return;
+		}
+		dc_motor motor;
+		motor.set_trajectory_file(files[i]);
+		loaded[i] = (motor.velocity_path.size() == velocity.size()) && (motor.distance_path.size() == distance.size());
+		unlink(files[i]);
+	}
+
+	check(loaded[0], name, "a 1 kHz file in meters was not loaded");
+	check(!loaded[1], name, "a 500 Hz file was loaded");
+	check(!loaded[2], name, "a file in radians was loaded");
+	printf("%s %s\n", (failures == before) ? "PASS" : "FAIL", name);
+}
+
+// Measured velocity for the latency test: the command delay_ms ago, or
+// nothing for an axis that does not move
+static int latency_of(const vector<double>& commanded, int delay_ms, bool moves)
+{
+	latency_estimator latency;
+	for (size_t i = 0; i < commanded.size(); i++)
+	{
+		double measured = 0;
+		if (moves && (i >= (size_t) delay_ms))
+			measured = commanded[i - delay_ms];
+		latency.add(SIM_START_TICK + i*1000, commanded[i], measured);
+	}
+	return(latency.latency_us());
+}
+
+// The latency is only reported when it was measured: not for an axis that
+// never moved, nor when the best fit is the longest lag there is.
+static void test_latency()
+{
+	const char* name = "latency";
+	int before = failures;
+
+	vector<double> distance;
+	vector<double> velocity;
+	ramp_paths(1000, 1.0, distance, velocity);
+	vector<double> still(1000, 0.5);
+
+	int measured = latency_of(velocity, 10, true);
+	check((measured > 9500) && (measured < 10500), name, "a 10 ms delay was not measured as 10 ms");
+	check(latency_of(velocity, 0, false) == -1, name, "an axis that never moved has a latency");
+	check(latency_of(still, 10, true) == -1, name, "a constant command has a latency");
+	check(latency_of(velocity, LATENCY_MAX_LAG_MS + 20, true) == -1, name, "a delay past the range has a latency");
+	printf("%s %s: 10 ms measured as %d us\n", (failures == before) ? "PASS" : "FAIL", name, measured);
+}
+
+// Duty cycle on a PWM pin after every clock step
+struct pwm_trace {
+	int pin;
+	vector<uint64_t> ticks;
+	vector<int> duty;
+};
+
+static void _trace_pwm(uint64_t now, uint32_t dt_us, void *userdata)
+{
+	pwm_trace* trace = (pwm_trace*) userdata;
+	trace->ticks.push_back(now);
+	trace->duty.push_back(sim_get_pwm(trace->pin));
+}
+
+// One axis of a group runs out of its workspace and aborts. The duty cycle
+// it staged that period must not reach the pin at the commit, and it must
+// stay stopped while the other axis finishes.
+static void test_group_abort()
+{
+	const char* name = "group abort";
+	int before = failures;
+
+	sim_reset(SIM_START_TICK);
+	mono_clock_reset(SIM_START_TICK);
+	vector<double> distance;
+	vector<double> velocity;
+	ramp_paths(100, 3.0, distance, velocity);
+
+	rot_encoder ly_encoder(SIM_ENCODER_A_PIN, SIM_ENCODER_B_PIN, SIM_ENCODER_Z_PIN, 5);
+	dc_motor ly(LY, SIM_DIR_PIN, SIM_PWM_PIN, 10000, SIM_UPPER_LIMIT_PIN, SIM_LOWER_LIMIT_PIN, &ly_encoder);
+	rot_encoder ry_encoder(SIM_RY_ENCODER_A_PIN, SIM_RY_ENCODER_B_PIN, SIM_RY_ENCODER_Z_PIN, 5);
+	dc_motor ry(RY, SIM_RY_DIR_PIN, SIM_RY_PWM_PIN, 10000, SIM_RY_UPPER_LIMIT_PIN, SIM_RY_LOWER_LIMIT_PIN, &ry_encoder);
+
+	motor_plant ly_plant(y_plant_params(SIM_LIMIT_WIDTH));
+	motor_plant ry_plant(y_plant_params(SIM_LIMIT_WIDTH));
+	sim_plant ly_axis(&ly_plant, SIM_PWM_PIN, SIM_DIR_PIN, SIM_ENCODER_A_PIN, SIM_ENCODER_B_PIN,
+	                  SIM_UPPER_LIMIT_PIN, SIM_LOWER_LIMIT_PIN);
+	sim_plant ry_axis(&ry_plant, SIM_RY_PWM_PIN, SIM_RY_DIR_PIN, SIM_RY_ENCODER_A_PIN, SIM_RY_ENCODER_B_PIN,
+	                  SIM_RY_UPPER_LIMIT_PIN, SIM_RY_LOWER_LIMIT_PIN);
+	dc_motor* motors[2] = {&ly, &ry};
+	motor_plant* plants[2] = {&ly_plant, &ry_plant};
+	for (int i = 0; i < 2; i++)
+	{
+		motors[i]->set_constants(103.59, 60, 0, 200);
+		motors[i]->set_paths(distance, velocity);
+		plants[i]->set_position((SIM_LIMIT_WIDTH - SIM_WORKSPACE_WIDTH)/2);
+		motors[i]->count_per_meter = plants[i]->count_per_meter();
+		motors[i]->workspace_width_count = SIM_WORKSPACE_WIDTH * motors[i]->count_per_meter;
+		motors[i]->home_flag = true;
+	}
+	if ((ly_axis.attach() != 0) || (ry_axis.attach() != 0))
+	{
+		check(false, name, "could not attach the plants");
+		return;
+	}
+	ly_encoder.resetCount();
+	ry_encoder.resetCount();
+
+	// LY runs out of a tiny workspace 50 counts up, while it is still
+	// speeding up so the period it aborts in stages a new duty cycle.
+	ly.workspace_width_count = 50 - 150;
+
+	pwm_trace trace;
+	trace.pin = SIM_PWM_PIN;
+	sim_add_step_hook(_trace_pwm, &trace);
+
+	axis_group group;
+	group.add_axis(&ly, 0);
+	group.add_axis(&ry, 0);
+	group.run_pdff(mono_tick());
+	sim_remove_step_hook(_trace_pwm, &trace);
+	ly_axis.detach();
+	ry_axis.detach();
+
+	// LY's last period is the one that aborted.
+	telemetry_record rec;
+	uint64_t abort_tick = 0;
+	uint32_t ly_records = 0;
+	int last_duty = 0;
+	int abort_duty = 0;
+	while (ly.telemetry.queue.pop(rec))
+	{
+		abort_tick = rec.tick;
+		last_duty = abort_duty;
+		abort_duty = rec.duty_cycle;
+		ly_records++;
+	}
+	uint32_t ry_records = 0;
+	uint64_t end_tick = 0;
+	bool directions = true;
+	while (ry.telemetry.queue.pop(rec))
+	{
+		end_tick = rec.tick;
+		directions = directions && (rec.dir >= 0);
+		ry_records++;
+	}
+
+	int worst = 0;
+	for (size_t i = 0; i < trace.ticks.size(); i++)
+	{
+		if ((trace.ticks[i] > abort_tick) && (trace.duty[i] > worst))
+			worst = trace.duty[i];
+	}
+
+	check(ly_records < ry_records, name, "LY did not abort before RY finished");
+	check(abort_duty != last_duty, name, "LY staged no new duty cycle as it aborted");
+	check(end_tick > abort_tick, name, "RY did not run on after LY aborted");
+	check(worst == 0, name, "LY's PWM came back on after it aborted");
+	check(directions, name, "RY's telemetry has no direction (sysid drops those records)");
+	printf("%s %s: LY aborted after %u periods, RY ran %u, LY duty after the abort at most %d\n",
+	       (failures == before) ? "PASS" : "FAIL", name, ly_records, ry_records, worst);
+}
+
+// Presses a limit switch at a tick, as the hand running into it would
+struct limit_press {
+	int pin;
+	uint64_t tick;
+	bool pressed;
+};
+
+static void _press_limit(uint64_t now, uint32_t dt_us, void *userdata)
+{
+	limit_press* press = (limit_press*) userdata;
+	if (!press->pressed && (now >= press->tick))
+	{
+		sim_set_input(press->pin, 0);
+		press->pressed = true;
+	}
+}
+
+// A limit switch trips on one axis of a group. The alert only zeroes the
+// pin and sets the latch; the control thread must then keep that axis
+// stopped while the other one finishes.
+static void test_limit_trip()
+{
+	const char* name = "limit trip";
+	int before = failures;
+
+	sim_reset(SIM_START_TICK);
+	mono_clock_reset(SIM_START_TICK);
+	vector<double> distance;
+	vector<double> velocity;
+	ramp_paths(100, 1.0, distance, velocity);
+
+	rot_encoder ly_encoder(SIM_ENCODER_A_PIN, SIM_ENCODER_B_PIN, SIM_ENCODER_Z_PIN, 5);
+	dc_motor ly(LY, SIM_DIR_PIN, SIM_PWM_PIN, 10000, SIM_UPPER_LIMIT_PIN, SIM_LOWER_LIMIT_PIN, &ly_encoder);
+	rot_encoder ry_encoder(SIM_RY_ENCODER_A_PIN, SIM_RY_ENCODER_B_PIN, SIM_RY_ENCODER_Z_PIN, 5);
+	dc_motor ry(RY, SIM_RY_DIR_PIN, SIM_RY_PWM_PIN, 10000, SIM_RY_UPPER_LIMIT_PIN, SIM_RY_LOWER_LIMIT_PIN, &ry_encoder);
+
+	motor_plant ly_plant(y_plant_params(SIM_LIMIT_WIDTH));
+	motor_plant ry_plant(y_plant_params(SIM_LIMIT_WIDTH));
+	sim_plant ly_axis(&ly_plant, SIM_PWM_PIN, SIM_DIR_PIN, SIM_ENCODER_A_PIN, SIM_ENCODER_B_PIN,
+	                  SIM_UPPER_LIMIT_PIN, SIM_LOWER_LIMIT_PIN);
+	sim_plant ry_axis(&ry_plant, SIM_RY_PWM_PIN, SIM_RY_DIR_PIN, SIM_RY_ENCODER_A_PIN, SIM_RY_ENCODER_B_PIN,
+	                  SIM_RY_UPPER_LIMIT_PIN, SIM_RY_LOWER_LIMIT_PIN);
+	dc_motor* motors[2] = {&ly, &ry};
+	motor_plant* plants[2] = {&ly_plant, &ry_plant};
+	for (int i = 0; i < 2; i++)
+	{
+		motors[i]->set_constants(103.59, 60, 0, 200);
+		motors[i]->set_paths(distance, velocity);
+		plants[i]->set_position((SIM_LIMIT_WIDTH - SIM_WORKSPACE_WIDTH)/2);
+		motors[i]->count_per_meter = plants[i]->count_per_meter();
+		motors[i]->workspace_width_count = SIM_WORKSPACE_WIDTH * motors[i]->count_per_meter;
+		motors[i]->home_flag = true;
+	}
+	if ((ly_axis.attach() != 0) || (ry_axis.attach() != 0))
+	{
+		check(false, name, "could not attach the plants");
+		return;
+	}
+	ly_encoder.resetCount();
+	ry_encoder.resetCount();
+
+	// LY's upper switch closes 20 ms in, with the motor driving hard.
+	limit_press press;
+	press.pin = SIM_UPPER_LIMIT_PIN;
+	press.tick = mono_tick() + 20000;
+	press.pressed = false;
+	sim_add_step_hook(_press_limit, &press);
+	pwm_trace trace;
+	trace.pin = SIM_PWM_PIN;
+	sim_add_step_hook(_trace_pwm, &trace);
+
+	axis_group group;
+	group.add_axis(&ly, 0);
+	group.add_axis(&ry, 0);
+	group.run_pdff(mono_tick());
+	sim_remove_step_hook(_trace_pwm, &trace);
+	sim_remove_step_hook(_press_limit, &press);
+	ly_axis.detach();
+	ry_axis.detach();
+
+	int driving = 0;
+	int worst = 0;
+	for (size_t i = 0; i < trace.ticks.size(); i++)
+	{
+		if (trace.ticks[i] < press.tick)
+			driving = (trace.duty[i] > driving) ? trace.duty[i] : driving;
+		else if (trace.duty[i] > worst)
+			worst = trace.duty[i];
+	}
+	telemetry_record rec;
+	uint64_t ly_end = 0;
+	while (ly.telemetry.queue.pop(rec))
+		ly_end = rec.tick;
+	uint64_t ry_end = 0;
+	while (ry.telemetry.queue.pop(rec))
+		ry_end = rec.tick;
+
+	check(press.pressed && ly.limit_latch, name, "LY's limit switch did not latch");
+	check(driving > 0, name, "LY was not driving when the switch closed");
+	check(ly_end < press.tick + (uint64_t) group.loop_timer.period_us(), name, "LY kept running after the switch");
+	check(ry_end > press.tick, name, "RY did not run on after LY latched");
+	check(worst == 0, name, "LY's PWM came back on after the switch");
+	printf("%s %s: LY duty %d before the switch, at most %d after\n", (failures == before) ? "PASS" : "FAIL", name,
+	       driving, worst);
+}
+
+// A ball thrown with no error by a level 1 plan comes back down into the
+// hand within the catch tolerance, at every height main.cpp might use.
+static void test_planned_catch()
+{
+	const char* name = "planned catch";
+	int before = failures;
+	const double heights[] = {0.3, 0.4, 0.5, 0.6, 0.7};
+	int count = sizeof(heights)/sizeof(heights[0]);
+
+	int caught = 0;
+	for (int h = 0; h < count; h++)
+	{
+		planner_params params;
+		params.ball_trajectory_height = heights[h];
+		level1_plan plan;
+		if (plan_level1(params, 2.0, plan))
+		{
+			check(false, name, "a height could not be planned");
+			continue;
+		}
+
+		hand_track track;
+		hand_track_from_paths(plan.x, plan.y, 1000, track);
+		ball_batch balls;
+		balls.resize(1);
+		balls.reset(track);
+		simulate_balls(ball_sim_params(), track, balls);
+		if (balls.caught_every_throw(0))
+			caught++;
+		else
+			printf("  %.1f m: %u throws, %u catches, %u bounces\n", heights[h], balls.throws[0], balls.catches[0],
+			       balls.bounces[0]);
+	}
+	check(caught == count, name, "a perfect throw was not caught");
+	printf("%s %s: %d of %d heights caught\n", (failures == before) ? "PASS" : "FAIL", name, caught, count);
+}
+
+int main(int argc, char *argv[])
+{
+	hal_initialise();
+
+	test_tick_wrap();
+	test_deadline_misses();
+	test_late_start();
+	test_lookahead();
+	test_latency();
+	test_cycle_marks();
+	test_trajectory_rate();
+	test_group_abort();
+	test_limit_trip();
+	test_planned_catch();
+
+	hal_terminate();
+	if (failures)
+		printf("%d checks failed.\n", failures);
+	return((failures > 0) ? 1 : 0);
+}
@@ -0,0 +1,129 @@
+/* sim_throw.cpp
+
+   Created 10/16/2026
+
+   Runs the LY throw path on a simulated axis. The dc_motor, rot_encoder
+   and control loop are the robot's own code built against the simulated
+   GPIO (make sim_throw), with a motor_plant where the motor, belt, encoder
+   and limit switches would be. The clock steps as fast as the plant can
+   be computed, so the whole throw takes milliseconds.
+
+   The axis starts where homing leaves it, at the bottom of the workspace.
+   Kp and Kd default to main.cpp's, and the velocity and friction
+   feedforward to what sysid fits to the nominal plant. main.cpp has no
+   friction feedforward; on the nominal plant that leaves the hand 60 mm
+   short at the top of the throw, and it runs out of the bottom of the
+   workspace on the way down.
+
+   Usage: ./sim_throw [Kff Kp Kd] [position file] [velocity file]
+
+   Prints the tracking error, the simulated and wall clock time, and the
+   loop statistics. The run is recorded to telemetry_LY.bin and its
+   events to events.bin, as on the robot, so it can be dumped, fed to
+   sysid or replayed with event_replay.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string>
+#include "hal.hpp"
+#include "mono_clock.hpp"
+#include "dc_motor.hpp"
+#include "motor_plant.hpp"
+#include "sim_plant.hpp"
+
+#ifndef ROBOT_SIM
+#error "sim_throw runs on the simulated GPIO. Build it with make sim_throw."
+#endif
+
+// LY wiring and setup, as in main.cpp
+#define SIM_PWM_PIN 25
+#define SIM_DIR_PIN 8
+#define SIM_UPPER_LIMIT_PIN 6
+#define SIM_LOWER_LIMIT_PIN 13
+#define SIM_ENCODER_A_PIN 14
+#define SIM_ENCODER_B_PIN 15
+#define SIM_ENCODER_Z_PIN 18
+#define SIM_LIMIT_WIDTH 0.543
+#define SIM_WORKSPACE_WIDTH 0.45
+
+// sysid's fit to a run on the nominal Y plant, and main.cpp's PD gains
+#define SIM_KFF 72.4
+#define SIM_FRICTION_UP 44.4
+#define SIM_FRICTION_DOWN 26.0
+#define SIM_KP 0
+#define SIM_KD 200
+
+using namespace std;
+
+static double wall_ms()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return(ts.tv_sec*1000.0 + ts.tv_nsec/1000000.0);
+}
+
+int main(int argc, char *argv[])
+{
+	double kff = SIM_KFF;
+	double kp = SIM_KP;
+	double kd = SIM_KD;
+	if (argc > 3)
+	{
+		kff = atof(argv[1]);
+		kp = atof(argv[2]);
+		kd = atof(argv[3]);
+	}
+	string position_file = (argc > 4) ? argv[4] : "y_throw_position_higher_throw_50cm.txt";
+	string velocity_file = (argc > 5) ? argv[5] : "y_throw_velocity_higher_throw_50cm.txt";
+
+	hal_initialise();
+	mono_clock_start();
+
+	// Declared first so it outlives the telemetry writer
+	event_recorder events;
+
+	rot_encoder encoder(SIM_ENCODER_A_PIN, SIM_ENCODER_B_PIN, SIM_ENCODER_Z_PIN, 5);
+	dc_motor motor(LY, SIM_DIR_PIN, SIM_PWM_PIN, 10000, SIM_UPPER_LIMIT_PIN, SIM_LOWER_LIMIT_PIN, &encoder);
+	motor.set_constants(103.59, kff, kp, kd);
+	motor.set_friction_feedforward(SIM_FRICTION_UP, SIM_FRICTION_DOWN);
+	motor.set_homing_parameters(SIM_LIMIT_WIDTH, SIM_WORKSPACE_WIDTH, 65, 45);
+	motor.set_distance_file(position_file);
+	motor.set_velocity_file(velocity_file);
+	motor.set_recorder(&events);
+
+	motor_plant plant(y_plant_params(SIM_LIMIT_WIDTH));
+	plant.set_position((SIM_LIMIT_WIDTH - SIM_WORKSPACE_WIDTH)/2);
+	sim_plant axis(&plant, SIM_PWM_PIN, SIM_DIR_PIN, SIM_ENCODER_A_PIN, SIM_ENCODER_B_PIN,
+	               SIM_UPPER_LIMIT_PIN, SIM_LOWER_LIMIT_PIN);
+	if (axis.attach() != 0)
+		return 1;
+
+	// What homing would have measured
+	encoder.resetCount();
+	motor.count_per_meter = plant.count_per_meter();
+	motor.workspace_width_count = SIM_WORKSPACE_WIDTH * motor.count_per_meter;
+	motor.home_flag = true;
+
+	telemetry_writer telemetry_log;
+	telemetry_log.add_channel(&motor.telemetry, "LY");
+	telemetry_log.set_event_log(&events);
+	telemetry_log.start();
+
+	uint64_t sim_start = sim_now();
+	double wall_start = wall_ms();
+	motor.run_pdff_path(mono_tick(), 0);
+	double wall = wall_ms() - wall_start;
+	double simulated = (sim_now() - sim_start) / 1000.0;
+	telemetry_log.stop();
+
+	printf("Kff %.2f Kp %.2f Kd %.2f: tracking error rms %.2f mm, max %.2f mm over %u samples\n",
+	       kff, kp, kd, motor.tracking.rms()*1000, motor.tracking.max_abs*1000, motor.tracking.samples);
+	printf("Simulated %.1f ms in %.1f ms (%.0fx real time)\n", simulated, wall, (wall > 0) ? simulated/wall : 0);
+
+	axis.detach();
+	mono_clock_stop();
+	hal_terminate();
+	return 0;
+}
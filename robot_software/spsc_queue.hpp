@@ -0,0 +1,84 @@
+/* spsc_queue.hpp
+
+   Created 10/16/2026
+
+   This is the header file for the spsc_queue class template.
+
+   A spsc_queue is a bounded first-in first-out queue for exactly one
+   producer thread and one consumer thread. Neither side ever blocks: push()
+   fails when the queue is full and pop() fails when it is empty. The head
+   and tail indices each live on their own cache line. Capacity must be a
+   power of two. Nothing that is successfully pushed is ever overwritten
+   before it is popped.
+*/
+
+#ifndef __SPSC_QUEUE_HPP__
+#define __SPSC_QUEUE_HPP__
+
+#include <stdint.h>
+#include <atomic>
+#include "cache_line.hpp"
+
+template <typename T, unsigned Capacity>
+class spsc_queue
+{
+public:
+
+	// Default Constructor
+	spsc_queue()
+	{
+		head.store(0, std::memory_order_relaxed);
+		tail.store(0, std::memory_order_relaxed);
+	}
+
+	// PRODUCER ONLY: Add an item. Returns false if the queue is full.
+	bool push(const T& item)
+	{
+		uint32_t h = head.load(std::memory_order_relaxed);
+		if ((h - tail.load(std::memory_order_acquire)) >= Capacity)
+			return(false);
+		slots[h & (Capacity - 1)] = item;
+		head.store(h + 1, std::memory_order_release);
+		return(true);
+	}
+
+	// CONSUMER ONLY: Take the oldest item. Returns false if empty.
+	bool pop(T& item)
+	{
+		uint32_t t = tail.load(std::memory_order_relaxed);
+		if (t == head.load(std::memory_order_acquire))
+			return(false);
+		item = slots[t & (Capacity - 1)];
+		tail.store(t + 1, std::memory_order_release);
+		return(true);
+	}
+
+	// CONSUMER ONLY: Take up to max items. Returns how many were taken.
+	unsigned pop_many(T* out, unsigned max)
+	{
+		uint32_t t = tail.load(std::memory_order_relaxed);
+		uint32_t available = head.load(std::memory_order_acquire) - t;
+		unsigned n = (available < max) ? available : max;
+		for (unsigned i = 0; i < n; i++)
+			out[i] = slots[(t + i) & (Capacity - 1)];
+		tail.store(t + n, std::memory_order_release);
+		return(n);
+	}
+
+	// Number of items waiting. Only exact when called from one of the two
+	// threads while the other is idle.
+	unsigned size() const
+	{
+		return(head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire));
+	}
+
+private:
+
+	alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> head;
+	alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> tail;
+	alignas(CACHE_LINE_SIZE) T slots[Capacity];
+
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+};
+
+#endif
@@ -0,0 +1,468 @@
+/* sysid.cpp
+
+   Created 10/16/2026
+
+   Fits the motor model of one axis to a telemetry_XX.bin file and writes
+   a parameter file that dc_motor::load_parameters() reads, so an axis can
+   be retuned from a few recorded runs (after a belt change, say) instead
+   of by hand.
+
+   Every control loop iteration records the duty cycle and direction pin
+   next to the measured velocity. With u the duty cycle signed by the
+   direction the motor is driven, the model is
+
+       u(t) = Kff v(t+delay) + Ka a(t+delay) + Fup   (moving up)
+                                              - Fdown (moving down)
+
+   Kff is the velocity feedforward constant, Fup and Fdown the duty cycle
+   it takes to keep moving up and down (the dead-band: Coulomb friction,
+   plus gravity on a Y axis), Ka the duty cycle per m/s^2 of acceleration
+   and delay the time from a duty cycle being written to it showing in the
+   measured velocity. For a given delay the model is linear, so it is fitted
+   by least squares from normal equations summed in one pass over the data,
+   and the delay is the one with the smallest residual out of a scan.
+
+   Acceleration is the slope of the recorded velocity over a few iterations.
+   Iterations where the axis is slower than the minimum velocity (stuck, or
+   turning around) or a limit switch is latched are left out, as are gaps
+   where records were dropped and velocities left over from before the axis
+   stopped.
+
+   Usage: ./sysid [--max-delay US] [--min-velocity M/S] [--margin PWM]
+                  telemetry_LY.bin [motor_LY.txt]
+
+   The parameter file defaults to motor_<axis>.txt. It sets the velocity
+   feedforward constant, the friction feedforward, the homing PWMs (the
+   dead-band plus the margin, so homing keeps moving), the lookahead (the
+   delay) and the direction factor (from which way the motor actually
+   moved for each direction pin level).
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include "telemetry.hpp"
+
+// Delay scan (us)
+#define SYSID_MAX_DELAY_US 5000
+#define SYSID_DELAY_STEP_US 100
+
+// Slower than this (m/s) counts as stopped
+#define SYSID_MIN_VELOCITY 0.02
+
+// Homing PWM above the dead-band
+#define SYSID_HOMING_MARGIN 10
+
+// Iterations either side for the acceleration
+#define SYSID_ACCEL_HALF_WINDOW 2
+
+// Iterations either side for smoothing the velocity and duty cycle
+#define SYSID_SMOOTH_HALF_WINDOW 2
+
+// A longer gap between records (us) starts a new segment
+#define SYSID_MAX_GAP_US 3000
+
+// Fewest samples moving in each direction for a fit
+#define SYSID_MIN_SAMPLES 20
+
+// Model terms: Kff, Ka, Fup, Fdown
+#define SYSID_TERMS 4
+
+using namespace std;
+
+// One contiguous stretch of records
+struct sysid_segment {
+	vector<double> time;      // us from the start of the segment
+	vector<double> velocity;  // m/s
+	vector<double> accel;     // m/s^2
+	vector<double> duty;      // signed by the direction pin, 0 is +
+	vector<char> valid;       // not latched and direction known
+};
+
+struct sysid_fit {
+	double theta[SYSID_TERMS];
+	double delay_us;
+	double rms;
+	double r_squared;
+	uint32_t samples;
+	uint32_t up_samples;
+	uint32_t down_samples;
+};
+
+// Normal equations for one delay
+struct normal_equations {
+	double a[SYSID_TERMS][SYSID_TERMS];
+	double b[SYSID_TERMS];
+	double yy;
+	double y;
+	uint32_t samples;
+	uint32_t up_samples;
+	uint32_t down_samples;
+
+	normal_equations()
+	{
+		memset(this, 0, sizeof(*this));
+	}
+
+	void add(const double x[SYSID_TERMS], double u)
+	{
+		for (int i = 0; i < SYSID_TERMS; i++)
+		{
+			for (int j = 0; j <= i; j++)
+				a[i][j] += x[i]*x[j];
+			b[i] += x[i]*u;
+		}
+		yy += u*u;
+		y += u;
+		samples++;
+	}
+
+	// Solve by Cholesky decomposition. False if singular.
+	bool solve(double theta[SYSID_TERMS]) const
+	{
+		double l[SYSID_TERMS][SYSID_TERMS];
+		for (int i = 0; i < SYSID_TERMS; i++)
+		{
+			for (int j = 0; j <= i; j++)
+			{
+				double sum = a[i][j];
+				for (int k = 0; k < j; k++)
+					sum -= l[i][k]*l[j][k];
+				if (i == j)
+				{
+					if (sum <= 1e-9*a[i][i])
+						return(false);
+					l[i][i] = sqrt(sum);
+				}
+				else
+					l[i][j] = sum / l[j][j];
+			}
+		}
+		double z[SYSID_TERMS];
+		for (int i = 0; i < SYSID_TERMS; i++)
+		{
+			double sum = b[i];
+			for (int k = 0; k < i; k++)
+				sum -= l[i][k]*z[k];
+			z[i] = sum / l[i][i];
+		}
+		for (int i = SYSID_TERMS - 1; i >= 0; i--)
+		{
+			double sum = z[i];
+			for (int k = i + 1; k < SYSID_TERMS; k++)
+				sum -= l[k][i]*theta[k];
+			theta[i] = sum / l[i][i];
+		}
+		return(true);
+	}
+};
+
+static void print_usage(const char* name)
+{
+	printf("Usage: %s [--max-delay US] [--min-velocity M/S] [--margin PWM] <telemetry file> [parameter file]\n", name);
+}
+
+// The smallest position step in the file: one encoder count
+static double count_size(const vector<telemetry_record>& records)
+{
+	double size = 0;
+	for (unsigned i = 1; i < records.size(); i++)
+	{
+		double step = fabs(records[i].position - records[i - 1].position);
+		if ((step > 1e-7) && ((size == 0) || (step < size)))
+			size = step;
+	}
+	return(size);
+}
+
+// Split the records into segments, smooth them and work out the
+// acceleration
+static void build_segments(const vector<telemetry_record>& records, vector<sysid_segment>& segments)
+{
+	double count = count_size(records);
+	sysid_segment* segment = NULL;
+	uint64_t start = 0;
+	uint64_t last = 0;
+	uint64_t last_move = 0;
+	for (unsigned i = 0; i < records.size(); i++)
+	{
+		const telemetry_record& rec = records[i];
+		if (!segment || (rec.flags & TELEMETRY_RUN_START) || (rec.tick <= last) || (rec.tick - last > SYSID_MAX_GAP_US))
+		{
+			segments.push_back(sysid_segment());
+			segment = &segments.back();
+			start = rec.tick;
+			last_move = rec.tick;
+		}
+		else if (rec.position != records[i - 1].position)
+			last_move = rec.tick;
+		uint64_t period = (rec.tick > last) ? (rec.tick - last) : 0;
+		last = rec.tick;
+
+		// The encoder velocity only changes on an edge, so once the axis
+		// stops it keeps its last value. Leave out any velocity the
+		// position has not kept up with for twice the time between counts.
+		bool stale = (count > 0) && (rec.velocity != 0) &&
+		             ((rec.tick - last_move) > 2e6*count/fabs(rec.velocity) + period);
+
+		segment->time.push_back((double) (rec.tick - start));
+		segment->velocity.push_back(rec.velocity);
+		segment->duty.push_back((rec.dir == 1) ? -rec.duty_cycle : rec.duty_cycle);
+		segment->valid.push_back(!(rec.flags & TELEMETRY_LIMIT_LATCHED) && (rec.dir >= 0) && !stale);
+	}
+
+	for (unsigned s = 0; s < segments.size(); s++)
+	{
+		sysid_segment& seg = segments[s];
+		int n = (int) seg.time.size();
+
+		// The same centred moving average on both sides of the model keeps
+		// it linear and takes out the PD feedback's reaction to encoder noise.
+		vector<double> velocity(n), duty(n);
+		for (int i = 0; i < n; i++)
+		{
+			int lo = (i < SYSID_SMOOTH_HALF_WINDOW) ? 0 : (i - SYSID_SMOOTH_HALF_WINDOW);
+			int hi = (i + SYSID_SMOOTH_HALF_WINDOW >= n) ? (n - 1) : (i + SYSID_SMOOTH_HALF_WINDOW);
+			double v = 0, u = 0;
+			for (int k = lo; k <= hi; k++)
+			{
+				v += seg.velocity[k];
+				u += seg.duty[k];
+			}
+			velocity[i] = v / (hi - lo + 1);
+			duty[i] = u / (hi - lo + 1);
+		}
+		seg.velocity.swap(velocity);
+		seg.duty.swap(duty);
+
+		seg.accel.assign(n, 0);
+		for (int i = 0; i < n; i++)
+		{
+			int lo = (i < SYSID_ACCEL_HALF_WINDOW) ? 0 : (i - SYSID_ACCEL_HALF_WINDOW);
+			int hi = (i + SYSID_ACCEL_HALF_WINDOW >= n) ? (n - 1) : (i + SYSID_ACCEL_HALF_WINDOW);
+			if (hi - lo < SYSID_ACCEL_HALF_WINDOW)
+			{
+				seg.valid[i] = 0;
+				continue;
+			}
+			seg.accel[i] = (seg.velocity[hi] - seg.velocity[lo]) / ((seg.time[hi] - seg.time[lo]) * 1e-6);
+		}
+	}
+}
+
+// Sum the normal equations with the velocity and acceleration taken
+// delay_us after each duty cycle
+static void accumulate(const vector<sysid_segment>& segments, double delay_us, double min_velocity, normal_equations& eq)
+{
+	for (unsigned s = 0; s < segments.size(); s++)
+	{
+		const sysid_segment& seg = segments[s];
+		unsigned n = seg.time.size();
+		unsigned j = 0;
+		for (unsigned i = 0; i < n; i++)
+		{
+			if (!seg.valid[i])
+				continue;
+			double t = seg.time[i] + delay_us;
+			while ((j + 1 < n) && (seg.time[j + 1] <= t))
+				j++;
+			if ((j + 1 >= n) || !seg.valid[j] || !seg.valid[j + 1])
+				continue;
+
+			double f = (t - seg.time[j]) / (seg.time[j + 1] - seg.time[j]);
+			double v = seg.velocity[j] + f*(seg.velocity[j + 1] - seg.velocity[j]);
+			if (fabs(v) < min_velocity)
+				continue;
+			double x[SYSID_TERMS];
+			x[0] = v;
+			x[1] = seg.accel[j] + f*(seg.accel[j + 1] - seg.accel[j]);
+			x[2] = (v > 0) ? 1 : 0;
+			x[3] = (v < 0) ? -1 : 0;
+			eq.add(x, seg.duty[i]);
+			if (v > 0)
+				eq.up_samples++;
+			else
+				eq.down_samples++;
+		}
+	}
+}
+
+// Fit at every delay in the scan and keep the best
+static bool fit_model(const vector<sysid_segment>& segments, int max_delay_us, double min_velocity, sysid_fit& best)
+{
+	bool found = false;
+	for (int delay = 0; delay <= max_delay_us; delay += SYSID_DELAY_STEP_US)
+	{
+		normal_equations eq;
+		accumulate(segments, delay, min_velocity, eq);
+		if ((eq.up_samples < SYSID_MIN_SAMPLES) || (eq.down_samples < SYSID_MIN_SAMPLES))
+			continue;
+
+		double theta[SYSID_TERMS];
+		if (!eq.solve(theta))
+			continue;
+
+		// At the least squares solution the residual is y'y - theta'b
+		double residual = eq.yy;
+		for (int i = 0; i < SYSID_TERMS; i++)
+			residual -= theta[i]*eq.b[i];
+		if (residual < 0)
+			residual = 0;
+		double rms = sqrt(residual / eq.samples);
+		if (found && (rms >= best.rms))
+			continue;
+
+		found = true;
+		memcpy(best.theta, theta, sizeof(theta));
+		best.delay_us = delay;
+		best.rms = rms;
+		double total = eq.yy - eq.y*eq.y/eq.samples;
+		best.r_squared = (total > 0) ? (1 - residual/total) : 0;
+		best.samples = eq.samples;
+		best.up_samples = eq.up_samples;
+		best.down_samples = eq.down_samples;
+	}
+	return(found);
+}
+
+static int homing_pwm(double dead_band, int margin)
+{
+	int pwm = (int) ceil(dead_band) + margin;
+	if (pwm < margin)
+		pwm = margin;
+	return((pwm > 255) ? 255 : pwm);
+}
+
+int main(int argc, char *argv[])
+{
+	int max_delay_us = SYSID_MAX_DELAY_US;
+	double min_velocity = SYSID_MIN_VELOCITY;
+	int margin = SYSID_HOMING_MARGIN;
+	const char* telemetry_file = NULL;
+	string parameter_file;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if ((strcmp(argv[i], "--max-delay") == 0) && (i + 1 < argc))
+			max_delay_us = atoi(argv[++i]);
+		else if ((strcmp(argv[i], "--min-velocity") == 0) && (i + 1 < argc))
+			min_velocity = atof(argv[++i]);
+		else if ((strcmp(argv[i], "--margin") == 0) && (i + 1 < argc))
+			margin = atoi(argv[++i]);
+		else if (argv[i][0] == '-')
+		{
+			print_usage(argv[0]);
+			return 1;
+		}
+		else if (!telemetry_file)
+			telemetry_file = argv[i];
+		else
+			parameter_file = argv[i];
+	}
+	if (!telemetry_file)
+	{
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	FILE* file = fopen(telemetry_file, "rb");
+	if (!file)
+	{
+		printf("Could not open %s\n", telemetry_file);
+		return 1;
+	}
+
+	telemetry_file_header header;
+	if ((fread(&header, sizeof(header), 1, file) != 1) || (memcmp(header.magic, TELEMETRY_MAGIC, 4) != 0))
+	{
+		printf("%s is not a telemetry file.\n", telemetry_file);
+		fclose(file);
+		return 1;
+	}
+
+	if (header.record_size != sizeof(telemetry_record))
+	{
+		printf("Record size %d does not match this build (%d).\n", header.record_size, (int) sizeof(telemetry_record));
+		fclose(file);
+		return 1;
+	}
+
+	vector<telemetry_record> records;
+	telemetry_record rec;
+	while (fread(&rec, sizeof(rec), 1, file) == 1)
+		records.push_back(rec);
+	fclose(file);
+
+	string axis_name(header.axis_name, strnlen(header.axis_name, sizeof(header.axis_name)));
+	if (parameter_file.empty())
+		parameter_file = "motor_" + axis_name + ".txt";
+
+	struct timespec fit_start, fit_end;
+	clock_gettime(CLOCK_MONOTONIC, &fit_start);
+
+	vector<sysid_segment> segments;
+	build_segments(records, segments);
+
+	sysid_fit fit = sysid_fit();
+	if (!fit_model(segments, max_delay_us, min_velocity, fit))
+	{
+		printf("Not enough movement in %s to fit: need %d iterations faster than %.3f m/s each way.\n",
+		       telemetry_file, SYSID_MIN_SAMPLES, min_velocity);
+		return 1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &fit_end);
+	double fit_ms = (fit_end.tv_sec - fit_start.tv_sec)*1000.0 + (fit_end.tv_nsec - fit_start.tv_nsec)/1000000.0;
+
+	// The motor moved the other way from what the direction pin was meant
+	// to do, so every term came out negated.
+	int direction_factor = 1;
+	if (fit.theta[0] < 0)
+	{
+		direction_factor = -1;
+		for (int i = 0; i < SYSID_TERMS; i++)
+			fit.theta[i] = -fit.theta[i];
+	}
+
+	double kff = fit.theta[0];
+	double ka = fit.theta[1];
+	double friction_up = fit.theta[2];
+	double friction_down = fit.theta[3];
+
+	printf("%s (%s): %u records in %u segments, %u used (%u up, %u down), fitted in %.1f ms\n",
+	       telemetry_file, axis_name.c_str(), (unsigned) records.size(), (unsigned) segments.size(),
+	       fit.samples, fit.up_samples, fit.down_samples, fit_ms);
+	printf("  Velocity feedforward  %8.2f duty cycle per m/s\n", kff);
+	printf("  Acceleration          %8.3f duty cycle per m/s^2\n", ka);
+	printf("  Dead-band up          %8.2f duty cycle\n", friction_up);
+	printf("  Dead-band down        %8.2f duty cycle\n", friction_down);
+	printf("  (friction %.2f, gravity %.2f)\n", (friction_up + friction_down)/2, (friction_up - friction_down)/2);
+	printf("  Delay                 %8.0f us\n", fit.delay_us);
+	printf("  Direction factor      %8d\n", direction_factor);
+	printf("  Residual %.2f duty cycle rms, R^2 %.4f\n", fit.rms, fit.r_squared);
+
+	FILE* out = fopen(parameter_file.c_str(), "w");
+	if (!out)
+	{
+		printf("Could not write %s\n", parameter_file.c_str());
+		return 1;
+	}
+	fprintf(out, "# Motor parameters for %s fitted by sysid from %s\n", axis_name.c_str(), telemetry_file);
+	fprintf(out, "# %u samples, residual %.2f duty cycle rms, R^2 %.4f\n", fit.samples, fit.rms, fit.r_squared);
+	fprintf(out, "# Acceleration %.3f duty cycle per m/s^2 (not used by the controller)\n", ka);
+	fprintf(out, "velocity_feedforward_constant %.3f\n", kff);
+	fprintf(out, "friction_up %.3f\n", friction_up);
+	fprintf(out, "friction_down %.3f\n", friction_down);
+	fprintf(out, "up_pwm %d\n", homing_pwm(friction_up, margin));
+	fprintf(out, "down_pwm %d\n", homing_pwm(friction_down, margin));
+	fprintf(out, "lookahead_us %.0f\n", fit.delay_us);
+	fprintf(out, "direction_factor %d\n", direction_factor);
+	fclose(out);
+
+	printf("Wrote %s\n", parameter_file.c_str());
+	return 0;
+}
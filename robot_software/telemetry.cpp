@@ -0,0 +1,207 @@
+/* telemetry.cpp
+
+   Created 10/16/2026
+
+   This is the cpp file holding the function definitions for the
+   telemetry_channel and telemetry_writer classes. See telemetry.hpp.
+*/
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include "telemetry.hpp"
+#include "telemetry_stream.hpp"
+#include "event_log.hpp"
+
+using namespace std;
+
+// Records copied out of a channel per write
+#define TELEMETRY_WRITE_BATCH 256
+
+// Default Constructor
+telemetry_channel::telemetry_channel()
+{
+	dropped.store(0);
+	recorded = 0;
+	file = NULL;
+	pending_flags = 0;
+}
+
+void telemetry_channel::record(const telemetry_record& rec)
+{
+	if (pending_flags)
+	{
+		telemetry_record first = rec;
+		first.flags |= pending_flags;
+		if (queue.push(first))
+		{
+			pending_flags = 0;
+			recorded++;
+		}
+		else
+			dropped.fetch_add(1, memory_order_relaxed);
+		return;
+	}
+
+	if (queue.push(rec))
+		recorded++;
+	else
+		dropped.fetch_add(1, memory_order_relaxed);
+}
+
+void telemetry_channel::mark_run_start()
+{
+	pending_flags |= TELEMETRY_RUN_START;
+}
+
+void telemetry_channel::mark_cycle_start()
+{
+	pending_flags |= TELEMETRY_CYCLE_START;
+}
+
+// Default Constructor
+telemetry_writer::telemetry_writer()
+{
+	channel_count = 0;
+	stream = NULL;
+	events = NULL;
+	running.store(false);
+	started = false;
+}
+
+// Destructor
+telemetry_writer::~telemetry_writer()
+{
+	this->stop();
+}
+
+void telemetry_writer::add_channel(telemetry_channel* channel, string name)
+{
+	if (channel_count >= MAX_TELEMETRY_CHANNELS)
+	{
+		printf("Too many telemetry channels. Ignoring %s.\n", name.c_str());
+		return;
+	}
+	channel->name = name;
+	channels[channel_count++] = channel;
+}
+
+void telemetry_writer::set_stream(telemetry_stream* stream)
+{
+	this->stream = stream;
+}
+
+void telemetry_writer::set_event_log(event_recorder* events)
+{
+	this->events = events;
+}
+
+int telemetry_writer::start()
+{
+	for (int i = 0; i < channel_count; i++)
+	{
+		string filename = "telemetry_" + channels[i]->name + ".bin";
+		channels[i]->file = fopen(filename.c_str(), "wb");
+		if (!(channels[i]->file))
+		{
+			printf("Telemetry file %s failed to open.\n", filename.c_str());
+			continue;
+		}
+
+		telemetry_file_header header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, TELEMETRY_MAGIC, 4);
+		header.version = TELEMETRY_VERSION;
+		header.record_size = sizeof(telemetry_record);
+		strncpy(header.axis_name, channels[i]->name.c_str(), sizeof(header.axis_name));
+		fwrite(&header, sizeof(header), 1, channels[i]->file);
+	}
+
+	// Without the log there is nothing to replay, but the robot still runs.
+	if (events && events->open("events.bin"))
+		events = NULL;
+
+	running.store(true);
+	if (pthread_create(&thread, NULL, _static_run, this) != 0)
+	{
+		printf("Telemetry writer failed to start.\n");
+		running.store(false);
+		return(1);
+	}
+	started = true;
+	return(0);
+}
+
+void telemetry_writer::stop()
+{
+	if (started)
+	{
+		running.store(false);
+		pthread_join(thread, NULL);
+		started = false;
+		if (stream)
+			stream->print_stats();
+	}
+
+	for (int i = 0; i < channel_count; i++)
+	{
+		if (channels[i]->file)
+		{
+			fclose(channels[i]->file);
+			channels[i]->file = NULL;
+			unsigned long long dropped = channels[i]->dropped.load();
+			if (dropped)
+				printf("Telemetry %s dropped %llu records.\n", channels[i]->name.c_str(), dropped);
+		}
+	}
+
+	if (events)
+		events->close();
+}
+
+void* telemetry_writer::_static_run(void *userdata)
+{
+	telemetry_writer *Self = (telemetry_writer *) userdata;
+	Self->run();
+	return(NULL);
+}
+
+void telemetry_writer::run()
+{
+	// Stay out of the way of the control and encoder threads.
+	setpriority(PRIO_PROCESS, syscall(SYS_gettid), 10);
+
+	while (running.load())
+	{
+		this->drain();
+		usleep(TELEMETRY_DRAIN_US);
+	}
+
+	// Pick up anything recorded after the last pass.
+	this->drain();
+}
+
+void telemetry_writer::drain()
+{
+	telemetry_record batch[TELEMETRY_WRITE_BATCH];
+
+	for (int i = 0; i < channel_count; i++)
+	{
+		unsigned n;
+		while ((n = channels[i]->queue.pop_many(batch, TELEMETRY_WRITE_BATCH)) > 0)
+		{
+			if (channels[i]->file)
+				fwrite(batch, sizeof(telemetry_record), n, channels[i]->file);
+			if (stream)
+				stream->add(i, channels[i]->name, batch, n);
+		}
+		if (channels[i]->file)
+			fflush(channels[i]->file);
+		if (stream)
+			stream->flush(i);
+	}
+
+	if (events)
+		events->drain();
+}
@@ -0,0 +1,166 @@
+/* telemetry.hpp
+
+   Created 10/16/2026
+
+   This is the header file for the telemetry classes.
+
+   Every control loop iteration records a telemetry_record into its axis's
+   telemetry_channel, which is a lock-free queue, so recording never blocks
+   and never allocates. A single low-priority telemetry_writer thread drains
+   all the channels every few milliseconds and appends the records to one
+   binary file per axis while the robot is moving. Memory use is fixed no
+   matter how long the session runs. If the writer ever falls behind, new
+   records are dropped and counted rather than stalling the control loop.
+
+   File layout (little endian, as written by the Pi):
+     telemetry_file_header
+     telemetry_record, telemetry_record, ...
+   The first record of every run has TELEMETRY_RUN_START set in flags.
+
+   The writer can also send a decimated copy of the records out over UDP
+   as it drains them (set_stream, telemetry_stream.hpp), and write out the
+   event log (set_event_log, event_log.hpp).
+*/
+
+#ifndef __TELEMETRY_HPP__
+#define __TELEMETRY_HPP__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <atomic>
+#include <string>
+#include "spsc_queue.hpp"
+
+#define TELEMETRY_MAGIC "JRTL"
+#define TELEMETRY_VERSION 2
+
+// Records buffered per axis. At 2 kHz this is about a second of slack.
+#define TELEMETRY_QUEUE_SIZE 2048
+
+// How often the writer drains the channels (microseconds)
+#define TELEMETRY_DRAIN_US 5000
+
+#define MAX_TELEMETRY_CHANNELS 4
+
+class telemetry_stream;
+class event_recorder;
+
+// telemetry_record flags
+#define TELEMETRY_LIMIT_LATCHED 0x01
+#define TELEMETRY_RUN_START 0x02
+#define TELEMETRY_CYCLE_START 0x04
+#define TELEMETRY_ALERT_RACE 0x08  // an alert ran while the state was read
+
+// One control loop iteration. Positions in meters, velocities in m/s.
+struct telemetry_record {
+	uint64_t tick;
+	float desired_position;
+	float desired_velocity;
+	float position;
+	float velocity;
+	float control_effort;
+	int16_t duty_cycle;
+	int8_t dir;
+	uint8_t flags;
+	uint32_t alert_sequence;   // event_log.hpp, 0 when not recording
+} __attribute__((packed));
+
+struct telemetry_file_header {
+	char magic[4];
+	uint16_t version;
+	uint16_t record_size;
+	char axis_name[4];
+} __attribute__((packed));
+
+class telemetry_channel
+{
+public:
+
+	// Records waiting to be written
+	spsc_queue<telemetry_record, TELEMETRY_QUEUE_SIZE> queue;
+
+	// Records dropped because the queue was full
+	std::atomic<uint64_t> dropped;
+
+	// Records queued so far. Only touched by the control thread.
+	uint64_t recorded;
+
+	// Name used in the file header and file name
+	std::string name;
+
+	// Output file, owned by the writer thread
+	FILE* file;
+
+	// Default Constructor
+	telemetry_channel();
+
+	// CONTROL THREAD: Record one iteration. Never blocks.
+	void record(const telemetry_record& rec);
+
+	// CONTROL THREAD: The next record starts a new run.
+	void mark_run_start();
+
+	// CONTROL THREAD: The next record starts a new cycle of a streaming run.
+	void mark_cycle_start();
+
+private:
+
+	// Flags for the next record
+	uint8_t pending_flags;
+
+	// Disable default copy constructor, and assignment operator
+	telemetry_channel(const telemetry_channel&);
+	telemetry_channel& operator=(const telemetry_channel&);
+};
+
+class telemetry_writer
+{
+public:
+
+	// Default Constructor
+	telemetry_writer();
+
+	// Destructor
+	~telemetry_writer();
+
+	// Add a channel, written to telemetry_<name>.bin. Call before start().
+	void add_channel(telemetry_channel* channel, std::string name);
+
+	// Also stream the records over UDP. Call before start().
+	void set_stream(telemetry_stream* stream);
+
+	// Also write an event log to events.bin. Call before start().
+	void set_event_log(event_recorder* events);
+
+	// Open the files and start the writer thread
+	int start();
+
+	// Write everything left and stop the thread
+	void stop();
+
+	// Writer thread entry point
+	static void* _static_run(void *userdata);
+
+private:
+
+	// Write out whatever is waiting in each channel
+	void drain();
+
+	void run();
+
+	telemetry_channel* channels[MAX_TELEMETRY_CHANNELS];
+	int channel_count;
+
+	// Live UDP copy, or NULL
+	telemetry_stream* stream;
+
+	// Event log, or NULL
+	event_recorder* events;
+
+	pthread_t thread;
+	std::atomic<bool> running;
+	bool started;
+};
+
+#endif
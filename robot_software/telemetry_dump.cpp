@@ -0,0 +1,67 @@
+/* telemetry_dump.cpp
+
+   Created 10/16/2026
+
+   Prints a telemetry_XX.bin file written by telemetry_writer as comma
+   separated text, one control loop iteration per line, so it can be loaded
+   into MATLAB or a spreadsheet.
+
+   Usage: ./telemetry_dump telemetry_LY.bin > LY.csv
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "telemetry.hpp"
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2)
+	{
+		printf("Usage: %s <telemetry file>\n", argv[0]);
+		return 1;
+	}
+
+	FILE* file = fopen(argv[1], "rb");
+	if (!file)
+	{
+		printf("Could not open %s\n", argv[1]);
+		return 1;
+	}
+
+	telemetry_file_header header;
+	if ((fread(&header, sizeof(header), 1, file) != 1) || (memcmp(header.magic, TELEMETRY_MAGIC, 4) != 0))
+	{
+		printf("%s is not a telemetry file.\n", argv[1]);
+		fclose(file);
+		return 1;
+	}
+
+	if (header.record_size != sizeof(telemetry_record))
+	{
+		printf("Record size %d does not match this build (%d).\n", header.record_size, (int) sizeof(telemetry_record));
+		fclose(file);
+		return 1;
+	}
+
+	printf("run,cycle,tick,desired_position,desired_velocity,position,velocity,control_effort,duty_cycle,dir,limit\n");
+
+	telemetry_record rec;
+	int run = 0;
+	int cycle = 0;
+	while (fread(&rec, sizeof(rec), 1, file) == 1)
+	{
+		if (rec.flags & TELEMETRY_RUN_START)
+		{
+			run++;
+			cycle = 0;
+		}
+		if (rec.flags & TELEMETRY_CYCLE_START)
+			cycle++;
+		printf("%d,%d,%llu,%f,%f,%f,%f,%f,%d,%d,%d\n", run, cycle, (unsigned long long) rec.tick,
+		       rec.desired_position, rec.desired_velocity, rec.position, rec.velocity,
+		       rec.control_effort, rec.duty_cycle, rec.dir, (rec.flags & TELEMETRY_LIMIT_LATCHED) ? 1 : 0);
+	}
+
+	fclose(file);
+	return 0;
+}
@@ -0,0 +1,196 @@
+/* telemetry_live.cpp
+
+   Created 10/16/2026
+
+   Receives the live telemetry stream (telemetry_stream.hpp) and prints it
+   as comma separated text, one sample per line, the same columns as
+   telemetry_dump plus the axis and the loop period range. Pipe it into a
+   file, or into a live plotter such as feedgnuplot.
+
+   With --summary it prints one line per axis per second instead: tracking
+   error, duty cycle range and loop period range, which is easier to watch
+   while tuning.
+
+   Usage: ./telemetry_live [--summary] <port> [axis]
+
+   Lost packets are reported on stderr.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <cmath>
+#include <string>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include "telemetry_stream.hpp"
+
+using namespace std;
+
+// One second of one axis, for --summary
+struct axis_summary {
+	char name[5];
+	bool seen;
+	uint32_t next_sequence;
+	uint64_t window_start;
+	uint32_t samples;
+	double sum_squares;
+	double max_error;
+	int min_duty;
+	int max_duty;
+	int min_period;
+	int max_period;
+};
+
+static void reset_summary(axis_summary& summary, uint64_t tick)
+{
+	summary.window_start = tick;
+	summary.samples = 0;
+	summary.sum_squares = 0;
+	summary.max_error = 0;
+	summary.min_duty = 255;
+	summary.max_duty = -255;
+	summary.min_period = 65535;
+	summary.max_period = 0;
+}
+
+static void print_summary(const axis_summary& summary)
+{
+	if (summary.samples == 0)
+		return;
+	printf("%-4s %4u samples  error rms %.4f max %.4f m  duty %d..%d  period %d..%d us\n",
+	       summary.name, summary.samples, sqrt(summary.sum_squares/summary.samples), summary.max_error,
+	       summary.min_duty, summary.max_duty, summary.min_period, summary.max_period);
+	fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+	bool summary_mode = (argc > 1) && (strcmp(argv[1], "--summary") == 0);
+	int arg = summary_mode ? 2 : 1;
+	if (arg >= argc)
+	{
+		printf("Usage: %s [--summary] <port> [axis]\n", argv[0]);
+		return 1;
+	}
+	string port = argv[arg];
+	string only_axis = (argc > arg + 1) ? argv[arg + 1] : "";
+
+	struct addrinfo hints, *servinfo, *p;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_DGRAM;
+	hints.ai_flags = AI_PASSIVE;
+	int rv;
+	if ((rv = getaddrinfo(NULL, port.c_str(), &hints, &servinfo)) != 0)
+	{
+		printf("getaddrinfo: %s\n", gai_strerror(rv));
+		return 1;
+	}
+	int sockfd = -1;
+	for (p = servinfo; p != NULL; p = p->ai_next)
+	{
+		if ((sockfd = socket(p->ai_family, p->ai_socktype, p->ai_protocol)) == -1)
+			continue;
+		if (bind(sockfd, p->ai_addr, p->ai_addrlen) == 0)
+			break;
+		close(sockfd);
+		sockfd = -1;
+	}
+	freeaddrinfo(servinfo);
+	if (sockfd < 0)
+	{
+		printf("Could not bind port %s\n", port.c_str());
+		return 1;
+	}
+
+	axis_summary axes[MAX_TELEMETRY_CHANNELS];
+	memset(axes, 0, sizeof(axes));
+	int axis_count = 0;
+
+	if (!summary_mode)
+		printf("axis,tick,desired_position,desired_velocity,position,velocity,control_effort,duty_cycle,flags,period_min_us,period_max_us\n");
+
+	char buf[65536];
+	while (true)
+	{
+		ssize_t length = recv(sockfd, buf, sizeof(buf), 0);
+		if (length < (ssize_t) sizeof(telemetry_stream_header))
+			continue;
+
+		telemetry_stream_header header;
+		memcpy(&header, buf, sizeof(header));
+		if ((memcmp(header.magic, TELEMETRY_STREAM_MAGIC, 4) != 0) || (header.version != TELEMETRY_STREAM_VERSION) ||
+		    (header.sample_size != sizeof(telemetry_stream_sample)) ||
+		    (length < (ssize_t) (sizeof(header) + header.count*sizeof(telemetry_stream_sample))))
+			continue;
+
+		char name[5];
+		memcpy(name, header.axis_name, 4);
+		name[4] = '\0';
+		if (!only_axis.empty() && (only_axis != name))
+			continue;
+
+		// Find this axis, or start following it.
+		int a;
+		for (a = 0; a < axis_count; a++)
+		{
+			if (strcmp(axes[a].name, name) == 0)
+				break;
+		}
+		if (a == axis_count)
+		{
+			if (axis_count == MAX_TELEMETRY_CHANNELS)
+				continue;
+			strcpy(axes[a].name, name);
+			axis_count++;
+		}
+		axis_summary& axis = axes[a];
+
+		if (axis.seen && (header.sequence != axis.next_sequence))
+			fprintf(stderr, "%s: lost %d packets\n", name, (int) (header.sequence - axis.next_sequence));
+		axis.next_sequence = header.sequence + 1;
+
+		for (int i = 0; i < header.count; i++)
+		{
+			telemetry_stream_sample sample;
+			memcpy(&sample, buf + sizeof(header) + i*sizeof(sample), sizeof(sample));
+
+			if (!summary_mode)
+			{
+				printf("%s,%llu,%f,%f,%f,%f,%f,%d,%d,%d,%d\n", name, (unsigned long long) sample.tick,
+				       sample.desired_position, sample.desired_velocity, sample.position, sample.velocity,
+				       sample.control_effort, sample.duty_cycle, sample.flags, sample.period_min_us, sample.period_max_us);
+				continue;
+			}
+
+			if (!axis.seen || (sample.tick - axis.window_start >= 1000000))
+			{
+				if (axis.seen)
+					print_summary(axis);
+				reset_summary(axis, sample.tick);
+			}
+			axis.seen = true;
+
+			double error = sample.desired_position - sample.position;
+			axis.sum_squares += error*error;
+			if (fabs(error) > axis.max_error)
+				axis.max_error = fabs(error);
+			if (sample.duty_cycle < axis.min_duty)
+				axis.min_duty = sample.duty_cycle;
+			if (sample.duty_cycle > axis.max_duty)
+				axis.max_duty = sample.duty_cycle;
+			if ((sample.period_min_us > 0) && (sample.period_min_us < axis.min_period))
+				axis.min_period = sample.period_min_us;
+			if (sample.period_max_us > axis.max_period)
+				axis.max_period = sample.period_max_us;
+			axis.samples++;
+		}
+		axis.seen = true;
+		if (!summary_mode)
+			fflush(stdout);
+	}
+	return 0;
+}
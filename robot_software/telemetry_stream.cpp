@@ -0,0 +1,170 @@
+/* telemetry_stream.cpp
+
+   Created 10/16/2026
+
+   This is the cpp file holding the function definitions for the
+   telemetry_stream class. See telemetry_stream.hpp.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include "telemetry_stream.hpp"
+
+using namespace std;
+
+// Default Constructor
+telemetry_stream::telemetry_stream()
+{
+	sockfd = -1;
+	decimation = TELEMETRY_STREAM_DECIMATION;
+	packets_sent = 0;
+	packets_dropped = 0;
+	memset(channels, 0, sizeof(channels));
+}
+
+// Destructor
+telemetry_stream::~telemetry_stream()
+{
+	this->close();
+}
+
+int telemetry_stream::open(string host, string port, int decimation)
+{
+	struct addrinfo hints, *servinfo, *p;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_DGRAM;
+
+	int rv;
+	if ((rv = getaddrinfo(host.c_str(), port.c_str(), &hints, &servinfo)) != 0)
+	{
+		printf("Telemetry stream: getaddrinfo: %s\n", gai_strerror(rv));
+		return(1);
+	}
+
+	// A connected UDP socket, so each packet is a plain send().
+	for (p = servinfo; p != NULL; p = p->ai_next)
+	{
+		if ((sockfd = socket(p->ai_family, p->ai_socktype, p->ai_protocol)) == -1)
+			continue;
+		if (connect(sockfd, p->ai_addr, p->ai_addrlen) == 0)
+			break;
+		::close(sockfd);
+		sockfd = -1;
+	}
+	freeaddrinfo(servinfo);
+
+	if (sockfd < 0)
+	{
+		printf("Telemetry stream: could not reach %s:%s\n", host.c_str(), port.c_str());
+		return(2);
+	}
+
+	this->decimation = (decimation > 0) ? decimation : 1;
+	memset(channels, 0, sizeof(channels));
+	packets_sent = 0;
+	packets_dropped = 0;
+	printf("Streaming telemetry to %s:%s\n", host.c_str(), port.c_str());
+	return(0);
+}
+
+void telemetry_stream::close()
+{
+	if (sockfd >= 0)
+	{
+		::close(sockfd);
+		sockfd = -1;
+	}
+}
+
+bool telemetry_stream::is_open() const
+{
+	return(sockfd >= 0);
+}
+
+void telemetry_stream::add(int index, const string& name, const telemetry_record* records, unsigned n)
+{
+	if ((sockfd < 0) || (index < 0) || (index >= MAX_TELEMETRY_CHANNELS))
+		return;
+
+	channel_state& state = channels[index];
+	if (state.header.magic[0] == 0)
+	{
+		memcpy(state.header.magic, TELEMETRY_STREAM_MAGIC, 4);
+		state.header.version = TELEMETRY_STREAM_VERSION;
+		state.header.sample_size = sizeof(telemetry_stream_sample);
+		strncpy(state.header.axis_name, name.c_str(), sizeof(state.header.axis_name));
+		state.header.decimation = decimation;
+		state.period_min_us = UINT32_MAX;
+	}
+
+	for (unsigned i = 0; i < n; i++)
+	{
+		const telemetry_record& rec = records[i];
+
+		// A new run restarts the period measurement.
+		if ((state.last_tick != 0) && !(rec.flags & TELEMETRY_RUN_START))
+		{
+			uint32_t period = (uint32_t) (rec.tick - state.last_tick);
+			if (period < state.period_min_us)
+				state.period_min_us = period;
+			if (period > state.period_max_us)
+				state.period_max_us = period;
+		}
+		state.last_tick = rec.tick;
+		state.flags |= rec.flags;
+
+		if (++state.since_sample < decimation)
+			continue;
+
+		if (state.header.count >= TELEMETRY_STREAM_MAX_SAMPLES)
+			this->flush(index);
+
+		telemetry_stream_sample& sample = state.samples[state.header.count++];
+		sample.tick = rec.tick;
+		sample.desired_position = rec.desired_position;
+		sample.desired_velocity = rec.desired_velocity;
+		sample.position = rec.position;
+		sample.velocity = rec.velocity;
+		sample.control_effort = rec.control_effort;
+		sample.duty_cycle = rec.duty_cycle;
+		sample.flags = state.flags;
+		sample.reserved = 0;
+		sample.period_min_us = (state.period_min_us > UINT16_MAX) ? 0 : state.period_min_us;
+		sample.period_max_us = (state.period_max_us > UINT16_MAX) ? UINT16_MAX : state.period_max_us;
+
+		state.since_sample = 0;
+		state.flags = 0;
+		state.period_min_us = UINT32_MAX;
+		state.period_max_us = 0;
+	}
+}
+
+void telemetry_stream::flush(int index)
+{
+	if ((sockfd < 0) || (index < 0) || (index >= MAX_TELEMETRY_CHANNELS))
+		return;
+
+	channel_state& state = channels[index];
+	if (state.header.count == 0)
+		return;
+
+	size_t length = sizeof(telemetry_stream_header) + state.header.count*sizeof(telemetry_stream_sample);
+	if (send(sockfd, &(state.header), length, MSG_DONTWAIT) == (ssize_t) length)
+		packets_sent++;
+	else
+		packets_dropped++;
+	state.header.sequence++;
+	state.header.count = 0;
+}
+
+void telemetry_stream::print_stats() const
+{
+	if (packets_sent || packets_dropped)
+		printf("Telemetry stream sent %llu packets, dropped %llu.\n",
+		       (unsigned long long) packets_sent, (unsigned long long) packets_dropped);
+}
@@ -0,0 +1,119 @@
+/* telemetry_stream.hpp
+
+   Created 10/16/2026
+
+   This is the header file for the telemetry_stream class.
+
+   A telemetry_stream sends a decimated copy of the telemetry out over UDP
+   while the robot runs, so a laptop can plot it live (telemetry_live).
+   It is fed by the telemetry_writer thread as it drains the channels, so
+   the control loops never see the socket: they only ever push into their
+   lock-free telemetry queue, as they already do for the files.
+
+   Every TELEMETRY_STREAM_DECIMATION-th record of each axis becomes a
+   sample. A sample also carries the shortest and longest time between the
+   records it stands for, which is the loop jitter over that stretch, and
+   every flag set on any of them. Each drain sends at most one packet per
+   axis with whatever samples it has. Sends never block; a packet the
+   network will not take right now is counted and dropped.
+
+   Packet layout (little endian, as sent by the Pi):
+     telemetry_stream_header
+     telemetry_stream_sample * count
+*/
+
+#ifndef __TELEMETRY_STREAM_HPP__
+#define __TELEMETRY_STREAM_HPP__
+
+#include <stdint.h>
+#include <string>
+#include "telemetry.hpp"
+
+#define TELEMETRY_STREAM_MAGIC "JRTS"
+#define TELEMETRY_STREAM_VERSION 1
+
+// Records per sample. At 2 kHz this streams 200 samples a second per axis.
+#define TELEMETRY_STREAM_DECIMATION 10
+
+// Most samples in one packet
+#define TELEMETRY_STREAM_MAX_SAMPLES 32
+
+struct telemetry_stream_header {
+	char magic[4];
+	uint16_t version;
+	uint16_t sample_size;
+	char axis_name[4];
+	uint32_t sequence;   // per axis, +1 per packet
+	uint16_t count;      // samples in this packet
+	uint16_t decimation;
+} __attribute__((packed));
+
+struct telemetry_stream_sample {
+	uint64_t tick;
+	float desired_position;
+	float desired_velocity;
+	float position;
+	float velocity;
+	float control_effort;
+	int16_t duty_cycle;
+	uint8_t flags;          // every flag since the last sample
+	uint8_t reserved;
+	uint16_t period_min_us; // shortest and longest time between records
+	uint16_t period_max_us; // since the last sample
+} __attribute__((packed));
+
+class telemetry_stream
+{
+public:
+
+	// Default Constructor
+	telemetry_stream();
+
+	// Destructor
+	~telemetry_stream();
+
+	// Send to host:port, keeping one record in every decimation. Returns 0
+	// on success.
+	int open(std::string host, std::string port, int decimation);
+
+	void close();
+
+	bool is_open() const;
+
+	// WRITER THREAD: Records drained from channel index (name is its axis)
+	void add(int index, const std::string& name, const telemetry_record* records, unsigned n);
+
+	// WRITER THREAD: Send what channel index has collected
+	void flush(int index);
+
+	// Print packets sent and dropped
+	void print_stats() const;
+
+private:
+
+	// The header and samples are packed, so they lie back to back and go
+	// out as one packet.
+	struct channel_state {
+		telemetry_stream_header header;
+		telemetry_stream_sample samples[TELEMETRY_STREAM_MAX_SAMPLES];
+		int since_sample;
+		uint64_t last_tick;
+		uint32_t period_min_us;
+		uint32_t period_max_us;
+		uint8_t flags;
+	};
+
+	channel_state channels[MAX_TELEMETRY_CHANNELS];
+
+	int sockfd;
+	int decimation;
+
+	uint64_t packets_sent;
+	uint64_t packets_dropped;
+
+	// Disable default copy constructor and assignment operator
+	telemetry_stream(const telemetry_stream&);
+	telemetry_stream& operator=(const telemetry_stream&);
+};
+
+#endif
@@ -0,0 +1,94 @@
+/* traj_convert.cpp
+
+   Created 10/16/2026
+
+   Converts the position and velocity text files exported by
+   csv_path_export.m (one value per line, one line per sample) into a
+   binary trajectory file that dc_motor can map directly. Acceleration is
+   taken from the velocity by central differences.
+
+   Usage: ./traj_convert <position.txt> <velocity.txt> <output.traj> [sample rate Hz]
+   The sample rate defaults to 1000 Hz (one sample per millisecond).
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "trajectory_file.hpp"
+
+using namespace std;
+
+// Read one value per line
+static int read_column(string filename, vector<double>& values)
+{
+	ifstream myfile(filename.c_str());
+	if (!myfile.is_open())
+	{
+		cout << filename << " failed to open." << endl;
+		return(1);
+	}
+
+	string line;
+	while (getline(myfile, line))
+	{
+		if (line.empty())
+			continue;
+		values.push_back(atof(line.c_str()));
+	}
+	myfile.close();
+	return(0);
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 4)
+	{
+		cout << "Usage: " << argv[0] << " <position.txt> <velocity.txt> <output.traj> [sample rate Hz]" << endl;
+		return 1;
+	}
+
+	uint32_t sample_rate = 1000;
+	if (argc > 4)
+		sample_rate = atoi(argv[4]);
+	if (sample_rate == 0)
+	{
+		cout << "Invalid sample rate." << endl;
+		return 1;
+	}
+
+	vector<double> position;
+	vector<double> velocity;
+	if (read_column(argv[1], position) || read_column(argv[2], velocity))
+		return 1;
+
+	if (position.size() != velocity.size())
+	{
+		cout << "Position has " << position.size() << " samples and velocity has "
+		     << velocity.size() << ". Using the shorter." << endl;
+	}
+	size_t length = (position.size() < velocity.size()) ? position.size() : velocity.size();
+	if (length == 0)
+	{
+		cout << "No samples." << endl;
+		return 1;
+	}
+
+	vector<double> acceleration(length, 0);
+	for (size_t i = 0; i < length; i++)
+	{
+		size_t before = (i > 0) ? (i - 1) : i;
+		size_t after = (i + 1 < length) ? (i + 1) : i;
+		if (after != before)
+			acceleration[i] = (velocity[after] - velocity[before]) * sample_rate / (after - before);
+	}
+
+	if (write_trajectory(argv[3], position.data(), velocity.data(), acceleration.data(),
+	                     length, sample_rate, TRAJ_METERS))
+		return 1;
+
+	cout << "Wrote " << length << " samples at " << sample_rate << " Hz to " << argv[3] << endl;
+	return 0;
+}
@@ -0,0 +1,165 @@
+/* trajectory_file.cpp
+
+   Created 10/16/2026
+
+   This is the cpp file for loading and writing binary trajectory files.
+   See trajectory_file.hpp.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <map>
+#include "trajectory_file.hpp"
+
+using namespace std;
+
+#define FNV_OFFSET_BASIS 2166136261u
+#define FNV_PRIME 16777619u
+
+// Every trajectory mapped so far, by file name
+static map<string, trajectory_file*> loaded_trajectories;
+static pthread_mutex_t trajectory_lock = PTHREAD_MUTEX_INITIALIZER;
+
+uint32_t trajectory_checksum(const void* data, size_t bytes, uint32_t hash)
+{
+	const unsigned char* p = (const unsigned char*) data;
+	for (size_t i = 0; i < bytes; i++)
+	{
+		hash ^= p[i];
+		hash *= FNV_PRIME;
+	}
+	return(hash);
+}
+
+bool is_trajectory_file(string filename)
+{
+	string extension = ".traj";
+	return((filename.size() > extension.size()) &&
+	       (filename.compare(filename.size() - extension.size(), extension.size(), extension) == 0));
+}
+
+// Map and check a file. Returns NULL on failure.
+static trajectory_file* map_trajectory(string filename)
+{
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		printf("Trajectory file %s failed to open.\n", filename.c_str());
+		return(NULL);
+	}
+
+	struct stat st;
+	if ((fstat(fd, &st) != 0) || (st.st_size < (off_t) sizeof(trajectory_header)))
+	{
+		printf("Trajectory file %s is too short.\n", filename.c_str());
+		close(fd);
+		return(NULL);
+	}
+
+	// Populate the mapping up front so the control loop never page faults.
+	void* base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED | MAP_POPULATE, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED)
+	{
+		printf("Trajectory file %s failed to map.\n", filename.c_str());
+		return(NULL);
+	}
+
+	trajectory_header header;
+	memcpy(&header, base, sizeof(header));
+
+	size_t array_bytes = ((size_t) header.length) * sizeof(double);
+	const char* error = NULL;
+	if (memcmp(header.magic, TRAJECTORY_MAGIC, 4) != 0)
+		error = "is not a trajectory file";
+	else if (header.version != TRAJECTORY_VERSION)
+		error = "has an unsupported version";
+	else if ((size_t) st.st_size != sizeof(trajectory_header) + 3*array_bytes)
+		error = "has the wrong size";
+	else if (trajectory_checksum((const char*) base + sizeof(trajectory_header), 3*array_bytes, FNV_OFFSET_BASIS) != header.checksum)
+		error = "failed its checksum";
+
+	if (error)
+	{
+		printf("Trajectory file %s %s.\n", filename.c_str(), error);
+		munmap(base, st.st_size);
+		return(NULL);
+	}
+
+	const double* arrays = (const double*) ((const char*) base + sizeof(trajectory_header));
+	trajectory_file* traj = new trajectory_file;
+	traj->header = header;
+	traj->position = path_view(arrays, header.length);
+	traj->velocity = path_view(arrays + header.length, header.length);
+	traj->acceleration = path_view(arrays + 2*header.length, header.length);
+	traj->filename = filename;
+	return(traj);
+}
+
+const trajectory_file* load_trajectory(string filename)
+{
+	pthread_mutex_lock(&trajectory_lock);
+
+	trajectory_file* traj;
+	map<string, trajectory_file*>::iterator it = loaded_trajectories.find(filename);
+	if (it != loaded_trajectories.end())
+	{
+		traj = it->second;
+	}
+	else
+	{
+		traj = map_trajectory(filename);
+		if (traj)
+			loaded_trajectories[filename] = traj;
+	}
+
+	pthread_mutex_unlock(&trajectory_lock);
+	return(traj);
+}
+
+int write_trajectory(string filename, const double* position, const double* velocity,
+                     const double* acceleration, uint32_t length, uint32_t sample_rate_hz,
+                     trajectory_units units)
+{
+	size_t array_bytes = ((size_t) length) * sizeof(double);
+
+	trajectory_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, TRAJECTORY_MAGIC, 4);
+	header.version = TRAJECTORY_VERSION;
+	header.units = units;
+	header.sample_rate_hz = sample_rate_hz;
+	header.length = length;
+	uint32_t hash = trajectory_checksum(position, array_bytes, FNV_OFFSET_BASIS);
+	hash = trajectory_checksum(velocity, array_bytes, hash);
+	header.checksum = trajectory_checksum(acceleration, array_bytes, hash);
+
+	// Write beside the target and rename it over, so a controller that
+	// has the old file mapped keeps its pages instead of faulting.
+	string temp = filename + ".tmp";
+	FILE* file = fopen(temp.c_str(), "wb");
+	if (!file)
+	{
+		printf("Trajectory file %s failed to open for writing.\n", temp.c_str());
+		return(1);
+	}
+
+	bool ok = (fwrite(&header, sizeof(header), 1, file) == 1);
+	ok = ok && (fwrite(position, sizeof(double), length, file) == length);
+	ok = ok && (fwrite(velocity, sizeof(double), length, file) == length);
+	ok = ok && (fwrite(acceleration, sizeof(double), length, file) == length);
+	ok = (fclose(file) == 0) && ok;
+
+	if (!ok || (rename(temp.c_str(), filename.c_str()) != 0))
+	{
+		printf("Failed writing trajectory file %s.\n", filename.c_str());
+		unlink(temp.c_str());
+		return(1);
+	}
+	return(0);
+}
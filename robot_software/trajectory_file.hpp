@@ -0,0 +1,85 @@
+/* trajectory_file.hpp
+
+   Created 10/16/2026
+
+   This is the header file for the binary trajectory file format.
+
+   A trajectory file holds a path sampled at a fixed rate, as packed arrays
+   of doubles, so it can be mmap'ed and used in place with no parsing:
+
+     trajectory_header            (24 bytes)
+     double position[length]
+     double velocity[length]
+     double acceleration[length]
+
+   The checksum is a 32 bit FNV-1a hash over the three arrays. Files are
+   mapped read-only and shared, so several axes (and hundreds of stored
+   trajectories) cost one mapping each. The traj_convert tool makes these
+   files from the text files exported by csv_path_export.m.
+*/
+
+#ifndef __TRAJECTORY_FILE_HPP__
+#define __TRAJECTORY_FILE_HPP__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+#define TRAJECTORY_MAGIC "JRTJ"
+#define TRAJECTORY_VERSION 1
+
+// Units of the position arrays
+enum trajectory_units {TRAJ_METERS = 0, TRAJ_RADIANS = 1};
+
+struct trajectory_header {
+	char magic[4];
+	uint16_t version;
+	uint16_t units;
+	uint32_t sample_rate_hz;
+	uint32_t length;
+	uint32_t checksum;
+	uint32_t reserved;
+} __attribute__((packed));
+
+// A read-only run of samples. Either points into a mapped trajectory file
+// or into a vector owned by someone else.
+struct path_view {
+	const double* data;
+	uint32_t length;
+
+	path_view() : data(NULL), length(0) {}
+	path_view(const double* d, uint32_t n) : data(d), length(n) {}
+
+	bool empty() const { return(length == 0); }
+	uint32_t size() const { return(length); }
+	double operator[](uint32_t i) const { return(data[i]); }
+};
+
+// A mapped trajectory file
+struct trajectory_file {
+	trajectory_header header;
+	path_view position;
+	path_view velocity;
+	path_view acceleration;
+	std::string filename;
+};
+
+// Map a trajectory file, or return the existing mapping if it is already
+// loaded. Returns NULL (and prints why) if the file is missing or corrupt.
+// Mappings stay for the life of the program.
+const trajectory_file* load_trajectory(std::string filename);
+
+// Write a trajectory file. It goes to filename.tmp first and is renamed
+// over filename, so anything that has the old file mapped keeps reading
+// it. Returns 0 on success.
+int write_trajectory(std::string filename, const double* position, const double* velocity,
+                     const double* acceleration, uint32_t length, uint32_t sample_rate_hz,
+                     trajectory_units units);
+
+// FNV-1a over a block of memory, continuing from hash
+uint32_t trajectory_checksum(const void* data, size_t bytes, uint32_t hash);
+
+// True if the file name ends in .traj
+bool is_trajectory_file(std::string filename);
+
+#endif
@@ -17,6 +17,8 @@
 */
 
 #include "udp_connection.hpp"
+#include "mono_clock.hpp"
+#include "event_log.hpp"
 
 using namespace std;
 
@@ -25,9 +27,16 @@ udp_connection::udp_connection()
 {
 	track_flag = false;
 	listener_flag = false;
-	pthread_t* listener = NULL;
+	listener_started = false;
+	stop_fd = -1;
 	sockfd = 0;
-
+	memset(&latest, 0, sizeof(latest));
+	memset(&link_stats, 0, sizeof(link_stats));
+	have_sequence = false;
+	last_sequence = 0;
+	floor_tick = 0;
+	catch_height = CV_CATCH_HEIGHT;
+	recorder = NULL;
 }
 
 // Constructor
@@ -36,28 +45,43 @@ udp_connection::udp_connection(string portNumber)
     printf("UDP constructor.");
 	track_flag = false;
 	listener_flag = false;
-	pthread_t* listener = NULL;
+	listener_started = false;
+	stop_fd = -1;
 	sockfd = 0;
 	port_no = portNumber;
-	pthread_mutex_init(&LX_lock, NULL);
-	pthread_mutex_init(&RX_lock, NULL);
+	memset(&latest, 0, sizeof(latest));
+	memset(&link_stats, 0, sizeof(link_stats));
+	have_sequence = false;
+	last_sequence = 0;
+	floor_tick = 0;
+	catch_height = CV_CATCH_HEIGHT;
+	recorder = NULL;
 }
 
 // Destructor
 udp_connection::~udp_connection()
 {
 	this->kill_connection();
-	pthread_mutex_destroy(&LX_lock);
-	pthread_mutex_destroy(&RX_lock);
 }
 
 void udp_connection::kill_connection()
 {
-	if(listener)
-		{
-			gpioStopThread(listener);
-			listener = NULL;
-		}
+	// Wake the listener up through the eventfd and wait for it to finish.
+	if(listener_started)
+	{
+		uint64_t one = 1;
+		if (write(stop_fd, &one, sizeof(one)) != sizeof(one))
+			perror("ERROR: stopping listener");
+		pthread_join(listener, NULL);
+		listener_started = false;
+		this->print_stats();
+	}
+
+	if(stop_fd >= 0)
+	{
+		close(stop_fd);
+		stop_fd = -1;
+	}
 
 	if(sockfd)
 	{
@@ -108,105 +132,340 @@ int udp_connection::start_listening()
 
     freeaddrinfo(servinfo);
 
+    // The listener drains the socket without blocking, and sleeps in
+    // poll() on it and on stop_fd, which kill_connection() writes to.
+    fcntl(sockfd, F_SETFL, fcntl(sockfd, F_GETFL, 0) | O_NONBLOCK);
+    if ((stop_fd = eventfd(0, EFD_NONBLOCK)) == -1)
+    {
+        perror("listener: eventfd");
+        close(sockfd);
+        sockfd = 0;
+        return 3;
+    }
+
+    // Statistics cover one connection, from here to kill_connection().
+    memset(&link_stats, 0, sizeof(link_stats));
+    have_sequence = false;
+    ball.reset();
+    if (recorder)
+        recorder->record_listen(catch_height);
+
     // Spawn a new thread to listen to the socket....
-    listener = gpioStartThread(start_listener, this);
+    listener_flag = true;
+    if (pthread_create(&listener, NULL, start_listener, this) != 0)
+    {
+        printf("ERROR: could not start the listener thread\n");
+        listener_flag = false;
+        return 4;
+    }
+    listener_started = true;
     return(0);
 }
 
 void udp_connection::set_LX(double lxCommand)
 {
-	track_flag = true;
-	pthread_mutex_lock(&LX_lock);
-	LX_demand = lxCommand;
-	pthread_mutex_unlock(&LX_lock);
+	latest.LX = lxCommand;
 }
 
 void udp_connection::set_RX(double rxCommand)
 {
+	latest.RX = rxCommand;
+}
+
+void udp_connection::publish_commands(uint64_t tick)
+{
+	latest.recv_tick = tick;
+	commands.write(latest);
 	track_flag = true;
-	pthread_mutex_lock(&RX_lock);
-	RX_demand = rxCommand;
-	pthread_mutex_unlock(&RX_lock);
 }
 
-double udp_connection::get_RX()
+bool udp_connection::accept_message(const cv_message& message, uint64_t recv_tick)
 {
-	if(track_flag && listener_flag)
+	link_stats.binary++;
+
+	if (have_sequence)
 	{
-		double output;
-		pthread_mutex_lock(&RX_lock);
-		output = RX_demand;
-		pthread_mutex_unlock(&RX_lock);
-		return(output);	
+		int32_t ahead = (int32_t) (message.sequence - last_sequence);
+		if ((ahead <= 0) && (ahead > -CV_SEQUENCE_RESTART))
+		{
+			link_stats.dropped_old++;
+			return(false);
+		}
 	}
+
+	// The floor creeps up slowly from when it was last set, so it follows
+	// the sender's clock drifting against ours. A restarted sender starts
+	// a new floor.
+	int64_t transit = (int64_t) (recv_tick - message.sender_tick);
+	int64_t floor_us = link_stats.transit_floor_us + (int64_t) ((recv_tick - floor_tick)*CV_CLOCK_DRIFT_PPM/1000000);
+	if (!have_sequence || (((int32_t) (message.sequence - last_sequence)) <= 0) || (transit < floor_us))
+	{
+		link_stats.transit_floor_us = transit;
+		floor_tick = recv_tick;
+		floor_us = transit;
+	}
+	have_sequence = true;
+	last_sequence = message.sequence;
+
+	int32_t late = (int32_t) (transit - floor_us);
+	if (late > CV_STALE_US)
+	{
+		link_stats.dropped_stale++;
+		return(false);
+	}
+	link_stats.transit_sum_us += late;
+	if (late > link_stats.transit_max_us)
+		link_stats.transit_max_us = late;
+
+	latest.sender_tick = message.sender_tick;
+	latest.transit_us = late;
+	if (message.type == CV_MESSAGE_BALL)
+		return(this->apply_ball(message, recv_tick));
+
+	if (message.flags & CV_HAS_LX)
+	{
+		latest.LX = message.LX;
+		latest.LX_velocity = (message.flags & CV_HAS_VELOCITY) ? message.LX_velocity : 0;
+	}
+	if (message.flags & CV_HAS_RX)
+	{
+		latest.RX = message.RX;
+		latest.RX_velocity = (message.flags & CV_HAS_VELOCITY) ? message.RX_velocity : 0;
+	}
+	latest.has_velocity = ((message.flags & CV_HAS_VELOCITY) != 0);
+	latest.catch_tick = 0;
+	return(true);
+}
+
+bool udp_connection::apply_ball(const cv_message& message, uint64_t recv_tick)
+{
+	link_stats.ball_samples++;
+	ball.add(message.sender_tick, message.ball_x, message.ball_y);
+
+	// Send the hand to where the ball will come down, or to where it is
+	// until there is enough of the flight to predict from.
+	double target = message.ball_x;
+	latest.catch_tick = 0;
+	ball_prediction prediction;
+	if (ball.predict(catch_height, prediction))
+	{
+		target = prediction.catch_x;
+		// On our clock, leaving out the network delay
+		latest.catch_tick = recv_tick + (prediction.catch_tick - message.sender_tick);
+		link_stats.ball_predictions++;
+	}
+
+	if (message.flags & CV_HAS_LX)
+		latest.LX = target;
+	if (message.flags & CV_HAS_RX)
+		latest.RX = target;
+	latest.LX_velocity = 0;
+	latest.RX_velocity = 0;
+	latest.has_velocity = false;
+	return((message.flags & (CV_HAS_LX | CV_HAS_RX)) != 0);
+}
+
+void udp_connection::set_catch_height(double height)
+{
+	catch_height = height;
+}
+
+void udp_connection::set_recorder(event_recorder* recorder)
+{
+	this->recorder = recorder;
+}
+
+void udp_connection::print_stats()
+{
+	if (link_stats.received == 0)
+		return;
+
+	printf("UDP: %u datagrams in %u wakeups, %u binary, %u malformed, %u dropped out of order, %u dropped stale, %u superseded in a batch\n",
+	       link_stats.received, link_stats.wakeups, link_stats.binary, link_stats.malformed,
+	       link_stats.dropped_old, link_stats.dropped_stale, link_stats.superseded);
+	if (link_stats.ball_samples > 0)
+		printf("UDP: %u ball positions, %u with a catch prediction\n", link_stats.ball_samples, link_stats.ball_predictions);
+	uint32_t accepted = link_stats.binary - link_stats.dropped_old - link_stats.dropped_stale;
+	if (accepted > 0)
+		printf("UDP: transit floor %lld us, over the floor mean %.0f us max %d us\n",
+		       (long long) link_stats.transit_floor_us, link_stats.transit_sum_us/accepted, link_stats.transit_max_us);
+}
+
+bool udp_connection::get_command(cv_command& command)
+{
+	if (!(track_flag && listener_flag))
+		return(false);
+
+	command.sequence = commands.read(command);
+	return(command.sequence != 0);
+}
+
+bool udp_connection::get_new_command(cv_command& command, uint32_t& last_sequence)
+{
+	if (!(this->get_command(command)) || (command.sequence == last_sequence))
+		return(false);
+
+	last_sequence = command.sequence;
+	return(true);
+}
+
+double udp_connection::get_RX()
+{
+	cv_command command;
+	if (this->get_command(command))
+		return(command.RX);
 	return(-1);
 }
 
 double udp_connection::get_LX()
 {
-	if(track_flag && listener_flag)
+	cv_command command;
+	if (this->get_command(command))
+		return(command.LX);
+	return(-1);
+}
+
+bool udp_connection::handle_datagram(char* data, int length, uint64_t recv_tick)
+{
+	link_stats.received++;
+
+	// Binary messages carry their own sequence and time stamp.
+	if (is_cv_message(data, length))
 	{
-		double output;
-		pthread_mutex_lock(&LX_lock);
-		output = LX_demand;
-		pthread_mutex_unlock(&LX_lock);
-		return(output);	
+		cv_message message;
+		if (decode_cv_message(data, length, message))
+		{
+			link_stats.malformed++;
+			return(false);
+		}
+		return(this->accept_message(message, recv_tick));
 	}
-	return(-1);
+
+	data[length] = '\0';
+	//printf("UDP message recd. %s \n",data); 
+
+    // The string input is of the form:
+    //"R0.125 L0.02" to command the right X to go to 0.125 and the left X to
+    // go to 0.02. repeated calls to strtok returns segments of the string
+    // split by the delimiter named in the first call. 
+    bool new_command = false;
+    char *split_string;
+    split_string = strtok(data, " ");
+    while(split_string != NULL)
+    {
+    	if (split_string[0] == 'L')
+    	{
+    		// We have a command for the left motor!
+    		this->set_LX(atof(split_string + 1));
+    		new_command = true;
+		//printf("Left Motor command recd over UDP: %s \n", split_string);
+    	}
+    	if (split_string[0] == 'R')
+    	{
+    		// We have a command for the right motor!
+    		this->set_RX(atof(split_string + 1));
+    		new_command = true;
+    	}
+    	if (split_string[0] == 'X')
+    	{
+    		// Signal that transmission is over.
+    		listener_flag = false;
+    		printf("Transmission is over on UDP. \n");
+    		break;
+    	}
+    	split_string = strtok(NULL, " ");
+    }
+
+    if (new_command)
+    {
+    	latest.catch_tick = 0;
+    	latest.sender_tick = 0;
+    	latest.transit_us = 0;
+    	latest.has_velocity = false;
+    }
+    return(new_command);
 }
 
 void *start_listener(void *data)
 {
 	// Cast pointer
 	udp_connection *udp_ptr  = (udp_connection *) data;
-	udp_ptr->listener_flag = true;
 	printf("UDP Connection is up and Listening.");
+
+	struct pollfd fds[2];
+	fds[0].fd = udp_ptr->sockfd;
+	fds[0].events = POLLIN;
+	fds[1].fd = udp_ptr->stop_fd;
+	fds[1].events = POLLIN;
+
 	while(udp_ptr->listener_flag)
 	{
-		(udp_ptr->addr_len) = sizeof (udp_ptr->their_addr);
+		// Sleep until there is something to read or we are told to stop.
+		if (poll(fds, 2, -1) < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			perror("ERROR: poll");
+			break;
+		}
+		if (fds[1].revents)
+			break;
 
-		// Listen to UDP port with recvfrom.
-		// When we get something, process it and go.
-		if (((udp_ptr->numbytes) = recvfrom((udp_ptr->sockfd), (udp_ptr->buf), MAXBUFLEN-1 , 0, (struct sockaddr *)&(udp_ptr->their_addr), &(udp_ptr->addr_len))) == -1) 
+		// Drain everything that is waiting. The datagrams are applied in
+		// order, so each hand ends up with its newest target, and only that
+		// goes out to the control loops.
+		bool new_command = false;
+		uint32_t accepted = 0;
+		uint64_t recv_tick = 0;
+		udp_ptr->link_stats.wakeups++;
+		while(udp_ptr->listener_flag)
 		{
-			(udp_ptr->track_flag) = false;
-			(udp_ptr->listener_flag) = false;
-			printf("ERROR: recvfrom");
-			return(NULL);
+			for (int i = 0; i < UDP_BATCH; i++)
+			{
+				udp_ptr->iov[i].iov_base = udp_ptr->bufs[i];
+				udp_ptr->iov[i].iov_len = MAXBUFLEN - 1;
+				memset(&(udp_ptr->msgs[i].msg_hdr), 0, sizeof(struct msghdr));
+				udp_ptr->msgs[i].msg_hdr.msg_iov = &(udp_ptr->iov[i]);
+				udp_ptr->msgs[i].msg_hdr.msg_iovlen = 1;
+			}
+
+			int count = recvmmsg(udp_ptr->sockfd, udp_ptr->msgs, UDP_BATCH, MSG_DONTWAIT, NULL);
+			if (count < 0)
+			{
+				if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
+				{
+					perror("ERROR: recvmmsg");
+					udp_ptr->listener_flag = false;
+				}
+				break;
+			}
+
+			recv_tick = mono_tick();
+			for (int i = 0; (i < count) && udp_ptr->listener_flag; i++)
+			{
+				// Logged before handling, which changes the buffer.
+				if (udp_ptr->recorder)
+					udp_ptr->recorder->record_datagram(udp_ptr->bufs[i], udp_ptr->msgs[i].msg_len, recv_tick);
+				if (udp_ptr->handle_datagram(udp_ptr->bufs[i], udp_ptr->msgs[i].msg_len, recv_tick))
+				{
+					new_command = true;
+					accepted++;
+				}
+			}
+			if (count < UDP_BATCH)
+				break;
 		}
-		//printf("UDP message recd. %s \n",udp_ptr->buf); 
-
-        // Packet is now saved in udp_ptr->buf
-        // We can now parse it.
-        // The string input is of the form:
-        //"R0.125 L0.02" to command the right X to go to 0.125 and the left X to
-        // go to 0.02. repeated calls to strtok returns segments of the string
-        // split by the delimiter named in the first call. 
-        char *split_string;
-        split_string = strtok((udp_ptr->buf)," ");
-        while(split_string != NULL)
-        {
-        	if (split_string[0] == 'L')
-        	{
-        		// We have a command for the left motor!
-        		udp_ptr->set_LX(atof(split_string + 1));
-			//printf("Left Motor command recd over UDP: %s \n", split_string);
-        	}
-        	if (split_string[0] == 'R')
-        	{
-        		// We have a command for the right motor!
-        		udp_ptr->set_RX(atof(split_string + 1));
-        	}
-        	if (split_string[0] == 'X')
-        	{
-        		// Signal that transmission is over.
-        		udp_ptr->listener_flag = false;
-        		printf("Transmission is over on UDP. \n");
-        		break;
-        	}
-        	split_string = strtok(NULL, " ");
-        }
-    }
-    (udp_ptr->track_flag) = false;
-    return(NULL);
+
+		// Both hands go out together, as one command.
+		if (new_command)
+		{
+			udp_ptr->link_stats.superseded += accepted - 1;
+			udp_ptr->publish_commands(recv_tick);
+			if (udp_ptr->recorder)
+				udp_ptr->recorder->record_publish(accepted, recv_tick, mono_tick());
+		}
+	}
+	udp_ptr->listener_flag = false;
+	(udp_ptr->track_flag) = false;
+	return(NULL);
 }
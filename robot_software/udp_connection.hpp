@@ -19,8 +19,6 @@
 #ifndef __UDP_CONN_HPP__
 #define __UDP_CONN_HPP__
 
-#include <pigpio.h>
-
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -31,54 +29,166 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <netdb.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
 
 #include <pthread.h>
+#include <stdint.h>
+#include <atomic>
 #include <string>
+#include "seqlock.hpp"
+#include "cv_protocol.hpp"
+#include "ball_predictor.hpp"
 
 #define MAXBUFLEN 1024
 
+// Most datagrams taken from the socket in one recvmmsg call
+#define UDP_BATCH 32
+
+// Binary messages that arrive this much later than the fastest one (us)
+// are stale and dropped.
+#define CV_STALE_US 20000
+
+// A sequence number this far behind the last one means the sender started
+// over, rather than a reordered datagram.
+#define CV_SEQUENCE_RESTART 1000
+
+// Allowed drift between the sender's clock and ours (parts per million)
+#define CV_CLOCK_DRIFT_PPM 100
+
+// Height (m) the hands catch at by default, planner_params::throw_height
+#define CV_CATCH_HEIGHT 0.3
+
+class event_recorder;
+
+// Latest X commands from the CV, as one coherent pair
+struct cv_command {
+	double LX;              // left hand x demanded point
+	double RX;              // right hand x demanded point
+	double LX_velocity;     // predicted velocities (m/s), if has_velocity
+	double RX_velocity;
+	uint64_t recv_tick;     // mono_tick() when the datagram arrived
+	uint64_t sender_tick;   // sender's time stamp, 0 for text commands
+	uint32_t sequence;      // commands received so far, 0 for none
+	int32_t transit_us;     // how much later than the fastest datagram it
+	                        // arrived (binary only)
+	uint64_t catch_tick;    // when a ball being predicted comes down, on
+	                        // our clock (0 for none)
+	bool has_velocity;
+};
+
+// What the listener has received. Only updated by the listener thread.
+struct cv_link_stats {
+	uint32_t received;
+	uint32_t wakeups;          // times the listener woke up to drain
+	uint32_t superseded;       // accepted, then replaced in the same batch
+	uint32_t binary;
+	uint32_t ball_samples;     // ball positions
+	uint32_t ball_predictions; // ball positions that gave a catch point
+	uint32_t malformed;
+	uint32_t dropped_old;      // repeated or out of order
+	uint32_t dropped_stale;    // arrived more than CV_STALE_US late
+	int64_t transit_floor_us;  // smallest arrival minus sender time; the
+	                           // one-way delay if both share a clock
+	double transit_sum_us;     // accepted binary messages, over the floor
+	int32_t transit_max_us;
+};
+
+// How long CV commands take from arriving to being acted on. Kept by the
+// control loop that uses them.
+struct cv_delay_stats {
+	uint32_t commands;
+	double receipt_sum_us;    // arrival to first control period using it
+	uint64_t receipt_max_us;
+	double transit_sum_us;    // network delay over the fastest datagram
+	int32_t transit_max_us;
+
+	cv_delay_stats() { reset(); }
+
+	void reset()
+	{
+		commands = 0;
+		receipt_sum_us = 0;
+		receipt_max_us = 0;
+		transit_sum_us = 0;
+		transit_max_us = 0;
+	}
+
+	void add(const cv_command& command, uint64_t now_tick)
+	{
+		uint64_t receipt_us = now_tick - command.recv_tick;
+		receipt_sum_us += receipt_us;
+		if (receipt_us > receipt_max_us)
+			receipt_max_us = receipt_us;
+		transit_sum_us += command.transit_us;
+		if (command.transit_us > transit_max_us)
+			transit_max_us = command.transit_us;
+		commands++;
+	}
+
+	void print(std::string name) const
+	{
+		if (commands == 0)
+			return;
+		printf("%s CV delay: %u commands, receipt to actuation mean %.0f us max %llu us, transit over fastest mean %.0f us max %d us\n",
+		       name.c_str(), commands, receipt_sum_us/commands, (unsigned long long) receipt_max_us,
+		       transit_sum_us/commands, transit_max_us);
+	}
+};
+
 class udp_connection
 {
 public:
 	// PUBLIC VARIABLES
 
-	// Mutex to lock RX command variable
-	pthread_mutex_t RX_lock;
+	// Latest commands, written only by the listener thread. Control loops
+	// read the pair without ever holding up the listener.
+	seqlock<cv_command> commands;
 
-	// Mutex to lock LX command variable
-	pthread_mutex_t LX_lock;
+	// The listener's copy of the latest commands. A datagram may only
+	// carry one hand; the other keeps its last value.
+	cv_command latest;
 
-	// Variable to hold the current left-hand x demanded point
-	double LX_demand;
+	// Listener side bookkeeping for binary messages
+	cv_link_stats link_stats;
+	bool have_sequence;
+	uint32_t last_sequence;
+	uint64_t floor_tick;
 
-	// Variable to hold the current right hand x demanded point
-	double RX_demand;
+	// Flight of the ball the CV is reporting, and the height it is
+	// caught at
+	ball_predictor ball;
+	double catch_height;
 
 	// Port number to listen on
 	std::string port_no;
 
 
 	// Variable to tell if meaningful data has come through from the kinect
-	bool track_flag;
+	std::atomic<bool> track_flag;
 
 	// Variable to tell if listener is active
-	bool listener_flag;
+	std::atomic<bool> listener_flag;
 
 	// Current thread id of listener
-	pthread_t *listener;
+	pthread_t listener;
+	bool listener_started;
 
 	// Socket fd - resource handle
 	int sockfd;
 
-	// Storage structure for sender IP
-	struct sockaddr_storage their_addr;
+	// eventfd that wakes the listener up to stop
+	int stop_fd;
 
-	// Buffer to store message
-	char buf[MAXBUFLEN];
+	// Event log for the datagrams and publishes (event_log.hpp), or NULL.
+	// Set before start_listening().
+	event_recorder* recorder;
 
-	//Random stuff used by functions
-	int numbytes;
-	socklen_t addr_len;
+	// Buffers for one recvmmsg batch
+	char bufs[UDP_BATCH][MAXBUFLEN];
+	struct iovec iov[UDP_BATCH];
+	struct mmsghdr msgs[UDP_BATCH];
 
 
 
@@ -96,19 +206,55 @@ public:
 	// Command to start connection
 	int start_listening();
 
+	// Copy out the latest pair of commands. Returns false if not tracking
+	// or nothing has been received yet.
+	bool get_command(cv_command& command);
+
+	// The same, but only returns true if the command is newer than
+	// last_sequence, which is then updated. Each reader keeps its own.
+	bool get_new_command(cv_command& command, uint32_t& last_sequence);
+
 	// Command to get LX tracking point
 	double get_LX();
 
 	// Command to get RX tracking point
 	double get_RX();
 
-	// Command to set LX tracking point
+	// LISTENER THREAD ONLY: Command to set LX tracking point
 	void set_LX(double lxCommand);
 
-	// Command to set RX tracking point
+	// LISTENER THREAD ONLY: Command to set RX tracking point
 	void set_RX(double rxCommand);
 
-    // Kills the child thread and releases resouces.
+	// LISTENER THREAD ONLY: Publish the commands set since the last
+	// publish as one new command, stamped with tick.
+	void publish_commands(uint64_t tick);
+
+	// LISTENER THREAD ONLY: Check a binary message against the ones
+	// before it, and take its targets if it is new and on time. Returns
+	// false if it was dropped.
+	bool accept_message(const cv_message& message, uint64_t recv_tick);
+
+	// LISTENER THREAD ONLY: Add a ball position to its flight, and send
+	// the catching hand to the predicted catch point. Returns true if a
+	// target changed.
+	bool apply_ball(const cv_message& message, uint64_t recv_tick);
+
+	// Height (m) the ball is caught at. Set before start_listening().
+	void set_catch_height(double height);
+
+	// Log every datagram and publish to recorder. Set before
+	// start_listening().
+	void set_recorder(event_recorder* recorder);
+
+	// LISTENER THREAD ONLY: Apply one datagram (length bytes, with room
+	// for one more) to the latest commands. Returns true if it changed them.
+	bool handle_datagram(char* data, int length, uint64_t recv_tick);
+
+	// Print the link statistics since start_listening()
+	void print_stats();
+
+    // Stops the listener thread and releases resouces.
     // Basically a destructor.
 	void kill_connection();
 };
@@ -0,0 +1,222 @@
+/* udp_load.cpp
+
+   Created 10/16/2026
+
+   Load generator for the CV command listener. Sends X commands to a port
+   on this machine as fast as asked, so the listener's packet rate and
+   what it drops under bursts can be measured.
+
+   Usage: ./udp_load [--text|--ball] [--self] <port> [rate (Hz)] [seconds] [burst]
+
+   Every 1/rate seconds, burst datagrams go out back to back (default 1).
+   Commands are binary (cv_protocol.hpp) unless --text is given, and
+   sweep both hands slowly across the workspace. With --ball they are
+   instead ball positions of a 0.5 m throw to the right hand, over and
+   over, for the catch point predictor.
+
+   With --self the tool also runs the robot's udp_connection on the port
+   itself, polls it once per millisecond like a control loop, and prints
+   how many datagrams it took in, how many commands the control side saw,
+   and the listener's link statistics. The tool is built against the
+   simulated GPIO (make udp_load), so it runs anywhere; --self runs the
+   simulated clock at real time for the listener's receive ticks.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <cmath>
+#include <string>
+#include "hal.hpp"
+#include "udp_connection.hpp"
+#include "cv_protocol.hpp"
+#include "mono_clock.hpp"
+#include "path_planner.hpp"
+
+#ifndef ROBOT_SIM
+#error "udp_load runs on the simulated GPIO. Build it with make udp_load."
+#endif
+
+using namespace std;
+
+// Sender time stamp (us)
+static uint64_t sender_tick()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return(((uint64_t) now.tv_sec)*1000000 + now.tv_nsec/1000);
+}
+
+static void sleep_until(struct timespec& next, long period_ns)
+{
+	next.tv_nsec += period_ns;
+	while (next.tv_nsec >= 1000000000)
+	{
+		next.tv_nsec -= 1000000000;
+		next.tv_sec++;
+	}
+	clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+}
+
+int main(int argc, char *argv[])
+{
+	bool text = false;
+	bool ball = false;
+	bool self = false;
+	int arg = 1;
+	while ((arg < argc) && (strncmp(argv[arg], "--", 2) == 0))
+	{
+		if (strcmp(argv[arg], "--text") == 0)
+			text = true;
+		else if (strcmp(argv[arg], "--ball") == 0)
+			ball = true;
+		else if (strcmp(argv[arg], "--self") == 0)
+			self = true;
+		arg++;
+	}
+	if (arg >= argc)
+	{
+		printf("Usage: %s [--text|--ball] [--self] <port> [rate (Hz)] [seconds] [burst]\n", argv[0]);
+		return 1;
+	}
+
+	string port = argv[arg];
+	double rate = (argc > arg + 1) ? atof(argv[arg + 1]) : 1000;
+	double seconds = (argc > arg + 2) ? atof(argv[arg + 2]) : 5;
+	int burst = (argc > arg + 3) ? atoi(argv[arg + 3]) : 1;
+	if ((rate <= 0) || (seconds <= 0) || (burst < 1))
+	{
+		printf("Rate, seconds and burst must be positive.\n");
+		return 1;
+	}
+
+	udp_connection listener(port);
+	if (self)
+	{
+		if (hal_initialise() < 0)
+		{
+			printf("The simulated GPIO failed to initialise. Aborting.\n");
+			return 1;
+		}
+		// Nothing steps the simulated clock here, so run it at real time.
+		sim_run(1.0);
+		mono_clock_start();
+		if (listener.start_listening())
+		{
+			hal_terminate();
+			return 1;
+		}
+	}
+
+	int sock = socket(AF_INET, SOCK_DGRAM, 0);
+	if (sock < 0)
+	{
+		perror("socket");
+		return 1;
+	}
+	struct sockaddr_in to;
+	memset(&to, 0, sizeof(to));
+	to.sin_family = AF_INET;
+	to.sin_port = htons(atoi(port.c_str()));
+	to.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	long period_ns = (long) (1e9/rate);
+	uint64_t periods = (uint64_t) (seconds*rate);
+	uint64_t sent = 0;
+	uint64_t send_errors = 0;
+	uint64_t seen = 0;
+	cv_command last_command;
+	memset(&last_command, 0, sizeof(last_command));
+	uint32_t last_sequence = 0;
+	uint32_t sequence = 0;
+
+	struct timespec next;
+	clock_gettime(CLOCK_MONOTONIC, &next);
+	uint64_t start = sender_tick();
+	uint64_t next_poll = start;
+	for (uint64_t period = 0; period < periods; period++)
+	{
+		for (int i = 0; i < burst; i++)
+		{
+			double t = (sender_tick() - start)*1e-6;
+			float lx = (float) (0.2 + 0.1*sin(t));
+			float rx = (float) (0.2 - 0.1*sin(t));
+
+			char buf[MAXBUFLEN];
+			int length;
+			if (text)
+				length = snprintf(buf, sizeof(buf), "R%.4f L%.4f", rx, lx);
+			else if (ball)
+			{
+				// Thrown up 0.5 m from the catch height, 0.5 m across, with
+				// a short gap between throws so each is a new flight.
+				double v_throw = sqrt(2*GRAVITY*0.5);
+				double t_air = 2*v_throw/GRAVITY;
+				double t_flight = fmod(t, t_air + 0.2);
+				if (t_flight > t_air)
+					continue;
+				cv_message message;
+				message.type = CV_MESSAGE_BALL;
+				message.flags = CV_HAS_RX;
+				message.sequence = ++sequence;
+				message.sender_tick = sender_tick();
+				message.ball_x = (float) (0.05 + (0.5/t_air)*t_flight);
+				message.ball_y = (float) (CV_CATCH_HEIGHT + v_throw*t_flight - 0.5*GRAVITY*t_flight*t_flight);
+				length = encode_cv_message(message, buf);
+			}
+			else
+			{
+				cv_message message;
+				message.type = CV_MESSAGE_X_COMMAND;
+				message.flags = CV_HAS_LX | CV_HAS_RX | CV_HAS_VELOCITY;
+				message.sequence = ++sequence;
+				message.sender_tick = sender_tick();
+				message.LX = lx;
+				message.RX = rx;
+				message.LX_velocity = (float) (0.1*cos(t));
+				message.RX_velocity = (float) (-0.1*cos(t));
+				length = encode_cv_message(message, buf);
+			}
+
+			if (sendto(sock, buf, length, 0, (struct sockaddr*) &to, sizeof(to)) == length)
+				sent++;
+			else
+				send_errors++;
+		}
+
+		// Read the commands at 1 kHz, as a control loop would.
+		if (self && (sender_tick() >= next_poll))
+		{
+			cv_command command;
+			if (listener.get_new_command(command, last_sequence))
+			{
+				seen++;
+				last_command = command;
+			}
+			next_poll += 1000;
+		}
+		sleep_until(next, period_ns);
+	}
+	double elapsed = (sender_tick() - start)*1e-6;
+	close(sock);
+
+	printf("Sent %llu %s datagrams in %.3f s: %.0f per second, %llu send errors\n",
+	       (unsigned long long) sent, text ? "text" : (ball ? "ball" : "binary"), elapsed, sent/elapsed,
+	       (unsigned long long) send_errors);
+
+	if (self)
+	{
+		// Give the listener a moment to drain, then stop it.
+		usleep(100000);
+		listener.kill_connection();
+		uint32_t received = listener.link_stats.received;
+		printf("Received %u datagrams: %.0f per second, %llu lost in the socket\n",
+		       received, received/elapsed, (unsigned long long) (sent - received));
+		printf("Control side saw %llu new commands at 1 kHz, the last LX %.4f RX %.4f\n",
+		       (unsigned long long) seen, last_command.LX, last_command.RX);
+		mono_clock_stop();
+		hal_terminate();
+	}
+	return 0;
+}
@@ -0,0 +1,168 @@
+/* work_pool.hpp
+
+   Created 10/16/2026
+
+   This is the header file for the work_pool class.
+
+   A work_pool runs a job for every index in [0, count) across a set of
+   threads, for batch tools such as gain_sweep. Each thread starts with an
+   equal share of the indices and takes them one at a time from the front
+   of its own range. A thread that runs out steals the back half of the
+   range of another thread, so jobs of very different lengths (a run that
+   aborts early next to one that goes the whole way) still keep every
+   core busy to the end.
+
+   Each range is a single 64 bit atomic (begin in the high half, end in
+   the low half), so taking and stealing are one compare and swap, on
+   their own cache line per thread. No new work appears while a run is
+   going, so a thread that finds every range empty is done.
+
+   The job is called as job(index, worker) with worker in [0, threads),
+   so it can keep per thread state indexed by worker.
+*/
+
+#ifndef __WORK_POOL_HPP__
+#define __WORK_POOL_HPP__
+
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "cache_line.hpp"
+
+// Most threads in one pool
+#define MAX_POOL_THREADS 64
+
+class work_pool
+{
+public:
+
+	// Constructor. 0 threads means one per core.
+	work_pool(int threads)
+	{
+		if (threads <= 0)
+			threads = (int) std::thread::hardware_concurrency();
+		if (threads <= 0)
+			threads = 1;
+		if (threads > MAX_POOL_THREADS)
+			threads = MAX_POOL_THREADS;
+		this->threads = threads;
+		for (int i = 0; i < MAX_POOL_THREADS; i++)
+		{
+			ranges[i].range.store(0);
+			ranges[i].steals = 0;
+		}
+	}
+
+	int size() const
+	{
+		return(threads);
+	}
+
+	// Run job(index, worker) for every index, returning once all are done
+	template <typename Job>
+	void run(uint32_t count, Job& job)
+	{
+		for (int i = 0; i < threads; i++)
+		{
+			uint32_t begin = (uint32_t) (((uint64_t) count * i) / threads);
+			uint32_t end = (uint32_t) (((uint64_t) count * (i + 1)) / threads);
+			ranges[i].range.store(pack(begin, end));
+			ranges[i].steals = 0;
+		}
+
+		std::vector<std::thread> workers;
+		for (int i = 1; i < threads; i++)
+			workers.push_back(std::thread(&work_pool::work<Job>, this, i, &job));
+		this->work<Job>(0, &job);
+		for (unsigned i = 0; i < workers.size(); i++)
+			workers[i].join();
+	}
+
+	// Ranges stolen during the last run
+	uint32_t total_steals() const
+	{
+		uint32_t steals = 0;
+		for (int i = 0; i < threads; i++)
+			steals += ranges[i].steals;
+		return(steals);
+	}
+
+private:
+
+	struct worker_range {
+		alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> range;
+		uint32_t steals;
+	};
+
+	static uint64_t pack(uint32_t begin, uint32_t end)
+	{
+		return((((uint64_t) begin) << 32) | end);
+	}
+
+	// Take the front index of worker's own range
+	bool take(int worker, uint32_t& index)
+	{
+		std::atomic<uint64_t>& range = ranges[worker].range;
+		uint64_t r = range.load(std::memory_order_acquire);
+		while (true)
+		{
+			uint32_t begin = (uint32_t) (r >> 32);
+			uint32_t end = (uint32_t) r;
+			if (begin >= end)
+				return(false);
+			if (range.compare_exchange_weak(r, pack(begin + 1, end), std::memory_order_acq_rel))
+			{
+				index = begin;
+				return(true);
+			}
+		}
+	}
+
+	// Move the back half of another worker's range into our own
+	bool steal(int worker)
+	{
+		for (int i = 1; i < threads; i++)
+		{
+			std::atomic<uint64_t>& victim = ranges[(worker + i) % threads].range;
+			uint64_t r = victim.load(std::memory_order_acquire);
+			while (true)
+			{
+				uint32_t begin = (uint32_t) (r >> 32);
+				uint32_t end = (uint32_t) r;
+				if (begin >= end)
+					break;
+				uint32_t middle = end - (end - begin + 1)/2;
+				if (victim.compare_exchange_weak(r, pack(begin, middle), std::memory_order_acq_rel))
+				{
+					ranges[worker].range.store(pack(middle, end), std::memory_order_release);
+					ranges[worker].steals++;
+					return(true);
+				}
+			}
+		}
+		return(false);
+	}
+
+	template <typename Job>
+	void work(int worker, Job* job)
+	{
+		uint32_t index;
+		while (true)
+		{
+			while (this->take(worker, index))
+				(*job)(index, worker);
+			if (!(this->steal(worker)))
+				return;
+		}
+	}
+
+	int threads;
+	worker_range ranges[MAX_POOL_THREADS];
+
+	// Disable default copy constructor and assignment operator
+	work_pool(const work_pool&);
+	work_pool& operator=(const work_pool&);
+};
+
+#endif